@@ -0,0 +1,17 @@
+// bench.c - Benchmark harness.
+#include "bench/bench.h"
+
+#include <stdio.h>
+#include <time.h>
+
+double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+void bench_report(const char *benchmark, const char *metric, double value,
+                  const char *unit) {
+    printf("%s: %s: %.4g %s\n", benchmark, metric, value, unit);
+    fflush(stdout);
+}
@@ -0,0 +1,41 @@
+// bench.h - Benchmark harness.
+#pragma once
+
+#include <stdbool.h>
+
+// A benchmark which can be run by the harness.
+struct benchmark {
+    const char *name;
+    const char *description;
+    void (*run)(void);
+};
+
+// Return the current time, in seconds, from a monotonic clock.
+double bench_now(void);
+
+// Print a benchmark result.
+void bench_report(const char *benchmark, const char *metric, double value,
+                  const char *unit);
+
+// Size of the framebuffer for OpenGL benchmarks.
+#define BENCH_GL_WIDTH 640
+#define BENCH_GL_HEIGHT 360
+
+// Create a hidden window with an OpenGL context, load the shaders, and set up
+// the shared drawing state. Returns false, after printing a warning, if OpenGL
+// is not available.
+bool bench_gl_start(void);
+
+// Release the shared drawing state, including the stream buffer, and destroy
+// the window created by bench_gl_start().
+void bench_gl_stop(void);
+
+// Benchmarks.
+void bench_synth(void);
+void bench_audio_clock(void);
+void bench_particles_cpu(void);
+void bench_particles_gpu(void);
+void bench_lsystem(void);
+void bench_math(void);
+void bench_dragons(void);
+void bench_stream(void);
@@ -0,0 +1,58 @@
+// bench_audio.c - Audio clock check.
+#include "bench/bench.h"
+
+#include "tcm/audio.h"
+#include "tcm/synth.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Time to let the synthesizer fill the ring buffer, in seconds.
+static const double SETTLE_TIME = 0.25;
+// Time to measure the clock, in seconds.
+static const double RUN_TIME = 2.0;
+// How far the clock may lead the wall clock, in seconds: one period of the null
+// sink, plus scheduling slop.
+static const double LEAD_LIMIT = 256.0 / SYNTH_RATE + 0.005;
+
+// Run the audio pipeline with the null sink, and compare its clock with the
+// wall clock. The clock may fall behind during an underrun, but may never run
+// ahead of the time elapsed since it started.
+void bench_audio_clock(void) {
+    double t0 = bench_now();
+    if (!audio_init(AUDIO_SINK_NULL)) {
+        fputs("Error: Could not start audio\n", stderr);
+        exit(1);
+    }
+    double start = 0.0, lead = -INFINITY, pos = 0.0, elapsed = 0.0;
+    bool settled = false;
+    for (;;) {
+        nanosleep(&(struct timespec){.tv_nsec = 1000000}, NULL);
+        elapsed = bench_now() - t0;
+        if (!audio_position(&pos)) {
+            fputs("Error: Audio stopped\n", stderr);
+            exit(1);
+        }
+        if (pos - elapsed > lead) {
+            lead = pos - elapsed;
+        }
+        if (!settled && elapsed >= SETTLE_TIME) {
+            settled = true;
+            start = pos - elapsed;
+        }
+        if (elapsed >= SETTLE_TIME + RUN_TIME) {
+            break;
+        }
+    }
+    audio_term();
+    double drift = (pos - elapsed) - start;
+    bench_report("audio_clock", "drift over run", drift * 1e3, "ms");
+    bench_report("audio_clock", "max lead over wall clock", lead * 1e3, "ms");
+    if (lead > LEAD_LIMIT) {
+        fprintf(stderr, "Error: Audio clock ran %.1f ms ahead of wall clock\n",
+                lead * 1e3);
+        exit(1);
+    }
+}
@@ -0,0 +1,142 @@
+// bench_dragons.c - Instanced curve rendering benchmark.
+#include "bench/bench.h"
+
+#include "tcm/dragon.h"
+#include "tcm/drawlist.h"
+#include "tcm/gl.h"
+#include "tcm/frame.h"
+#include "tcm/glstate.h"
+#include "tcm/shaders.h"
+#include "tcm/stream.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+    // Frames drawn for each measurement.
+    FRAMES = 60,
+    MAX_COUNT = 10000,
+};
+
+// Pixels per unit, for the benchmark framebuffer.
+static const float PIXELS = 0.5f * BENCH_GL_HEIGHT;
+
+static struct dragon_instance instances[MAX_COUNT];
+
+static void fill(int count) {
+    for (int i = 0; i < count; i++) {
+        float u = (float)i / (float)count;
+        instances[i] = (struct dragon_instance){
+            .x = 3.0f * u - 1.5f,
+            .y = sinf(40.0f * u),
+            .scale = 0.05f,
+            .angle = 10.0f * u,
+            .a = 0.5f * sinf(7.0f * u),
+            .color = {255, 128, 64, 255},
+        };
+    }
+}
+
+// Draw with one instanced draw call per frame.
+static double run_instanced(int count) {
+    struct drawlist dl;
+    drawlist_init(&dl);
+    glFinish();
+    double t0 = bench_now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        frame_update(0.0, BENCH_GL_WIDTH, BENCH_GL_HEIGHT);
+        glClear(GL_COLOR_BUFFER_BIT);
+        dragon_draw_instances(&dl, instances, count, PIXELS);
+        drawlist_submit(&dl);
+        glstate_end_frame();
+        stream_end_frame();
+    }
+    glFinish();
+    double elapsed = bench_now() - t0;
+    drawlist_destroy(&dl);
+    return elapsed;
+}
+
+// Draw with one draw call per curve, pointing the instance attributes at each
+// curve in turn. This is equivalent to setting uniforms for each curve.
+static double run_separate(int count) {
+    GLuint buffer, array;
+    glGenBuffers(1, &buffer);
+    glGenVertexArrays(1, &array);
+    glstate_bind_vertex_array(array);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(*instances) * count, instances,
+                 GL_STATIC_DRAW);
+    for (int i = 0; i < 3; i++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    float max_a = 0.0f;
+    for (int i = 0; i < count; i++) {
+        max_a = fmaxf(max_a, fabsf(instances[i].a));
+    }
+    float morph;
+    int depth = dragon_lod(max_a, PIXELS * instances[0].scale, &morph);
+    // Use the same program as dragon_draw_instances().
+    GLuint prog = shader_variant(
+        SHADER_PROGRAM_DRAGON_INSTANCED,
+        &(struct shader_key){.knob[SHADER_KNOB_DEPTH] = depth});
+    if (prog == 0) {
+        prog = shader_dragon_instanced;
+    }
+    glstate_use_program(prog);
+    frame_update(0.0, BENCH_GL_WIDTH, BENCH_GL_HEIGHT);
+    glUniform1i(glGetUniformLocation(prog, "depth"), depth);
+    glUniform1f(glGetUniformLocation(prog, "morph"), morph);
+    const GLsizei stride = sizeof(struct dragon_instance);
+
+    glFinish();
+    double t0 = bench_now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (int i = 0; i < count; i++) {
+            size_t base = stride * i;
+            glVertexAttribPointer(
+                0, 4, GL_FLOAT, GL_FALSE, stride,
+                (void *)(base + offsetof(struct dragon_instance, x)));
+            glVertexAttribPointer(
+                1, 1, GL_FLOAT, GL_FALSE, stride,
+                (void *)(base + offsetof(struct dragon_instance, a)));
+            glVertexAttribPointer(
+                2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+                (void *)(base + offsetof(struct dragon_instance, color)));
+            glDrawArraysInstanced(GL_LINE_STRIP_ADJACENCY, 0, (1 << depth) + 3,
+                                  1);
+        }
+    }
+    glFinish();
+    double elapsed = bench_now() - t0;
+
+    glstate_delete_vertex_arrays(1, &array);
+    glstate_delete_buffers(1, &buffer);
+    return elapsed;
+}
+
+void bench_dragons(void) {
+    if (!bench_gl_start()) {
+        return;
+    }
+    for (int count = 100; count <= MAX_COUNT; count *= 10) {
+        fill(count);
+        // Warm up, so shader compilation and allocation are not measured.
+        run_instanced(count);
+        run_separate(count);
+        double instanced = (double)count * FRAMES / run_instanced(count);
+        double separate = (double)count * FRAMES / run_separate(count);
+        char metric[64];
+        snprintf(metric, sizeof(metric), "%d curves, instanced", count);
+        bench_report("dragons", metric, instanced, "curves/s");
+        snprintf(metric, sizeof(metric), "%d curves, one draw each", count);
+        bench_report("dragons", metric, separate, "curves/s");
+        snprintf(metric, sizeof(metric), "%d curves, speedup", count);
+        bench_report("dragons", metric, instanced / separate, "x");
+    }
+    bench_gl_stop();
+}
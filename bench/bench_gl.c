@@ -0,0 +1,56 @@
+// bench_gl.c - OpenGL context for benchmarks.
+#include "bench/bench.h"
+
+// To avoid conflict when we define these twice.
+#define GLFW_INCLUDE_NONE
+
+#include "tcm/dragon.h"
+#include "tcm/frame.h"
+#include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/load_shaders.h"
+#include "tcm/stream.h"
+
+#include <GLFW/glfw3.h>
+
+#include <stdio.h>
+
+static GLFWwindow *window;
+
+bool bench_gl_start(void) {
+    if (!glfwInit()) {
+        fputs("Warning: Could not initialize GLFW, skipping\n", stderr);
+        return false;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    window = glfwCreateWindow(BENCH_GL_WIDTH, BENCH_GL_HEIGHT, "bench", NULL,
+                              NULL);
+    if (window == NULL) {
+        fputs("Warning: Could not create window, skipping\n", stderr);
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(window);
+#if !defined __APPLE__
+    glewInit();
+#endif
+    // The cache may hold bindings from the last benchmark's context.
+    glstate_invalidate();
+    load_shaders();
+    dragon_init();
+    return true;
+}
+
+void bench_gl_stop(void) {
+    // Objects belong to the context, so they are recreated for the next one.
+    dragon_term();
+    frame_term();
+    stream_term();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    window = NULL;
+}
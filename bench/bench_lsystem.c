@@ -0,0 +1,40 @@
+// bench_lsystem.c - L-system curve generation benchmark.
+#include "bench/bench.h"
+
+#include "tcm/lsystem.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+    // Number of curves generated for each measurement.
+    REPEAT = 10,
+};
+
+static void bench_curve(const struct lsystem *ls, int depth, int threads) {
+    int count = 0;
+    double t0 = bench_now();
+    for (int i = 0; i < REPEAT; i++) {
+        struct lsystem_curve curve;
+        if (!lsystem_generate(ls, depth, threads, &curve)) {
+            fputs("Error: Could not generate curve\n", stderr);
+            exit(1);
+        }
+        count = curve.count;
+        lsystem_curve_destroy(&curve);
+    }
+    double elapsed = bench_now() - t0;
+    char metric[64];
+    snprintf(metric, sizeof(metric), "%s depth %d, %s", ls->name, depth,
+             threads == 1 ? "1 thread" : "all threads");
+    bench_report("lsystem", metric, (double)count * REPEAT / elapsed,
+                 "vertices/s");
+}
+
+void bench_lsystem(void) {
+    for (int threads = 1; threads >= 0; threads--) {
+        bench_curve(&LSYSTEM_DRAGON, 20, threads);
+        bench_curve(&LSYSTEM_HILBERT, 10, threads);
+        bench_curve(&LSYSTEM_GOSPER, 7, threads);
+    }
+}
@@ -0,0 +1,93 @@
+// bench_math.c - Vector math benchmark.
+#include "bench/bench.h"
+
+#include "tcm/vecmath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+    // Number of points, small enough to stay in cache.
+    COUNT = 4096,
+    // Points processed for each measurement.
+    TOTAL = 1 << 26,
+};
+
+static float data[6][COUNT];
+
+// Reset the data, so normalizing does not converge to a fixed point.
+static void fill(void) {
+    unsigned seed = 1;
+    for (int j = 0; j < 6; j++) {
+        for (int i = 0; i < COUNT; i++) {
+            seed = seed * 1103515245u + 12345u;
+            data[j][i] = (float)(seed >> 8) * (1.0f / 8388608.0f) - 1.0f;
+        }
+    }
+}
+
+// Run a kernel on the data, and return the points per second.
+static double run(void (*kernel)(const struct mat4 *m)) {
+    const struct mat4 m = mat4_rotate_z(0.5f);
+    fill();
+    double t0 = bench_now();
+    for (int i = 0; i < TOTAL / COUNT; i++) {
+        kernel(&m);
+    }
+    return (double)TOTAL / (bench_now() - t0);
+}
+
+static void report(const char *kernel, double scalar, double simd) {
+    char metric[64];
+    snprintf(metric, sizeof(metric), "%s, scalar", kernel);
+    bench_report("math", metric, scalar, "points/s");
+    snprintf(metric, sizeof(metric), "%s, %s", kernel, VECMATH_ISA);
+    bench_report("math", metric, simd, "points/s");
+    snprintf(metric, sizeof(metric), "%s, speedup", kernel);
+    bench_report("math", metric, simd / scalar, "x");
+}
+
+static void transform2_scalar(const struct mat4 *m) {
+    vecmath_transform2_scalar(m, data[0], data[1], data[2], data[3], COUNT);
+}
+
+static void transform2_simd(const struct mat4 *m) {
+    vecmath_transform2(m, data[0], data[1], data[2], data[3], COUNT);
+}
+
+static void transform3_scalar(const struct mat4 *m) {
+    vecmath_transform3_scalar(m, data[0], data[1], data[2], data[3], data[4],
+                              data[5], COUNT);
+}
+
+static void transform3_simd(const struct mat4 *m) {
+    vecmath_transform3(m, data[0], data[1], data[2], data[3], data[4], data[5],
+                       COUNT);
+}
+
+static void normalize2_scalar(const struct mat4 *m) {
+    (void)m;
+    vecmath_normalize2_scalar(data[0], data[1], COUNT);
+}
+
+static void normalize2_simd(const struct mat4 *m) {
+    (void)m;
+    vecmath_normalize2(data[0], data[1], COUNT);
+}
+
+static void normalize3_scalar(const struct mat4 *m) {
+    (void)m;
+    vecmath_normalize3_scalar(data[0], data[1], data[2], COUNT);
+}
+
+static void normalize3_simd(const struct mat4 *m) {
+    (void)m;
+    vecmath_normalize3(data[0], data[1], data[2], COUNT);
+}
+
+void bench_math(void) {
+    report("transform2", run(transform2_scalar), run(transform2_simd));
+    report("transform3", run(transform3_scalar), run(transform3_simd));
+    report("normalize2", run(normalize2_scalar), run(normalize2_simd));
+    report("normalize3", run(normalize3_scalar), run(normalize3_simd));
+}
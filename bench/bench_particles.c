@@ -0,0 +1,115 @@
+// bench_particles.c - Particle simulation benchmarks.
+#include "bench/bench.h"
+
+#include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/particle_sim.h"
+#include "tcm/particles.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+    // Particle updates per measurement, divided among the steps.
+    UPDATES = 1 << 27,
+    // Steps compared between the CPU and GPU simulations.
+    CHECK_STEPS = 60,
+};
+
+// Time step, as if running at 60 Hz.
+static const float DT = 1.0f / 60.0f;
+
+static void report_rate(const char *benchmark, int count, double rate) {
+    char metric[32];
+    snprintf(metric, sizeof(metric), "%d particles", count);
+    bench_report(benchmark, metric, rate, "particles/s");
+}
+
+void bench_particles_cpu(void) {
+    for (int count = 1 << 12; count <= 1 << 22; count <<= 2) {
+        struct particle_sim s;
+        if (!particle_sim_init(&s, count)) {
+            fputs("Error: No memory\n", stderr);
+            exit(1);
+        }
+        int steps = UPDATES / count;
+        double t0 = bench_now();
+        for (int i = 0; i < steps; i++) {
+            particle_sim_step(&s, DT);
+        }
+        double elapsed = bench_now() - t0;
+        report_rate("particles_cpu", count, (double)count * steps / elapsed);
+        particle_sim_destroy(&s);
+    }
+}
+
+// Run the GPU and CPU simulations side by side, and report the largest
+// difference in particle position.
+static void check_gpu(void) {
+    const int count = 1 << 16;
+    struct particle_sim s;
+    if (!particle_sim_init(&s, count)) {
+        fputs("Error: No memory\n", stderr);
+        exit(1);
+    }
+    struct particle *data = malloc(sizeof(*data) * count);
+    if (data == NULL) {
+        fputs("Error: No memory\n", stderr);
+        exit(1);
+    }
+    struct particles ps;
+    particles_init(&ps, count);
+    for (int i = 0; i < CHECK_STEPS; i++) {
+        particles_update(&ps, DT);
+        particle_sim_step(&s, DT);
+    }
+    glstate_bind_buffer(GL_ARRAY_BUFFER, ps.buffer[ps.current]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(*data) * count, data);
+    float error = 0.0f;
+    int mismatched = 0;
+    for (int i = 0; i < count; i++) {
+        struct particle p;
+        particle_sim_get(&s, i, &p);
+        if (p.seed != data[i].seed) {
+            // Emitted on a different step, due to rounding in the age.
+            mismatched++;
+            continue;
+        }
+        float e = fmaxf(fabsf(p.x - data[i].x), fabsf(p.y - data[i].y));
+        if (e > error) {
+            error = e;
+        }
+    }
+    bench_report("particles_gpu", "max position error vs CPU", error,
+                 "units");
+    bench_report("particles_gpu", "emitted on different steps", mismatched,
+                 "particles");
+    particles_destroy(&ps);
+    particle_sim_destroy(&s);
+    free(data);
+}
+
+void bench_particles_gpu(void) {
+    if (!bench_gl_start()) {
+        return;
+    }
+    for (int count = 1 << 12; count <= 1 << 22; count <<= 2) {
+        struct particles ps;
+        particles_init(&ps, count);
+        // Warm up, so buffer allocation is not measured.
+        particles_update(&ps, DT);
+        glFinish();
+        int steps = UPDATES / count;
+        double t0 = bench_now();
+        for (int i = 0; i < steps; i++) {
+            particles_update(&ps, DT);
+        }
+        glFinish();
+        double elapsed = bench_now() - t0;
+        report_rate("particles_gpu", count, (double)count * steps / elapsed);
+        particles_destroy(&ps);
+    }
+    check_gpu();
+    bench_gl_stop();
+}
@@ -0,0 +1,118 @@
+// bench_stream.c - Streaming buffer benchmark.
+#include "bench/bench.h"
+
+#include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    // Size of each write, in bytes.
+    CHUNK = 64 << 10,
+    // Bytes written per frame, for measuring throughput.
+    FRAME_BYTES = 1 << 20,
+    // Frames written for each measurement.
+    FRAMES = 200,
+};
+
+static unsigned char chunk[CHUNK];
+
+static struct stream_range write_data(const void *data) {
+    struct stream_range range;
+    if (!stream_write(data, CHUNK, 1, &range)) {
+        fputs("Error: Stream write failed\n", stderr);
+        exit(1);
+    }
+    return range;
+}
+
+static void write_chunk(void) {
+    write_data(chunk);
+}
+
+// Fill the buffer to exactly its end, and write again at the start. The second
+// write must not overwrite the first lap while the GPU may be using it: with
+// orphaning, the buffer must be orphaned.
+static void check_lap(const char *benchmark, bool persistent) {
+    for (int i = 0; i < STREAM_SIZE / CHUNK; i++) {
+        write_chunk();
+    }
+    stream_end_frame();
+    write_chunk();
+    stream_end_frame();
+    struct stream_stats stats = stream_frame_stats();
+    if (stats.failures != 0 || (!persistent && stats.orphans != 1)) {
+        fprintf(stderr,
+                "Error: %s: write after a full lap: "
+                "%u orphans, %u failures\n",
+                benchmark, stats.orphans, stats.failures);
+        exit(1);
+    }
+}
+
+// Write a marker, and then enough in the same frame that the buffer wraps
+// around. The marker must still be there, since draws using it may not have
+// been submitted yet.
+static void check_wrap(const char *benchmark, bool persistent) {
+    static unsigned char marker[CHUNK], readback[CHUNK];
+    memset(marker, 0xa5, sizeof(marker));
+    struct stream_range range = write_data(marker);
+    // The frame is exactly one buffer long, and does not start at the start of
+    // the buffer, so it wraps.
+    for (int i = 1; i < STREAM_SIZE / CHUNK; i++) {
+        write_chunk();
+    }
+    glstate_bind_buffer(GL_COPY_READ_BUFFER, range.buffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, range.offset, CHUNK, readback);
+    stream_end_frame();
+    struct stream_stats stats = stream_frame_stats();
+    if (memcmp(marker, readback, CHUNK) != 0 ||
+        (!persistent && stats.orphans != 1)) {
+        fprintf(stderr,
+                "Error: %s: data lost when wrapping within a frame: "
+                "%u orphans\n",
+                benchmark, stats.orphans);
+        exit(1);
+    }
+}
+
+static void run(const char *benchmark, bool persistent) {
+    // Start with a new buffer, so the first lap starts at the beginning.
+    stream_term();
+    stream_set_persistent(persistent);
+    memset(chunk, 0x5a, sizeof(chunk));
+    check_lap(benchmark, persistent);
+    check_wrap(benchmark, persistent);
+    unsigned stalls = 0, orphans = 0;
+    glFinish();
+    double t0 = bench_now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        for (int i = 0; i < FRAME_BYTES / CHUNK; i++) {
+            write_chunk();
+        }
+        stream_end_frame();
+        struct stream_stats stats = stream_frame_stats();
+        stalls += stats.stalls;
+        orphans += stats.orphans;
+    }
+    glFinish();
+    double elapsed = bench_now() - t0;
+    bench_report(benchmark, "throughput",
+                 (double)FRAME_BYTES * FRAMES / elapsed / (1 << 20), "MiB/s");
+    bench_report(benchmark, "stalls", stalls, "");
+    bench_report(benchmark, "orphans", orphans, "");
+    stream_term();
+}
+
+void bench_stream(void) {
+    if (!bench_gl_start()) {
+        return;
+    }
+    run("stream_persistent", true);
+    run("stream_orphan", false);
+    stream_set_persistent(true);
+    bench_gl_stop();
+}
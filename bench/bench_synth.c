@@ -0,0 +1,57 @@
+// bench_synth.c - Synthesizer benchmark.
+#include "bench/bench.h"
+
+#include "tcm/synth.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+    // Length of audio rendered for each measurement, in frames.
+    FRAMES = SYNTH_RATE * 10,
+    // Frames rendered per call, matching the audio thread.
+    CHUNK = 256,
+};
+
+static const struct synth_instrument INSTRUMENT = {
+    .saw = 0.5f,
+    .square = 0.3f,
+    .noise = 0.1f,
+    .attack = 0.01f,
+    .decay = 0.5f,
+    .sustain = 0.5f,
+    .release = 0.1f,
+    .cutoff = 2000.0f,
+    .env_cutoff = 1.0f,
+    .resonance = 0.5f,
+};
+
+void bench_synth(void) {
+    static float buf[CHUNK * 2];
+    for (int voices = 4; voices <= SYNTH_MAX_VOICES; voices *= 2) {
+        struct synth *s = synth_new();
+        if (s == NULL) {
+            fputs("Error: No memory\n", stderr);
+            exit(1);
+        }
+        for (int i = 0; i < voices; i++) {
+            synth_note_on(s, &(struct synth_note){
+                                 .instrument = &INSTRUMENT,
+                                 .pitch = 36.0f + i,
+                                 .velocity = 0.5f,
+                                 .duration = FRAMES * 2,
+                             });
+        }
+        double t0 = bench_now();
+        for (int pos = 0; pos < FRAMES; pos += CHUNK) {
+            synth_render(s, buf, CHUNK);
+        }
+        double elapsed = bench_now() - t0;
+        double realtime = (double)FRAMES / SYNTH_RATE / elapsed;
+        char metric[32];
+        snprintf(metric, sizeof(metric), "%d voices", voices);
+        bench_report("synth", metric, realtime, "x realtime");
+        bench_report("synth", metric, realtime * voices, "voices/core");
+        synth_free(s);
+    }
+}
@@ -0,0 +1,51 @@
+// Run performance benchmarks. With no arguments, runs every benchmark.
+// Otherwise, runs the benchmarks named on the command line.
+#include "bench/bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const struct benchmark BENCHMARKS[] = {
+    {"synth", "Synthesizer voices per core", bench_synth},
+    {"audio_clock", "Audio clock with the null sink", bench_audio_clock},
+    {"particles_cpu", "Particle simulation on the CPU", bench_particles_cpu},
+    {"particles_gpu", "Particle simulation on the GPU", bench_particles_gpu},
+    {"lsystem", "L-system curve generation", bench_lsystem},
+    {"math", "Vector math kernels, SIMD and scalar", bench_math},
+    {"dragons", "Instanced curves versus one draw per curve", bench_dragons},
+    {"stream", "Streaming buffer uploads", bench_stream},
+};
+
+enum {
+    NBENCHMARKS = sizeof(BENCHMARKS) / sizeof(*BENCHMARKS),
+};
+
+static void usage(void) {
+    fputs("Usage: bench [<benchmark>...]\n\nBenchmarks:\n", stderr);
+    for (int i = 0; i < NBENCHMARKS; i++) {
+        fprintf(stderr, "  %-14s %s\n", BENCHMARKS[i].name,
+                BENCHMARKS[i].description);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc <= 1) {
+        for (int i = 0; i < NBENCHMARKS; i++) {
+            BENCHMARKS[i].run();
+        }
+        return 0;
+    }
+    for (int j = 1; j < argc; j++) {
+        int i = 0;
+        while (i < NBENCHMARKS && strcmp(BENCHMARKS[i].name, argv[j]) != 0) {
+            i++;
+        }
+        if (i == NBENCHMARKS) {
+            fprintf(stderr, "Error: Unknown benchmark: %s\n", argv[j]);
+            usage();
+            return 2;
+        }
+        BENCHMARKS[i].run();
+    }
+    return 0;
+}
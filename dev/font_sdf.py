@@ -0,0 +1,239 @@
+"""Convert a bitmap font into a signed distance field atlas.
+
+Usage: font_sdf --out-cpp=<file.cpp> --out-hpp=<file.hpp> [options] <font>
+
+The font is a PSF1 or PSF2 console font, or a binary PGM image (P5) with the
+glyphs in a grid of 16 columns, where --cell gives the size of each glyph in
+pixels and pixels brighter than half are set.
+
+Each font pixel is treated as a square, and the atlas stores the distance from
+the center of each texel to the edge of the glyph, in font pixels, mapped so 0.5
+is on the edge, larger values are inside, and the values reach 0 and 1 at
+--spread pixels from the edge. Each glyph is padded by the spread on every side,
+so the distance is correct where the glyph is sampled, and the glyphs are laid
+out in 16 columns. A single atlas can be drawn at any size: the edge is found by
+thresholding at 0.5, and stays sharp when magnified.
+
+The header defines, in namespace tcm:
+
+    const int FontAtlasWidth, FontAtlasHeight;   // Atlas size, in texels.
+    const int FontAtlasColumns;                  // Glyphs per row.
+    const int FontGlyphCount;
+    const int FontCellWidth, FontCellHeight;     // Glyph size, in font pixels.
+    const int FontTexelsPerPixel;
+    const int FontPadding;                       // Padding, in font pixels.
+    extern const unsigned char FontAtlasData[N]; // R8 texels, rows from top.
+"""
+import argparse
+import math
+import os
+import struct
+import sys
+
+HEADER = '// This file is automatically generated.\n'
+
+COLUMNS = 16
+PSF1_MAGIC = b'\x36\x04'
+PSF2_MAGIC = b'\x72\xb5\x4a\x86'
+PSF1_MODE512 = 0x01
+
+def die(msg):
+    print('Error: {}'.format(msg), file=sys.stderr)
+    sys.exit(1)
+
+class Font:
+    """A bitmap font: a list of glyphs, each a list of rows of booleans."""
+    def __init__(self, width, height, glyphs):
+        self.width = width
+        self.height = height
+        self.glyphs = glyphs
+
+def read_psf(data):
+    if data.startswith(PSF1_MAGIC):
+        if len(data) < 4:
+            die('invalid PSF1 font')
+        mode, height = data[2], data[3]
+        count = 512 if mode & PSF1_MODE512 else 256
+        width = 8
+        offset = 4
+    else:
+        if len(data) < 32:
+            die('invalid PSF2 font')
+        (version, offset, _flags, count, _size, height,
+         width) = struct.unpack_from('<7I', data, 4)
+        if version != 0:
+            die('unknown PSF2 version: {}'.format(version))
+    stride = (width + 7) // 8
+    if offset + stride * height * count > len(data):
+        die('font is truncated')
+    glyphs = []
+    for i in range(count):
+        rows = []
+        for y in range(height):
+            pos = offset + (i * height + y) * stride
+            bits = int.from_bytes(data[pos:pos+stride], 'big')
+            rows.append([(bits >> (stride * 8 - 1 - x)) & 1 != 0
+                         for x in range(width)])
+        glyphs.append(rows)
+    return Font(width, height, glyphs)
+
+def read_pgm(data, cell):
+    # Header: magic, width, height, maxval, separated by whitespace, which may
+    # contain comments.
+    fields = []
+    pos = 2
+    while len(fields) < 3:
+        while pos < len(data) and data[pos:pos+1].isspace():
+            pos += 1
+        if data[pos:pos+1] == b'#':
+            while pos < len(data) and data[pos:pos+1] != b'\n':
+                pos += 1
+            continue
+        start = pos
+        while pos < len(data) and data[pos:pos+1].isdigit():
+            pos += 1
+        if start == pos:
+            die('invalid PGM header')
+        fields.append(int(data[start:pos]))
+    pos += 1
+    width, height, maxval = fields
+    if maxval > 255:
+        die('16-bit PGM images are not supported')
+    if pos + width * height > len(data):
+        die('PGM image is truncated')
+    if cell is None:
+        die('--cell is required for PGM images')
+    cw, ch = cell
+    if width != cw * COLUMNS or height % ch != 0:
+        die('PGM image must be {} glyphs wide'.format(COLUMNS))
+    glyphs = []
+    for i in range(COLUMNS * (height // ch)):
+        x0 = (i % COLUMNS) * cw
+        y0 = (i // COLUMNS) * ch
+        glyphs.append([[data[pos + (y0 + y) * width + x0 + x] * 2 > maxval
+                        for x in range(cw)] for y in range(ch)])
+    return Font(cw, ch, glyphs)
+
+def read_font(path, cell):
+    with open(path, 'rb') as fp:
+        data = fp.read()
+    if data.startswith(PSF1_MAGIC) or data.startswith(PSF2_MAGIC):
+        return read_psf(data)
+    if data.startswith(b'P5'):
+        return read_pgm(data, cell)
+    die('unknown font format: {}'.format(path))
+
+def glyph_field(font, glyph, scale, padding, spread):
+    """Compute the distance field for one glyph, as rows of bytes."""
+    w, h = font.width, font.height
+    size_x = (w + 2 * padding) * scale
+    size_y = (h + 2 * padding) * scale
+    if not any(any(row) for row in glyph):
+        return [bytes(size_x)] * size_y
+    def pixel(x, y):
+        return 0 <= x < w and 0 <= y < h and glyph[y][x]
+    # Only squares within this many pixels can be closer than the spread.
+    reach = int(math.ceil(spread)) + 1
+    rows = []
+    for ty in range(size_y):
+        py = (ty + 0.5) / scale - padding
+        row = bytearray(size_x)
+        for tx in range(size_x):
+            px = (tx + 0.5) / scale - padding
+            ix, iy = math.floor(px), math.floor(py)
+            inside = pixel(ix, iy)
+            # Distance to the nearest square of the other kind.
+            best = spread * spread
+            for y in range(iy - reach, iy + reach + 1):
+                dy = max(y - py, 0.0, py - y - 1)
+                if dy * dy >= best:
+                    continue
+                for x in range(ix - reach, ix + reach + 1):
+                    if pixel(x, y) == inside:
+                        continue
+                    dx = max(x - px, 0.0, px - x - 1)
+                    best = min(best, dx * dx + dy * dy)
+            dist = math.sqrt(best)
+            if not inside:
+                dist = -dist
+            value = 0.5 + 0.5 * dist / spread
+            row[tx] = max(0, min(255, int(round(value * 255))))
+        rows.append(bytes(row))
+    return rows
+
+def write_hpp(fp, values, data):
+    fp.write(HEADER)
+    fp.write('#pragma once\n\nnamespace tcm {\n\n')
+    for name, value in values:
+        fp.write('const int {} = {};\n'.format(name, value))
+    fp.write('extern const unsigned char FontAtlasData[{}];\n'
+             .format(len(data)))
+    fp.write('\n} // namespace tcm\n')
+
+def write_cpp(fp, hpp, data):
+    fp.write(HEADER)
+    fp.write('#include "{}"\n\nnamespace tcm {{\n\n'.format(hpp))
+    fp.write('const unsigned char FontAtlasData[{}] = {{\n'.format(len(data)))
+    for i in range(0, len(data), 16):
+        fp.write(''.join('{},'.format(b) for b in data[i:i+16]))
+        fp.write('\n')
+    fp.write('};\n\n} // namespace tcm\n')
+
+def parse_cell(text):
+    try:
+        w, h = text.split('x')
+        return int(w), int(h)
+    except ValueError:
+        raise argparse.ArgumentTypeError('expected WxH: {!r}'.format(text))
+
+def main():
+    p = argparse.ArgumentParser('font_sdf')
+    p.add_argument('--out-cpp', help='Output C++ file', required=True)
+    p.add_argument('--out-hpp', help='Output header file', required=True)
+    p.add_argument('--include', help='Path of the header, for #include')
+    p.add_argument('--cell', type=parse_cell,
+                   help='Glyph size for PGM images, as WxH')
+    p.add_argument('--count', type=int, default=256,
+                   help='Maximum number of glyphs')
+    p.add_argument('--scale', type=int, default=3,
+                   help='Atlas texels per font pixel')
+    p.add_argument('--spread', type=float, default=1.0,
+                   help='Distance range, in font pixels')
+    p.add_argument('font', help='Input font')
+    args = p.parse_args()
+
+    font = read_font(args.font, args.cell)
+    glyphs = font.glyphs[:args.count]
+    padding = int(math.ceil(args.spread))
+    cell_x = (font.width + 2 * padding) * args.scale
+    cell_y = (font.height + 2 * padding) * args.scale
+    rows = (len(glyphs) + COLUMNS - 1) // COLUMNS
+    width = cell_x * COLUMNS
+    height = cell_y * rows
+    atlas = bytearray(width * height)
+    for i, glyph in enumerate(glyphs):
+        field = glyph_field(font, glyph, args.scale, padding, args.spread)
+        x0 = (i % COLUMNS) * cell_x
+        y0 = (i // COLUMNS) * cell_y
+        for y, row in enumerate(field):
+            pos = (y0 + y) * width + x0
+            atlas[pos:pos+cell_x] = row
+
+    values = [
+        ('FontAtlasWidth', width),
+        ('FontAtlasHeight', height),
+        ('FontAtlasColumns', COLUMNS),
+        ('FontGlyphCount', len(glyphs)),
+        ('FontCellWidth', font.width),
+        ('FontCellHeight', font.height),
+        ('FontTexelsPerPixel', args.scale),
+        ('FontPadding', padding),
+    ]
+    include = args.include or os.path.basename(args.out_hpp)
+    with open(args.out_hpp, 'w') as fp:
+        write_hpp(fp, values, atlas)
+    with open(args.out_cpp, 'w') as fp:
+        write_cpp(fp, include, atlas)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,917 @@
+// glcapture.cpp - Capture the OpenGL calls for a frame.
+//
+// Calls are recorded by the tracing layer in gltrace.cpp. When the frame ends,
+// the capture records the contents of every object the calls refer to, so the
+// frame can be run again in a loop: the objects are recreated, the state at the
+// start of the frame is restored, and the calls are issued again.
+//
+// Objects are saved as they are at the end of the frame, not the start, so the
+// data written to buffers during the frame, including data written to
+// persistently mapped buffers, is available to the replay. Repeating the frame
+// leaves the objects in the same state each time.
+#include "dev/glcapture.hpp"
+
+#include "dev/log.hpp"
+#include "dev/path.hpp"
+#include "tcm/glstate.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace tcm {
+
+namespace {
+
+// Template for capture files.
+PathTemplate path_template{"captures", "frame", ".glcap"};
+
+// A sequence of bytes in the capture file format.
+class Writer {
+public:
+    template <typename T>
+    void Put(T value) {
+        const char *ptr = reinterpret_cast<const char *>(&value);
+        data_.insert(data_.end(), ptr, ptr + sizeof(T));
+    }
+
+    void PutBytes(const void *data, size_t size) {
+        const char *ptr = static_cast<const char *>(data);
+        data_.insert(data_.end(), ptr, ptr + size);
+    }
+
+    void PutString(const std::string &str) {
+        Put<uint32_t>(str.size());
+        PutBytes(str.data(), str.size());
+    }
+
+    const std::vector<char> &data() const { return data_; }
+
+private:
+    std::vector<char> data_;
+};
+
+// A sequence of calls.
+struct CallList {
+    Writer data;
+    uint32_t count;
+};
+
+// A buffer mapped during the frame.
+struct Mapping {
+    GLenum target;
+    char *ptr;
+    size_t size;
+};
+
+bool requested;
+bool capturing;
+int capture_width;
+int capture_height;
+CallList setup;
+CallList frame;
+std::vector<Mapping> mappings;
+// The arguments of the last call to glMapBuffer or glMapBufferRange.
+Mapping pending_map;
+
+// Objects referred to by the calls, which are saved with the capture.
+std::set<GLuint> buffers;
+std::set<GLuint> textures;
+std::set<GLuint> vertex_arrays;
+std::set<GLuint> programs;
+std::set<GLuint> framebuffers;
+
+// Functions which were left out of the capture with a warning.
+std::set<Func> warned;
+
+void AddObject(ArgType type, GLuint name) {
+    if (name == 0) {
+        return;
+    }
+    switch (type) {
+    case ArgType::Buffer:
+        buffers.insert(name);
+        break;
+    case ArgType::Texture:
+        textures.insert(name);
+        break;
+    case ArgType::VertexArray:
+        vertex_arrays.insert(name);
+        break;
+    case ArgType::Program:
+        programs.insert(name);
+        break;
+    case ArgType::Framebuffer:
+        framebuffers.insert(name);
+        break;
+    default:
+        break;
+    }
+}
+
+// Return the number of bytes in each pixel with the given format and type.
+size_t PixelSize(GLenum format, GLenum type) {
+    switch (type) {
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_24_8:
+        return 4;
+    default:
+        break;
+    }
+    size_t size;
+    switch (type) {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:
+        size = 1;
+        break;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+        size = 2;
+        break;
+    default:
+        size = 4;
+        break;
+    }
+    switch (format) {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+        return size;
+    case GL_RG:
+    case GL_RG_INTEGER:
+        return size * 2;
+    case GL_RGB:
+    case GL_BGR:
+        return size * 3;
+    default:
+        return size * 4;
+    }
+}
+
+// Return the number of bytes read from client memory by a pixel upload, using
+// the current unpack parameters.
+size_t UploadSize(GLenum format, GLenum type, GLsizei width, GLsizei height) {
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+    GLint alignment, row_length;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &row_length);
+    size_t pixel = PixelSize(format, type);
+    size_t row = (row_length > 0 ? row_length : width) * pixel;
+    row = (row + alignment - 1) / alignment * alignment;
+    return row * (height - 1) + width * pixel;
+}
+
+// Return true if a buffer is bound to the given target.
+bool BufferBound(GLenum binding) {
+    GLint buffer;
+    glGetIntegerv(binding, &buffer);
+    return buffer != 0;
+}
+
+template <typename T>
+T Arg(const uint64_t *args, int index) {
+    T value;
+    std::memcpy(&value, &args[index], sizeof(T));
+    return value;
+}
+
+// Get the data which a call reads from client memory, or return false if it
+// does not read any.
+bool GetPayload(Func func, const uint64_t *args, const void **data,
+                size_t *size) {
+    int arg = FuncPayloadArg(func);
+    if (arg >= 0) {
+        *data = Arg<const void *>(args, arg);
+    }
+    switch (func) {
+    case kBufferData:
+    case kBufferStorage:
+        *size = Arg<GLsizeiptr>(args, 1);
+        return *data != nullptr;
+    case kBufferSubData:
+        *size = Arg<GLsizeiptr>(args, 2);
+        return true;
+    case kUniform2fv:
+        *size = Arg<GLsizei>(args, 1) * 2 * sizeof(GLfloat);
+        return true;
+    case kUniform4fv:
+        *size = Arg<GLsizei>(args, 1) * 4 * sizeof(GLfloat);
+        return true;
+    case kUniformMatrix4fv:
+        *size = Arg<GLsizei>(args, 1) * 16 * sizeof(GLfloat);
+        return true;
+    case kMultiDrawArrays:
+        *size = Arg<GLsizei>(args, 3) * (sizeof(GLint) + sizeof(GLsizei));
+        return true;
+    case kReadPixels:
+        // The replay needs somewhere to put the pixels, but not the contents.
+        if (BufferBound(GL_PIXEL_PACK_BUFFER_BINDING)) {
+            return false;
+        }
+        *data = nullptr;
+        *size = PixelSize(Arg<GLenum>(args, 4), Arg<GLenum>(args, 5)) *
+                Arg<GLsizei>(args, 2) * Arg<GLsizei>(args, 3);
+        return true;
+    case kTexImage2D:
+    case kTexSubImage2D:
+        if (*data == nullptr ||
+            BufferBound(GL_PIXEL_UNPACK_BUFFER_BINDING)) {
+            return false;
+        }
+        if (func == kTexImage2D) {
+            *size = UploadSize(Arg<GLenum>(args, 6), Arg<GLenum>(args, 7),
+                               Arg<GLsizei>(args, 3), Arg<GLsizei>(args, 4));
+        } else {
+            *size = UploadSize(Arg<GLenum>(args, 6), Arg<GLenum>(args, 7),
+                               Arg<GLsizei>(args, 4), Arg<GLsizei>(args, 5));
+        }
+        return true;
+    case kUnmapBuffer: {
+        GLenum target = Arg<GLenum>(args, 0);
+        for (auto it = mappings.begin(); it != mappings.end(); ++it) {
+            if (it->target == target) {
+                *data = it->ptr;
+                *size = it->size;
+                mappings.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+    default:
+        return false;
+    }
+}
+
+// Append a call to a list.
+void AddCall(CallList *list, Func func, const uint64_t *args, int nargs) {
+    Writer &w = list->data;
+    w.Put<uint16_t>(func);
+    w.Put<uint8_t>(nargs);
+    for (int i = 0; i < nargs; i++) {
+        w.Put<uint64_t>(args[i]);
+        AddObject(FuncArg(func, i), Arg<GLuint>(args, i));
+    }
+    const void *data = nullptr;
+    size_t size = 0;
+    if (!GetPayload(func, args, &data, &size)) {
+        w.Put<uint8_t>(0);
+    } else {
+        w.Put<uint8_t>(1);
+        w.Put<uint32_t>(size);
+        if (func == kMultiDrawArrays) {
+            // Both arrays, one after the other.
+            size_t count = Arg<GLsizei>(args, 3);
+            w.PutBytes(data, count * sizeof(GLint));
+            w.PutBytes(Arg<const GLsizei *>(args, 2), count * sizeof(GLsizei));
+        } else if (data != nullptr) {
+            w.PutBytes(data, size);
+        } else {
+            w.PutBytes(std::vector<char>(size).data(), size);
+        }
+    }
+    list->count++;
+}
+
+// Append a call to the setup list.
+template <typename... A>
+void AddSetup(Func func, A... args) {
+    const uint64_t slots[] = {GLCaptureSlot(args)..., 0};
+    AddCall(&setup, func, slots, sizeof...(A));
+}
+
+GLint GetInt(GLenum pname) {
+    GLint value;
+    glGetIntegerv(pname, &value);
+    return value;
+}
+
+// Record calls which restore the current state.
+void SaveState() {
+    static const GLenum caps[] = {
+        GL_BLEND,
+        GL_CULL_FACE,
+        GL_DEPTH_TEST,
+        GL_FRAMEBUFFER_SRGB,
+        GL_MULTISAMPLE,
+        GL_PROGRAM_POINT_SIZE,
+        GL_RASTERIZER_DISCARD,
+        GL_SCISSOR_TEST,
+        GL_STENCIL_TEST,
+    };
+    for (GLenum cap : caps) {
+        AddSetup(glIsEnabled(cap) ? kEnable : kDisable, cap);
+    }
+    AddSetup(kBlendFuncSeparate, GLenum(GetInt(GL_BLEND_SRC_RGB)),
+             GLenum(GetInt(GL_BLEND_DST_RGB)),
+             GLenum(GetInt(GL_BLEND_SRC_ALPHA)),
+             GLenum(GetInt(GL_BLEND_DST_ALPHA)));
+    AddSetup(kDepthFunc, GLenum(GetInt(GL_DEPTH_FUNC)));
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    AddSetup(kViewport, viewport[0], viewport[1], GLsizei(viewport[2]),
+             GLsizei(viewport[3]));
+    GLfloat color[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, color);
+    AddSetup(kClearColor, color[0], color[1], color[2], color[3]);
+    static const GLenum pixel_store[] = {
+        GL_PACK_ALIGNMENT,
+        GL_UNPACK_ALIGNMENT,
+        GL_UNPACK_ROW_LENGTH,
+    };
+    for (GLenum pname : pixel_store) {
+        AddSetup(kPixelStorei, pname, GetInt(pname));
+    }
+    AddSetup(kBindFramebuffer, GLenum(GL_DRAW_FRAMEBUFFER),
+             GLuint(GetInt(GL_DRAW_FRAMEBUFFER_BINDING)));
+    AddSetup(kBindFramebuffer, GLenum(GL_READ_FRAMEBUFFER),
+             GLuint(GetInt(GL_READ_FRAMEBUFFER_BINDING)));
+    AddSetup(kUseProgram, GLuint(GetInt(GL_CURRENT_PROGRAM)));
+    AddSetup(kBindVertexArray, GLuint(GetInt(GL_VERTEX_ARRAY_BINDING)));
+
+    // Indexed bindings also change the generic binding, so they go first.
+    struct Indexed {
+        GLenum target, binding, start, size, max;
+    };
+    static const Indexed indexed[] = {
+        {GL_UNIFORM_BUFFER, GL_UNIFORM_BUFFER_BINDING, GL_UNIFORM_BUFFER_START,
+         GL_UNIFORM_BUFFER_SIZE, GL_MAX_UNIFORM_BUFFER_BINDINGS},
+        {GL_TRANSFORM_FEEDBACK_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER_BINDING,
+         GL_TRANSFORM_FEEDBACK_BUFFER_START, GL_TRANSFORM_FEEDBACK_BUFFER_SIZE,
+         GL_MAX_TRANSFORM_FEEDBACK_SEPARATE_ATTRIBS},
+    };
+    for (const Indexed &ix : indexed) {
+        GLint max = GetInt(ix.max);
+        for (GLint i = 0; i < max; i++) {
+            GLint buffer;
+            glGetIntegeri_v(ix.binding, i, &buffer);
+            if (buffer == 0) {
+                continue;
+            }
+            GLint64 start, size;
+            glGetInteger64i_v(ix.start, i, &start);
+            glGetInteger64i_v(ix.size, i, &size);
+            if (size == 0) {
+                AddSetup(kBindBufferBase, ix.target, GLuint(i),
+                         GLuint(buffer));
+            } else {
+                AddSetup(kBindBufferRange, ix.target, GLuint(i),
+                         GLuint(buffer), GLintptr(start), GLsizeiptr(size));
+            }
+        }
+    }
+    static const GLenum targets[][2] = {
+        {GL_ARRAY_BUFFER, GL_ARRAY_BUFFER_BINDING},
+        {GL_COPY_READ_BUFFER, GL_COPY_READ_BUFFER_BINDING},
+        {GL_COPY_WRITE_BUFFER, GL_COPY_WRITE_BUFFER_BINDING},
+        {GL_PIXEL_PACK_BUFFER, GL_PIXEL_PACK_BUFFER_BINDING},
+        {GL_PIXEL_UNPACK_BUFFER, GL_PIXEL_UNPACK_BUFFER_BINDING},
+        {GL_TRANSFORM_FEEDBACK_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER_BINDING},
+        {GL_UNIFORM_BUFFER, GL_UNIFORM_BUFFER_BINDING},
+    };
+    for (const auto &t : targets) {
+        AddSetup(kBindBuffer, t[0], GLuint(GetInt(t[1])));
+    }
+
+    GLenum active = GetInt(GL_ACTIVE_TEXTURE);
+    for (int unit = 0; unit < GLSTATE_TEXTURE_UNITS; unit++) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        AddSetup(kActiveTexture, GLenum(GL_TEXTURE0 + unit));
+        AddSetup(kBindTexture, GLenum(GL_TEXTURE_2D),
+                 GLuint(GetInt(GL_TEXTURE_BINDING_2D)));
+    }
+    glActiveTexture(active);
+    AddSetup(kActiveTexture, active);
+}
+
+void SaveBuffers(Writer *w) {
+    std::vector<char> data;
+    w->Put<uint32_t>(buffers.size());
+    for (GLuint buffer : buffers) {
+        w->Put<uint32_t>(buffer);
+        GLint usage = GL_STATIC_DRAW;
+        GLint64 size = 0;
+        if (glIsBuffer(buffer)) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_USAGE,
+                                   &usage);
+            glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE,
+                                     &size);
+        }
+        data.resize(size);
+        if (size != 0) {
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, data.data());
+        }
+        w->Put<uint32_t>(usage);
+        w->Put<uint64_t>(size);
+        w->PutBytes(data.data(), data.size());
+    }
+}
+
+// Choose the format for reading the contents of a texture.
+void TextureReadFormat(GLint internal, GLenum *format, GLenum *type) {
+    switch (internal) {
+    case GL_R8:
+    case GL_RED:
+        *format = GL_RED;
+        *type = GL_UNSIGNED_BYTE;
+        break;
+    case GL_RG8:
+    case GL_RG:
+        *format = GL_RG;
+        *type = GL_UNSIGNED_BYTE;
+        break;
+    case GL_RGB8:
+    case GL_RGB:
+    case GL_SRGB8:
+        *format = GL_RGB;
+        *type = GL_UNSIGNED_BYTE;
+        break;
+    case GL_RGBA8:
+    case GL_RGBA:
+    case GL_SRGB8_ALPHA8:
+        *format = GL_RGBA;
+        *type = GL_UNSIGNED_BYTE;
+        break;
+    case GL_R16F:
+    case GL_R32F:
+        *format = GL_RED;
+        *type = GL_FLOAT;
+        break;
+    case GL_RG16F:
+    case GL_RG32F:
+        *format = GL_RG;
+        *type = GL_FLOAT;
+        break;
+    case GL_RGB16F:
+    case GL_RGB32F:
+    case GL_R11F_G11F_B10F:
+        *format = GL_RGB;
+        *type = GL_FLOAT;
+        break;
+    case GL_DEPTH_COMPONENT:
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+        *format = GL_DEPTH_COMPONENT;
+        *type = GL_FLOAT;
+        break;
+    case GL_DEPTH24_STENCIL8:
+        *format = GL_DEPTH_STENCIL;
+        *type = GL_UNSIGNED_INT_24_8;
+        break;
+    default:
+        *format = GL_RGBA;
+        *type = GL_FLOAT;
+        break;
+    }
+}
+
+// Save textures. Only 2D textures are supported.
+void SaveTextures(Writer *w) {
+    static const GLenum params[] = {
+        GL_TEXTURE_BASE_LEVEL, GL_TEXTURE_MAX_LEVEL, GL_TEXTURE_MIN_FILTER,
+        GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S,    GL_TEXTURE_WRAP_T,
+    };
+    std::vector<char> data;
+    w->Put<uint32_t>(textures.size());
+    for (GLuint texture : textures) {
+        w->Put<uint32_t>(texture);
+        if (!glIsTexture(texture)) {
+            w->Put<uint32_t>(0);
+            w->Put<uint32_t>(0);
+            continue;
+        }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        w->Put<uint32_t>(sizeof(params) / sizeof(*params));
+        for (GLenum pname : params) {
+            GLint value;
+            glGetTexParameteriv(GL_TEXTURE_2D, pname, &value);
+            w->Put<uint32_t>(pname);
+            w->Put<int32_t>(value);
+        }
+        std::vector<int> levels;
+        for (int level = 0; level < 16; level++) {
+            GLint width;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH,
+                                     &width);
+            if (width == 0) {
+                break;
+            }
+            levels.push_back(level);
+        }
+        w->Put<uint32_t>(levels.size());
+        for (int level : levels) {
+            GLint internal, width, height;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level,
+                                     GL_TEXTURE_INTERNAL_FORMAT, &internal);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH,
+                                     &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT,
+                                     &height);
+            GLenum format, type;
+            TextureReadFormat(internal, &format, &type);
+            data.resize(PixelSize(format, type) * width * height);
+            glGetTexImage(GL_TEXTURE_2D, level, format, type, data.data());
+            w->Put<int32_t>(internal);
+            w->Put<int32_t>(width);
+            w->Put<int32_t>(height);
+            w->Put<uint32_t>(format);
+            w->Put<uint32_t>(type);
+            w->Put<uint64_t>(data.size());
+            w->PutBytes(data.data(), data.size());
+        }
+    }
+}
+
+// Save the uniform values of a program.
+void SaveUniforms(Writer *w, GLuint program) {
+    GLint count = 0, max_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    std::vector<char> buf(max_length + 16);
+    Writer uniforms;
+    uint32_t n = 0;
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, i, buf.size(), nullptr, &size, &type,
+                           buf.data());
+        UniformFormat fmt = GetUniformFormat(type);
+        std::string name{buf.data()};
+        if (fmt.components == 0) {
+            if (glGetUniformLocation(program, name.c_str()) != -1) {
+                Warning("Capture: Uniform %s has unsupported type 0x%04x",
+                        name.c_str(), type);
+            }
+            continue;
+        }
+        // Each element of an array has its own location.
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            name.resize(name.size() - 3);
+        } else {
+            size = 0;
+        }
+        for (GLint j = 0; j < std::max(size, 1); j++) {
+            std::string elt = size == 0
+                                  ? name
+                                  : name + "[" + std::to_string(j) + "]";
+            GLint location = glGetUniformLocation(program, elt.c_str());
+            if (location == -1) {
+                // Uniforms in blocks have no location.
+                continue;
+            }
+            uint32_t value[16];
+            switch (fmt.kind) {
+            case UniformFormat::Float:
+                glGetUniformfv(program, location,
+                               reinterpret_cast<GLfloat *>(value));
+                break;
+            case UniformFormat::Int:
+                glGetUniformiv(program, location,
+                               reinterpret_cast<GLint *>(value));
+                break;
+            case UniformFormat::UInt:
+                glGetUniformuiv(program, location, value);
+                break;
+            }
+            uniforms.PutString(elt);
+            uniforms.Put<int32_t>(location);
+            uniforms.Put<uint32_t>(type);
+            uniforms.Put<uint32_t>(fmt.components * 4);
+            uniforms.PutBytes(value, fmt.components * 4);
+            n++;
+        }
+    }
+    w->Put<uint32_t>(n);
+    w->PutBytes(uniforms.data().data(), uniforms.data().size());
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH,
+                   &max_length);
+    buf.resize(max_length + 1);
+    w->Put<uint32_t>(count);
+    for (GLint i = 0; i < count; i++) {
+        glGetActiveUniformBlockName(program, i, buf.size(), nullptr,
+                                    buf.data());
+        GLint binding;
+        glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING,
+                                  &binding);
+        w->PutString(buf.data());
+        w->Put<uint32_t>(binding);
+    }
+}
+
+// Save programs, with the source code of their shaders, so they can be linked
+// again with the same inputs and outputs.
+void SavePrograms(Writer *w) {
+    w->Put<uint32_t>(programs.size());
+    for (GLuint program : programs) {
+        w->Put<uint32_t>(program);
+        GLint count = 0;
+        glGetProgramiv(program, GL_ATTACHED_SHADERS, &count);
+        std::vector<GLuint> shaders(count);
+        glGetAttachedShaders(program, count, &count, shaders.data());
+        w->Put<uint32_t>(count);
+        for (GLint i = 0; i < count; i++) {
+            GLint type, length;
+            glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+            glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length);
+            std::vector<char> source(length + 1);
+            glGetShaderSource(shaders[i], source.size(), nullptr,
+                              source.data());
+            w->Put<uint32_t>(type);
+            w->PutString(source.data());
+        }
+
+        GLint max_length = 0;
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+        std::vector<char> buf(max_length + 1);
+        w->Put<uint32_t>(count);
+        for (GLint i = 0; i < count; i++) {
+            GLint size;
+            GLenum type;
+            glGetActiveAttrib(program, i, buf.size(), nullptr, &size, &type,
+                              buf.data());
+            w->PutString(buf.data());
+            w->Put<int32_t>(glGetAttribLocation(program, buf.data()));
+        }
+
+        GLint mode = GL_INTERLEAVED_ATTRIBS;
+        glGetProgramiv(program, GL_TRANSFORM_FEEDBACK_BUFFER_MODE, &mode);
+        glGetProgramiv(program, GL_TRANSFORM_FEEDBACK_VARYINGS, &count);
+        glGetProgramiv(program, GL_TRANSFORM_FEEDBACK_VARYING_MAX_LENGTH,
+                       &max_length);
+        buf.resize(max_length + 1);
+        w->Put<uint32_t>(mode);
+        w->Put<uint32_t>(count);
+        for (GLint i = 0; i < count; i++) {
+            GLsizei size;
+            GLenum type;
+            glGetTransformFeedbackVarying(program, i, buf.size(), nullptr,
+                                          &size, &type, buf.data());
+            w->PutString(buf.data());
+        }
+
+        SaveUniforms(w, program);
+    }
+}
+
+void SaveVertexArrays(Writer *w) {
+    GLint max_attribs = GetInt(GL_MAX_VERTEX_ATTRIBS);
+    w->Put<uint32_t>(vertex_arrays.size());
+    for (GLuint array : vertex_arrays) {
+        w->Put<uint32_t>(array);
+        if (!glIsVertexArray(array)) {
+            w->Put<uint32_t>(0);
+            w->Put<uint32_t>(0);
+            continue;
+        }
+        glBindVertexArray(array);
+        GLuint element = GetInt(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+        AddObject(ArgType::Buffer, element);
+        w->Put<uint32_t>(element);
+        Writer attribs;
+        uint32_t n = 0;
+        for (GLint i = 0; i < max_attribs; i++) {
+            GLint enabled, size, type, normalized, integer, stride, buffer,
+                divisor;
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING,
+                                &buffer);
+            if (!enabled && buffer == 0) {
+                continue;
+            }
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED,
+                                &normalized);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_DIVISOR, &divisor);
+            void *offset;
+            glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER,
+                                      &offset);
+            AddObject(ArgType::Buffer, buffer);
+            attribs.Put<uint32_t>(i);
+            attribs.Put<uint8_t>(enabled != 0);
+            attribs.Put<int32_t>(size);
+            attribs.Put<uint32_t>(type);
+            attribs.Put<uint8_t>(normalized != 0);
+            attribs.Put<uint8_t>(integer != 0);
+            attribs.Put<int32_t>(stride);
+            attribs.Put<uint64_t>(reinterpret_cast<uintptr_t>(offset));
+            attribs.Put<uint32_t>(buffer);
+            attribs.Put<uint32_t>(divisor);
+            n++;
+        }
+        w->Put<uint32_t>(n);
+        w->PutBytes(attribs.data().data(), attribs.data().size());
+    }
+}
+
+// Save framebuffers. Only texture attachments are supported.
+void SaveFramebuffers(Writer *w) {
+    static const GLenum attachments[] = {
+        GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1,     GL_COLOR_ATTACHMENT2,
+        GL_COLOR_ATTACHMENT3, GL_DEPTH_STENCIL_ATTACHMENT, GL_DEPTH_ATTACHMENT,
+    };
+    w->Put<uint32_t>(framebuffers.size());
+    for (GLuint framebuffer : framebuffers) {
+        w->Put<uint32_t>(framebuffer);
+        if (!glIsFramebuffer(framebuffer)) {
+            w->Put<uint32_t>(0);
+            continue;
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        Writer list;
+        uint32_t n = 0;
+        bool has_depth_stencil = false;
+        for (GLenum attachment : attachments) {
+            GLint type, name, level;
+            glGetFramebufferAttachmentParameteriv(
+                GL_READ_FRAMEBUFFER, attachment,
+                GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+            if (type == GL_NONE ||
+                (attachment == GL_DEPTH_ATTACHMENT && has_depth_stencil)) {
+                continue;
+            }
+            if (type != GL_TEXTURE) {
+                Warning("Capture: Framebuffer %u has an unsupported "
+                        "attachment",
+                        framebuffer);
+                continue;
+            }
+            glGetFramebufferAttachmentParameteriv(
+                GL_READ_FRAMEBUFFER, attachment,
+                GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &name);
+            glGetFramebufferAttachmentParameteriv(
+                GL_READ_FRAMEBUFFER, attachment,
+                GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_LEVEL, &level);
+            has_depth_stencil |= attachment == GL_DEPTH_STENCIL_ATTACHMENT;
+            AddObject(ArgType::Texture, name);
+            list.Put<uint32_t>(attachment);
+            list.Put<uint32_t>(name);
+            list.Put<int32_t>(level);
+            n++;
+        }
+        w->Put<uint32_t>(n);
+        w->PutBytes(list.data().data(), list.data().size());
+    }
+}
+
+void PutCalls(Writer *w, const CallList &list) {
+    w->Put<uint32_t>(list.count);
+    w->PutBytes(list.data.data().data(), list.data.data().size());
+}
+
+// Write the capture to a file.
+void WriteCapture() {
+    // Saving changes bindings and the pixel pack state.
+    GLint read_framebuffer = GetInt(GL_READ_FRAMEBUFFER_BINDING);
+    GLint pack_alignment = GetInt(GL_PACK_ALIGNMENT);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    Writer w;
+    w.PutBytes(GLCaptureMagic, sizeof(GLCaptureMagic));
+    w.Put<uint32_t>(GLCaptureVersion);
+    w.Put<uint32_t>(capture_width);
+    w.Put<uint32_t>(capture_height);
+    // Vertex arrays and framebuffers refer to buffers and textures, so they
+    // are examined first, but they are written after the objects they use.
+    Writer arrays, fbs;
+    SaveVertexArrays(&arrays);
+    SaveFramebuffers(&fbs);
+    SaveBuffers(&w);
+    SaveTextures(&w);
+    SavePrograms(&w);
+    w.PutBytes(arrays.data().data(), arrays.data().size());
+    w.PutBytes(fbs.data().data(), fbs.data().size());
+    PutCalls(&w, setup);
+    PutCalls(&w, frame);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, pack_alignment);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+    glstate_invalidate();
+
+    std::string path = path_template.Create();
+    std::FILE *fp = std::fopen(path.c_str(), "wb");
+    if (fp == nullptr) {
+        ErrorErrno(errno, "%s", path.c_str());
+        return;
+    }
+    const std::vector<char> &data = w.data();
+    size_t amt = std::fwrite(data.data(), 1, data.size(), fp);
+    int ecode = amt == data.size() ? 0 : errno;
+    if (std::fclose(fp) != 0 && ecode == 0) {
+        ecode = errno;
+    }
+    if (ecode != 0) {
+        ErrorErrno(ecode, "%s", path.c_str());
+        return;
+    }
+    Info("Wrote capture %s: %u calls, %.1f KiB", path.c_str(), frame.count,
+         data.size() / 1024.0);
+}
+
+} // namespace
+
+void GLCaptureNextFrame() {
+#if defined __APPLE__
+    Warning("OpenGL call capture is not supported on this platform");
+#else
+    requested = true;
+#endif
+}
+
+void GLCaptureBegin(int width, int height) {
+    if (!requested) {
+        return;
+    }
+    requested = false;
+    capture_width = width;
+    capture_height = height;
+    setup = CallList{};
+    frame = CallList{};
+    mappings.clear();
+    buffers.clear();
+    textures.clear();
+    vertex_arrays.clear();
+    programs.clear();
+    framebuffers.clear();
+    warned.clear();
+    SaveState();
+    capturing = true;
+}
+
+void GLCaptureEnd() {
+    if (!capturing) {
+        return;
+    }
+    capturing = false;
+    if (!mappings.empty()) {
+        Warning("Capture: Buffer still mapped at end of frame");
+    }
+    WriteCapture();
+    setup = CallList{};
+    frame = CallList{};
+}
+
+bool GLCapturing() {
+    return capturing;
+}
+
+void GLCaptureRecord(Func func, const uint64_t *args, int nargs) {
+    switch (FuncCapture(func)) {
+    case CaptureMode::Record:
+        break;
+    case CaptureMode::Skip:
+        return;
+    case CaptureMode::Warn:
+        if (warned.insert(func).second) {
+            Warning("Capture: %s is not recorded, the replay may differ",
+                    FuncName[func]);
+        }
+        return;
+    }
+    switch (func) {
+    case kMapBuffer:
+        pending_map = {Arg<GLenum>(args, 0), nullptr, 0};
+        break;
+    case kMapBufferRange:
+        pending_map = {Arg<GLenum>(args, 0), nullptr,
+                       size_t(Arg<GLsizeiptr>(args, 2))};
+        break;
+    default:
+        break;
+    }
+    AddCall(&frame, func, args, nargs);
+}
+
+void GLCaptureMapped(Func func, void *ptr) {
+    if (func != kMapBuffer && func != kMapBufferRange) {
+        return;
+    }
+    if (ptr == nullptr) {
+        return;
+    }
+    Mapping m = pending_map;
+    m.ptr = static_cast<char *>(ptr);
+    if (func == kMapBuffer) {
+        GLint64 size = 0;
+        glGetBufferParameteri64v(m.target, GL_BUFFER_SIZE, &size);
+        m.size = size;
+    }
+    mappings.push_back(m);
+}
+
+} // namespace tcm
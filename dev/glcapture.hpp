@@ -0,0 +1,133 @@
+// glcapture.hpp - Capture the OpenGL calls for a frame.
+#pragma once
+
+#include "dev/glfuncs.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+namespace tcm {
+
+// Capture the OpenGL calls in the next frame, and write them to a file in
+// captures/, which can be run again with //dev:glreplay.
+void GLCaptureNextFrame();
+
+// Start capturing calls, if a capture was requested. The width and height are
+// the size of the default framebuffer.
+void GLCaptureBegin(int width, int height);
+
+// Stop capturing calls, and write the capture along with the contents of the
+// objects the calls use.
+void GLCaptureEnd();
+
+// Return true if calls are being captured.
+bool GLCapturing();
+
+// Record a call. Called by the tracing layer. Each argument is stored in a
+// 64-bit slot, and data which the arguments point to is copied.
+void GLCaptureRecord(Func func, const uint64_t *args, int nargs);
+
+// Record the pointer returned by a call to glMapBuffer or glMapBufferRange, so
+// the data written to it can be captured when the buffer is unmapped.
+void GLCaptureMapped(Func func, void *ptr);
+
+// Store a value in a 64-bit slot, by copying its bytes.
+template <typename T>
+uint64_t GLCaptureSlot(T value) {
+    static_assert(sizeof(T) <= sizeof(uint64_t), "argument too large");
+    uint64_t slot = 0;
+    std::memcpy(&slot, &value, sizeof(T));
+    return slot;
+}
+
+// Record a call with the given arguments.
+template <typename... A>
+void GLCaptureCall(Func func, A... args) {
+    const uint64_t slots[] = {GLCaptureSlot(args)..., 0};
+    GLCaptureRecord(func, slots, sizeof...(A));
+}
+
+// Capture file format. All numbers are little-endian.
+//
+// - Header: the magic, u32 version, u32 width, u32 height.
+// - Buffers: u32 count, then for each: u32 name, u32 usage, u64 size, data.
+// - Textures: u32 count, then for each: u32 name, u32 parameter count, pairs
+//   of u32 parameter and i32 value, u32 level count, and for each level: i32
+//   internal format, i32 width, i32 height, u32 format, u32 type, u64 size,
+//   data.
+// - Programs: u32 count, then for each: u32 name; u32 shader count, and for
+//   each: u32 type, string source; u32 attribute count, and for each: string
+//   name, i32 location; u32 transform feedback mode, u32 varying count,
+//   strings; u32 uniform count, and for each: string name, i32 location, u32
+//   type, u32 size, data; u32 uniform block count, and for each: string name,
+//   u32 binding.
+// - Vertex arrays: u32 count, then for each: u32 name, u32 element buffer,
+//   u32 attribute count, and for each: u32 index, u8 enabled, i32 size, u32
+//   type, u8 normalized, u8 integer, i32 stride, u64 offset, u32 buffer, u32
+//   divisor.
+// - Framebuffers: u32 count, then for each: u32 name, u32 attachment count,
+//   and for each: u32 attachment, u32 texture, i32 level.
+// - Setup calls, which restore the state at the start of the frame, and then
+//   the calls in the frame: u32 count, then for each: u16 function, u8
+//   argument count, u64 arguments, u8 payload flag, and if set, u32 size and
+//   the data.
+//
+// Strings are a u32 length followed by the characters.
+constexpr char GLCaptureMagic[8] = {'T', 'C', 'M', 'G', 'L', 'C', 'A', 'P'};
+constexpr uint32_t GLCaptureVersion = 2;
+
+// How the values of a uniform type are stored.
+struct UniformFormat {
+    enum Kind { Float, Int, UInt } kind;
+    // Number of values, or 0 if the type is not supported.
+    int components;
+};
+
+inline UniformFormat GetUniformFormat(GLenum type) {
+    switch (type) {
+    case GL_FLOAT:
+        return {UniformFormat::Float, 1};
+    case GL_FLOAT_VEC2:
+        return {UniformFormat::Float, 2};
+    case GL_FLOAT_VEC3:
+        return {UniformFormat::Float, 3};
+    case GL_FLOAT_VEC4:
+    case GL_FLOAT_MAT2:
+        return {UniformFormat::Float, 4};
+    case GL_FLOAT_MAT3:
+        return {UniformFormat::Float, 9};
+    case GL_FLOAT_MAT4:
+        return {UniformFormat::Float, 16};
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_BUFFER:
+    case GL_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+        return {UniformFormat::Int, 1};
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2:
+        return {UniformFormat::Int, 2};
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3:
+        return {UniformFormat::Int, 3};
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4:
+        return {UniformFormat::Int, 4};
+    case GL_UNSIGNED_INT:
+        return {UniformFormat::UInt, 1};
+    case GL_UNSIGNED_INT_VEC2:
+        return {UniformFormat::UInt, 2};
+    case GL_UNSIGNED_INT_VEC3:
+        return {UniformFormat::UInt, 3};
+    case GL_UNSIGNED_INT_VEC4:
+        return {UniformFormat::UInt, 4};
+    default:
+        return {UniformFormat::Float, 0};
+    }
+}
+
+} // namespace tcm
@@ -0,0 +1,207 @@
+// glfuncs.hpp - OpenGL functions which are traced and captured.
+#pragma once
+
+#include "tcm/gl.h"
+
+namespace tcm {
+
+// Functions loaded by GLEW which are counted. This does not need to be
+// exhaustive, functions can be added as they are used.
+#define TRACE_GLEW_FUNCTIONS(X)          \
+    X(ActiveTexture, State)              \
+    X(BeginQuery, Other)                 \
+    X(BeginTransformFeedback, Other)     \
+    X(BindBuffer, State)                 \
+    X(BindBufferBase, State)             \
+    X(BindBufferRange, State)            \
+    X(BindFramebuffer, State)            \
+    X(BindVertexArray, State)            \
+    X(BlendFuncSeparate, State)          \
+    X(BlitFramebuffer, Draw)             \
+    X(BufferStorage, Upload)             \
+    X(ClientWaitSync, Other)             \
+    X(CompileShader, Other)              \
+    X(DeleteBuffers, Other)              \
+    X(DeleteFramebuffers, Other)         \
+    X(DeleteVertexArrays, Other)         \
+    X(DrawArraysInstanced, Draw)         \
+    X(DrawElementsInstanced, Draw)       \
+    X(EnableVertexAttribArray, State)    \
+    X(EndQuery, Other)                   \
+    X(EndTransformFeedback, Other)       \
+    X(FenceSync, Other)                  \
+    X(FramebufferTexture2D, State)       \
+    X(GenBuffers, Other)                 \
+    X(GenFramebuffers, Other)            \
+    X(GenVertexArrays, Other)            \
+    X(GenerateMipmap, Other)             \
+    X(GetUniformLocation, Other)         \
+    X(LinkProgram, Other)                \
+    X(MapBuffer, Upload)                 \
+    X(MapBufferRange, Upload)            \
+    X(MultiDrawArrays, Draw)             \
+    X(QueryCounter, Other)               \
+    X(ShaderSource, Other)               \
+    X(Uniform1f, State)                  \
+    X(Uniform1i, State)                  \
+    X(Uniform2f, State)                  \
+    X(Uniform2fv, State)                 \
+    X(Uniform4fv, State)                 \
+    X(UniformMatrix4fv, State)           \
+    X(UnmapBuffer, Other)                \
+    X(UseProgram, State)                 \
+    X(VertexAttribDivisor, State)        \
+    X(VertexAttribIPointer, State)       \
+    X(VertexAttribPointer, State)
+
+// Functions with special wrappers which count bytes transferred.
+#define TRACE_TRANSFER_FUNCTIONS(X) \
+    X(BufferData, Upload)           \
+    X(BufferSubData, Upload)
+
+// OpenGL 1.0 and 1.1 functions, which are not loaded by GLEW.
+#define TRACE_CORE_FUNCTIONS(X) \
+    X(BindTexture, State)       \
+    X(BlendFunc, State)         \
+    X(Clear, Draw)              \
+    X(ClearColor, State)        \
+    X(DeleteTextures, Other)    \
+    X(DepthFunc, State)         \
+    X(Disable, State)           \
+    X(DrawArrays, Draw)         \
+    X(DrawElements, Draw)       \
+    X(Enable, State)            \
+    X(GenTextures, Other)       \
+    X(PixelStorei, State)       \
+    X(ReadPixels, Download)     \
+    X(TexImage2D, Upload)       \
+    X(TexParameteri, State)     \
+    X(TexSubImage2D, Upload)    \
+    X(Viewport, State)
+
+#define ALL_FUNCTIONS(X)        \
+    TRACE_GLEW_FUNCTIONS(X)     \
+    TRACE_TRANSFER_FUNCTIONS(X) \
+    TRACE_CORE_FUNCTIONS(X)
+
+// Function identifiers. These are written to frame captures, so capture files
+// must be recorded and replayed by the same version of this list.
+enum Func {
+#define X(name, kind) k##name,
+    ALL_FUNCTIONS(X)
+#undef X
+        kNumFuncs
+};
+
+inline const char *const FuncName[kNumFuncs] = {
+#define X(name, kind) "gl" #name,
+    ALL_FUNCTIONS(X)
+#undef X
+};
+
+// How a function argument is interpreted in a frame capture. Object names and
+// uniform locations are translated when the capture is replayed.
+enum class ArgType {
+    Value,
+    Buffer,
+    Texture,
+    VertexArray,
+    Program,
+    Framebuffer,
+    // A uniform location in the current program.
+    Location,
+};
+
+constexpr ArgType FuncArg(Func func, int index) {
+    switch (func) {
+    case kBindBuffer:
+        return index == 1 ? ArgType::Buffer : ArgType::Value;
+    case kBindBufferBase:
+    case kBindBufferRange:
+        return index == 2 ? ArgType::Buffer : ArgType::Value;
+    case kBindFramebuffer:
+        return index == 1 ? ArgType::Framebuffer : ArgType::Value;
+    case kBindTexture:
+        return index == 1 ? ArgType::Texture : ArgType::Value;
+    case kBindVertexArray:
+        return index == 0 ? ArgType::VertexArray : ArgType::Value;
+    case kUseProgram:
+        return index == 0 ? ArgType::Program : ArgType::Value;
+    case kUniform1f:
+    case kUniform1i:
+    case kUniform2f:
+    case kUniform2fv:
+    case kUniform4fv:
+    case kUniformMatrix4fv:
+        return index == 0 ? ArgType::Location : ArgType::Value;
+    default:
+        return ArgType::Value;
+    }
+}
+
+// How calls to a function are treated in frame captures.
+enum class CaptureMode {
+    // Recorded and replayed.
+    Record,
+    // Left out: queries and fences, since the replay measures time itself, and
+    // functions which only create or inspect shaders.
+    Skip,
+    // Left out with a warning, since the replay may differ. Objects are saved
+    // as they are when the capture starts, so creating, deleting, or attaching
+    // objects during the frame is not replayed.
+    Warn,
+};
+
+constexpr CaptureMode FuncCapture(Func func) {
+    switch (func) {
+    case kBeginQuery:
+    case kClientWaitSync:
+    case kCompileShader:
+    case kEndQuery:
+    case kFenceSync:
+    case kGetUniformLocation:
+    case kLinkProgram:
+    case kQueryCounter:
+    case kShaderSource:
+        return CaptureMode::Skip;
+    case kDeleteBuffers:
+    case kDeleteFramebuffers:
+    case kDeleteTextures:
+    case kDeleteVertexArrays:
+    case kFramebufferTexture2D:
+    case kGenBuffers:
+    case kGenFramebuffers:
+    case kGenTextures:
+    case kGenVertexArrays:
+        return CaptureMode::Warn;
+    default:
+        return CaptureMode::Record;
+    }
+}
+
+// Return the index of the argument which points to data copied into a frame
+// capture, or -1 if there is none. glMultiDrawArrays has a second array, in
+// the next argument.
+constexpr int FuncPayloadArg(Func func) {
+    switch (func) {
+    case kBufferData:
+    case kBufferStorage:
+    case kUniform2fv:
+    case kUniform4fv:
+        return 2;
+    case kBufferSubData:
+    case kUniformMatrix4fv:
+        return 3;
+    case kMultiDrawArrays:
+        return 1;
+    case kReadPixels:
+        return 6;
+    case kTexImage2D:
+    case kTexSubImage2D:
+        return 8;
+    default:
+        return -1;
+    }
+}
+
+} // namespace tcm
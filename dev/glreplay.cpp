@@ -0,0 +1,714 @@
+// glreplay.cpp - Replay a frame captured by the development build.
+//
+// The objects saved in the capture are recreated, and then the frame is issued
+// again in a loop in a hidden window. Each iteration restores the state from
+// the start of the frame, and then issues the calls in the frame. The time the
+// CPU takes to issue the calls is measured separately from the time the GPU
+// takes to run them, and the GPU is idle at the start of each iteration.
+
+// To avoid conflict when we define these twice.
+#define GLFW_INCLUDE_NONE
+
+#include "dev/glcapture.hpp"
+#include "dev/glfuncs.hpp"
+#include "dev/log.hpp"
+#include "tcm/gl.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace tcm {
+
+namespace {
+
+const int kMaxArgs = 12;
+
+// Reads the capture file format.
+class Reader {
+public:
+    explicit Reader(std::vector<char> data) : data_{std::move(data)} {}
+
+    template <typename T>
+    T Get() {
+        T value;
+        std::memcpy(&value, GetBytes(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    const char *GetBytes(uint64_t size) {
+        if (size > data_.size() - pos_) {
+            Die("Capture is truncated");
+        }
+        const char *ptr = data_.data() + pos_;
+        pos_ += size;
+        return ptr;
+    }
+
+    std::string GetString() {
+        uint32_t size = Get<uint32_t>();
+        return std::string(GetBytes(size), size);
+    }
+
+private:
+    std::vector<char> data_;
+    size_t pos_ = 0;
+};
+
+// A call in the capture, with object names and uniform locations translated.
+struct Call {
+    Func func;
+    int nargs;
+    uint64_t args[kMaxArgs];
+    bool has_payload;
+    std::vector<char> payload;
+};
+
+// A program in the replay, and the translation of its uniform locations.
+struct Program {
+    GLuint name;
+    std::unordered_map<GLint, GLint> locations;
+};
+
+// Names of objects in the capture, mapped to the objects created in the replay.
+std::unordered_map<GLuint, GLuint> buffers;
+std::unordered_map<GLuint, GLuint> textures;
+std::unordered_map<GLuint, GLuint> vertex_arrays;
+std::unordered_map<GLuint, Program> programs;
+std::unordered_map<GLuint, GLuint> framebuffers;
+
+template <typename T>
+T FromSlot(uint64_t slot) {
+    T value;
+    std::memcpy(&value, &slot, sizeof(T));
+    return value;
+}
+
+template <typename R, typename... A>
+int Arity(R (*fn)(A...)) {
+    (void)fn;
+    return sizeof...(A);
+}
+
+template <typename R, typename... A, size_t... I>
+R CallWith(R (*fn)(A...), const uint64_t *args, std::index_sequence<I...>) {
+    return fn(FromSlot<A>(args[I])...);
+}
+
+// Call a function with the arguments of a captured call. Returns the result if
+// it is a pointer.
+template <typename R, typename... A>
+void *Invoke(R (*fn)(A...), const uint64_t *args) {
+    auto seq = std::index_sequence_for<A...>{};
+    if constexpr (std::is_pointer<R>::value) {
+        return const_cast<void *>(
+            static_cast<const void *>(CallWith(fn, args, seq)));
+    } else {
+        CallWith(fn, args, seq);
+        return nullptr;
+    }
+}
+
+// Return the number of arguments a function takes.
+int FuncArity(Func func) {
+    switch (func) {
+#define X(name, kind) \
+    case k##name:     \
+        return Arity(gl##name);
+        ALL_FUNCTIONS(X)
+#undef X
+    default:
+        return -1;
+    }
+}
+
+void *Dispatch(const Call &call) {
+    switch (call.func) {
+#define X(name, kind) \
+    case k##name:     \
+        return Invoke(gl##name, call.args);
+        ALL_FUNCTIONS(X)
+#undef X
+    default:
+        return nullptr;
+    }
+}
+
+// Return the replay's name for an object in the capture. Objects which were
+// not saved, because they were deleted before the end of the frame, are
+// created empty.
+GLuint Translate(std::unordered_map<GLuint, GLuint> *map, GLuint name,
+                 void (*gen)(GLsizei, GLuint *), const char *what) {
+    if (name == 0) {
+        return 0;
+    }
+    auto it = map->find(name);
+    if (it != map->end()) {
+        return it->second;
+    }
+    Warning("Capture does not contain %s %u", what, name);
+    GLuint obj;
+    gen(1, &obj);
+    (*map)[name] = obj;
+    return obj;
+}
+
+void GenBuffers(GLsizei n, GLuint *names) {
+    glGenBuffers(n, names);
+}
+void GenTextures(GLsizei n, GLuint *names) {
+    glGenTextures(n, names);
+}
+void GenVertexArrays(GLsizei n, GLuint *names) {
+    glGenVertexArrays(n, names);
+}
+void GenFramebuffers(GLsizei n, GLuint *names) {
+    glGenFramebuffers(n, names);
+}
+
+void LoadBuffers(Reader *r) {
+    uint32_t count = r->Get<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        GLuint name = r->Get<uint32_t>();
+        GLenum usage = r->Get<uint32_t>();
+        uint64_t size = r->Get<uint64_t>();
+        const char *data = r->GetBytes(size);
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+        buffers[name] = buffer;
+    }
+}
+
+void LoadTextures(Reader *r) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    uint32_t count = r->Get<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        GLuint name = r->Get<uint32_t>();
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        uint32_t nparams = r->Get<uint32_t>();
+        for (uint32_t j = 0; j < nparams; j++) {
+            GLenum pname = r->Get<uint32_t>();
+            GLint value = r->Get<int32_t>();
+            glTexParameteri(GL_TEXTURE_2D, pname, value);
+        }
+        uint32_t nlevels = r->Get<uint32_t>();
+        for (uint32_t level = 0; level < nlevels; level++) {
+            GLint internal = r->Get<int32_t>();
+            GLsizei width = r->Get<int32_t>();
+            GLsizei height = r->Get<int32_t>();
+            GLenum format = r->Get<uint32_t>();
+            GLenum type = r->Get<uint32_t>();
+            uint64_t size = r->Get<uint64_t>();
+            const char *data = r->GetBytes(size);
+            glTexImage2D(GL_TEXTURE_2D, level, internal, width, height, 0,
+                         format, type, data);
+        }
+        textures[name] = texture;
+    }
+}
+
+// Set the value of a uniform in the current program.
+void SetUniform(GLint location, GLenum type, const char *data) {
+    const GLfloat *f = reinterpret_cast<const GLfloat *>(data);
+    const GLint *i = reinterpret_cast<const GLint *>(data);
+    const GLuint *u = reinterpret_cast<const GLuint *>(data);
+    switch (type) {
+    case GL_FLOAT_MAT2:
+        glUniformMatrix2fv(location, 1, GL_FALSE, f);
+        return;
+    case GL_FLOAT_MAT3:
+        glUniformMatrix3fv(location, 1, GL_FALSE, f);
+        return;
+    case GL_FLOAT_MAT4:
+        glUniformMatrix4fv(location, 1, GL_FALSE, f);
+        return;
+    default:
+        break;
+    }
+    UniformFormat fmt = GetUniformFormat(type);
+    switch (fmt.kind) {
+    case UniformFormat::Float:
+        switch (fmt.components) {
+        case 1:
+            glUniform1fv(location, 1, f);
+            break;
+        case 2:
+            glUniform2fv(location, 1, f);
+            break;
+        case 3:
+            glUniform3fv(location, 1, f);
+            break;
+        case 4:
+            glUniform4fv(location, 1, f);
+            break;
+        }
+        break;
+    case UniformFormat::Int:
+        switch (fmt.components) {
+        case 1:
+            glUniform1iv(location, 1, i);
+            break;
+        case 2:
+            glUniform2iv(location, 1, i);
+            break;
+        case 3:
+            glUniform3iv(location, 1, i);
+            break;
+        case 4:
+            glUniform4iv(location, 1, i);
+            break;
+        }
+        break;
+    case UniformFormat::UInt:
+        switch (fmt.components) {
+        case 1:
+            glUniform1uiv(location, 1, u);
+            break;
+        case 2:
+            glUniform2uiv(location, 1, u);
+            break;
+        case 3:
+            glUniform3uiv(location, 1, u);
+            break;
+        case 4:
+            glUniform4uiv(location, 1, u);
+            break;
+        }
+        break;
+    }
+}
+
+void LoadPrograms(Reader *r) {
+    uint32_t count = r->Get<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        GLuint name = r->Get<uint32_t>();
+        GLuint prog = glCreateProgram();
+        uint32_t nshaders = r->Get<uint32_t>();
+        std::vector<GLuint> shaders;
+        for (uint32_t j = 0; j < nshaders; j++) {
+            GLenum type = r->Get<uint32_t>();
+            std::string source = r->GetString();
+            GLuint shader = glCreateShader(type);
+            const char *src = source.c_str();
+            glShaderSource(shader, 1, &src, nullptr);
+            glCompileShader(shader);
+            GLint status;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+            if (!status) {
+                char log[1024];
+                glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+                Die("Shader for program %u failed to compile:\n%s", name,
+                    log);
+            }
+            glAttachShader(prog, shader);
+            shaders.push_back(shader);
+        }
+        uint32_t nattribs = r->Get<uint32_t>();
+        for (uint32_t j = 0; j < nattribs; j++) {
+            std::string attrib = r->GetString();
+            GLint location = r->Get<int32_t>();
+            if (location >= 0 && attrib.compare(0, 3, "gl_") != 0) {
+                glBindAttribLocation(prog, location, attrib.c_str());
+            }
+        }
+        GLenum mode = r->Get<uint32_t>();
+        uint32_t nvaryings = r->Get<uint32_t>();
+        std::vector<std::string> varyings;
+        for (uint32_t j = 0; j < nvaryings; j++) {
+            varyings.push_back(r->GetString());
+        }
+        if (!varyings.empty()) {
+            std::vector<const char *> ptrs;
+            for (const std::string &v : varyings) {
+                ptrs.push_back(v.c_str());
+            }
+            glTransformFeedbackVaryings(prog, ptrs.size(), ptrs.data(), mode);
+        }
+        glLinkProgram(prog);
+        GLint status;
+        glGetProgramiv(prog, GL_LINK_STATUS, &status);
+        if (!status) {
+            char log[1024];
+            glGetProgramInfoLog(prog, sizeof(log), nullptr, log);
+            Die("Program %u failed to link:\n%s", name, log);
+        }
+        for (GLuint shader : shaders) {
+            glDetachShader(prog, shader);
+            glDeleteShader(shader);
+        }
+
+        Program &p = programs[name];
+        p.name = prog;
+        glUseProgram(prog);
+        uint32_t nuniforms = r->Get<uint32_t>();
+        for (uint32_t j = 0; j < nuniforms; j++) {
+            std::string uniform = r->GetString();
+            GLint location = r->Get<int32_t>();
+            GLenum type = r->Get<uint32_t>();
+            uint32_t size = r->Get<uint32_t>();
+            const char *data = r->GetBytes(size);
+            GLint new_location = glGetUniformLocation(prog, uniform.c_str());
+            p.locations[location] = new_location;
+            if (new_location != -1) {
+                SetUniform(new_location, type, data);
+            }
+        }
+        uint32_t nblocks = r->Get<uint32_t>();
+        for (uint32_t j = 0; j < nblocks; j++) {
+            std::string block = r->GetString();
+            GLuint binding = r->Get<uint32_t>();
+            GLuint index = glGetUniformBlockIndex(prog, block.c_str());
+            if (index != GL_INVALID_INDEX) {
+                glUniformBlockBinding(prog, index, binding);
+            }
+        }
+    }
+}
+
+void LoadVertexArrays(Reader *r) {
+    uint32_t count = r->Get<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        GLuint name = r->Get<uint32_t>();
+        GLuint array;
+        glGenVertexArrays(1, &array);
+        glBindVertexArray(array);
+        GLuint element = r->Get<uint32_t>();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                     Translate(&buffers, element, GenBuffers, "buffer"));
+        uint32_t nattribs = r->Get<uint32_t>();
+        for (uint32_t j = 0; j < nattribs; j++) {
+            GLuint index = r->Get<uint32_t>();
+            bool enabled = r->Get<uint8_t>();
+            GLint size = r->Get<int32_t>();
+            GLenum type = r->Get<uint32_t>();
+            bool normalized = r->Get<uint8_t>();
+            bool integer = r->Get<uint8_t>();
+            GLsizei stride = r->Get<int32_t>();
+            uintptr_t offset = r->Get<uint64_t>();
+            GLuint buffer = r->Get<uint32_t>();
+            GLuint divisor = r->Get<uint32_t>();
+            glBindBuffer(GL_ARRAY_BUFFER,
+                         Translate(&buffers, buffer, GenBuffers, "buffer"));
+            const void *ptr = reinterpret_cast<const void *>(offset);
+            if (integer) {
+                glVertexAttribIPointer(index, size, type, stride, ptr);
+            } else {
+                glVertexAttribPointer(index, size, type, normalized, stride,
+                                      ptr);
+            }
+            glVertexAttribDivisor(index, divisor);
+            if (enabled) {
+                glEnableVertexAttribArray(index);
+            }
+        }
+        vertex_arrays[name] = array;
+    }
+    glBindVertexArray(0);
+}
+
+void LoadFramebuffers(Reader *r) {
+    uint32_t count = r->Get<uint32_t>();
+    for (uint32_t i = 0; i < count; i++) {
+        GLuint name = r->Get<uint32_t>();
+        GLuint framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        uint32_t nattachments = r->Get<uint32_t>();
+        for (uint32_t j = 0; j < nattachments; j++) {
+            GLenum attachment = r->Get<uint32_t>();
+            GLuint texture = r->Get<uint32_t>();
+            GLint level = r->Get<int32_t>();
+            glFramebufferTexture2D(
+                GL_DRAW_FRAMEBUFFER, attachment, GL_TEXTURE_2D,
+                Translate(&textures, texture, GenTextures, "texture"), level);
+        }
+        framebuffers[name] = framebuffer;
+    }
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+// Read a list of calls, translating names and locations. The current program
+// is tracked to translate locations, which works because every iteration
+// starts by restoring the current program.
+std::vector<Call> LoadCalls(Reader *r, GLuint *program) {
+    uint32_t count = r->Get<uint32_t>();
+    std::vector<Call> calls(count);
+    for (Call &call : calls) {
+        uint16_t func = r->Get<uint16_t>();
+        if (func >= kNumFuncs) {
+            Die("Capture has unknown function %u", func);
+        }
+        call.func = static_cast<Func>(func);
+        call.nargs = r->Get<uint8_t>();
+        if (call.nargs != FuncArity(call.func)) {
+            Die("Capture has wrong number of arguments for %s",
+                FuncName[call.func]);
+        }
+        for (int i = 0; i < call.nargs; i++) {
+            uint64_t &slot = call.args[i];
+            slot = r->Get<uint64_t>();
+            GLuint name = FromSlot<GLuint>(slot);
+            switch (FuncArg(call.func, i)) {
+            case ArgType::Value:
+                break;
+            case ArgType::Buffer:
+                slot = Translate(&buffers, name, GenBuffers, "buffer");
+                break;
+            case ArgType::Texture:
+                slot = Translate(&textures, name, GenTextures, "texture");
+                break;
+            case ArgType::VertexArray:
+                slot = Translate(&vertex_arrays, name, GenVertexArrays,
+                                 "vertex array");
+                break;
+            case ArgType::Framebuffer:
+                slot = Translate(&framebuffers, name, GenFramebuffers,
+                                 "framebuffer");
+                break;
+            case ArgType::Program: {
+                *program = name;
+                auto it = programs.find(name);
+                slot = it != programs.end() ? it->second.name : 0;
+            } break;
+            case ArgType::Location: {
+                GLint location = FromSlot<GLint>(slot);
+                GLint result = -1;
+                auto it = programs.find(*program);
+                if (it != programs.end()) {
+                    auto loc = it->second.locations.find(location);
+                    if (loc != it->second.locations.end()) {
+                        result = loc->second;
+                    }
+                }
+                slot = GLCaptureSlot(result);
+            } break;
+            }
+        }
+        call.has_payload = r->Get<uint8_t>() != 0;
+        if (call.has_payload) {
+            uint32_t size = r->Get<uint32_t>();
+            const char *data = r->GetBytes(size);
+            call.payload.assign(data, data + size);
+        }
+    }
+    // Point the arguments at the payloads, now that they will not move.
+    for (Call &call : calls) {
+        int arg = FuncPayloadArg(call.func);
+        if (!call.has_payload || arg < 0) {
+            continue;
+        }
+        char *ptr = call.payload.data();
+        call.args[arg] = GLCaptureSlot(ptr);
+        if (call.func == kMultiDrawArrays) {
+            GLsizei n = FromSlot<GLsizei>(call.args[3]);
+            call.args[arg + 1] = GLCaptureSlot(ptr + n * sizeof(GLint));
+        }
+    }
+    return calls;
+}
+
+// A buffer mapped by the calls.
+struct Mapping {
+    GLenum target;
+    void *ptr;
+};
+
+// Issue a list of calls.
+void Run(const std::vector<Call> &calls) {
+    Mapping mappings[4];
+    int nmappings = 0;
+    for (const Call &call : calls) {
+        switch (call.func) {
+        case kMapBuffer:
+        case kMapBufferRange: {
+            void *ptr = Dispatch(call);
+            if (nmappings < 4) {
+                mappings[nmappings++] = {FromSlot<GLenum>(call.args[0]), ptr};
+            }
+        } break;
+        case kUnmapBuffer: {
+            GLenum target = FromSlot<GLenum>(call.args[0]);
+            for (int i = 0; i < nmappings; i++) {
+                if (mappings[i].target == target) {
+                    if (call.has_payload && mappings[i].ptr != nullptr) {
+                        std::memcpy(mappings[i].ptr, call.payload.data(),
+                                    call.payload.size());
+                    }
+                    mappings[i] = mappings[--nmappings];
+                    break;
+                }
+            }
+            Dispatch(call);
+        } break;
+        default:
+            Dispatch(call);
+            break;
+        }
+    }
+}
+
+// Statistics for a set of measurements, in milliseconds.
+void Report(const char *what, std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (double t : times) {
+        sum += t;
+    }
+    Info("%s: mean %.3f ms, median %.3f ms, min %.3f ms, max %.3f ms", what,
+         sum / times.size(), times[times.size() / 2], times.front(),
+         times.back());
+}
+
+std::vector<char> ReadCapture(const char *path) {
+    std::FILE *fp = std::fopen(path, "rb");
+    if (fp == nullptr) {
+        DieErrno(errno, "%s", path);
+    }
+    std::vector<char> data;
+    char buf[64 * 1024];
+    size_t amt;
+    while ((amt = std::fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.insert(data.end(), buf, buf + amt);
+    }
+    if (std::ferror(fp)) {
+        DieErrno(errno, "%s", path);
+    }
+    std::fclose(fp);
+    return data;
+}
+
+int Main(int argc, char **argv) {
+    int iterations = 1000;
+    int warmup = 10;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (std::strncmp(arg, "--iterations=", 13) == 0) {
+            iterations = std::atoi(arg + 13);
+        } else if (std::strncmp(arg, "--warmup=", 9) == 0) {
+            warmup = std::atoi(arg + 9);
+        } else if (arg[0] == '-') {
+            Die("Unknown option: %s", arg);
+        } else if (path == nullptr) {
+            path = arg;
+        } else {
+            Die("Unexpected argument: %s", arg);
+        }
+    }
+    if (path == nullptr) {
+        Die("Usage: glreplay [--iterations=N] [--warmup=N] <capture>");
+    }
+    if (iterations < 1) {
+        Die("Invalid iteration count");
+    }
+    LogStart(nullptr);
+    // Captures are written relative to the workspace root.
+    const char *workspace_dir = std::getenv("BUILD_WORKSPACE_DIRECTORY");
+    if (workspace_dir != nullptr && chdir(workspace_dir) != 0) {
+        DieErrno(errno, "%s", workspace_dir);
+    }
+
+    Reader r{ReadCapture(path)};
+    if (std::memcmp(r.GetBytes(sizeof(GLCaptureMagic)), GLCaptureMagic,
+                    sizeof(GLCaptureMagic)) != 0) {
+        Die("%s: Not a capture", path);
+    }
+    uint32_t version = r.Get<uint32_t>();
+    if (version != GLCaptureVersion) {
+        Die("%s: Unsupported version %u", path, version);
+    }
+    int width = r.Get<uint32_t>();
+    int height = r.Get<uint32_t>();
+
+    if (!glfwInit()) {
+        Die("Could not initialize GLFW");
+    }
+    // See main_dev.cpp.
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window =
+        glfwCreateWindow(width, height, "glreplay", nullptr, nullptr);
+    if (!window) {
+        glfwTerminate();
+        Die("Could not create window");
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+#if !defined __APPLE__
+    glewInit();
+#endif
+    Info("GL_RENDERER: %s", glGetString(GL_RENDERER));
+
+    LoadBuffers(&r);
+    LoadTextures(&r);
+    LoadPrograms(&r);
+    LoadVertexArrays(&r);
+    LoadFramebuffers(&r);
+    GLuint program = 0;
+    std::vector<Call> setup = LoadCalls(&r, &program);
+    std::vector<Call> frame = LoadCalls(&r, &program);
+    Info("Replaying %zu calls, %d iterations", frame.size(), iterations);
+
+    GLuint query;
+    glGenQueries(1, &query);
+    std::vector<double> cpu_times, gpu_times;
+    for (int i = -warmup; i < iterations; i++) {
+        Run(setup);
+        glFinish();
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        auto t0 = std::chrono::steady_clock::now();
+        Run(frame);
+        auto t1 = std::chrono::steady_clock::now();
+        glEndQuery(GL_TIME_ELAPSED);
+        glFinish();
+        GLuint64 gpu_time;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_time);
+        if (i == -warmup) {
+            GLenum err = glGetError();
+            if (err != GL_NO_ERROR) {
+                ErrorGL(err, "Replay");
+            }
+        }
+        if (i >= 0) {
+            cpu_times.push_back(
+                std::chrono::duration<double, std::milli>(t1 - t0).count());
+            gpu_times.push_back(gpu_time * 1e-6);
+        }
+    }
+    Report("CPU submission", std::move(cpu_times));
+    Report("GPU", std::move(gpu_times));
+
+    glDeleteQueries(1, &query);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    LogStop();
+    return 0;
+}
+
+} // namespace
+
+} // namespace tcm
+
+int main(int argc, char **argv) {
+    return tcm::Main(argc, argv);
+}
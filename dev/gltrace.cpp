@@ -0,0 +1,507 @@
+// gltrace.cpp - OpenGL call statistics.
+//
+// OpenGL 1.2 and later functions are loaded by GLEW into function pointers,
+// which we replace with counting wrappers. OpenGL 1.0 and 1.1 functions are
+// called directly from libGL, so we define them in the executable, which takes
+// precedence over the library, and forward them using dlsym(RTLD_NEXT). None of
+// this is linked into the release build.
+#include "dev/gltrace.hpp"
+
+#include "dev/glcapture.hpp"
+#include "dev/glfuncs.hpp"
+#include "dev/log.hpp"
+#include "dev/text.hpp"
+#include "tcm/gl.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#if !defined __APPLE__
+#include <dlfcn.h>
+#endif
+
+namespace tcm {
+
+namespace {
+
+// Kinds of OpenGL functions, for summary statistics.
+enum class Kind {
+    Other,
+    State,
+    Draw,
+    Upload,
+    Download,
+};
+
+const Kind FuncKind[kNumFuncs] = {
+#define X(name, kind) Kind::kind,
+    ALL_FUNCTIONS(X)
+#undef X
+};
+
+const int kMaxScopes = 16;
+
+struct Counters {
+    uint32_t calls[kNumFuncs];
+    uint64_t bytes_up;
+    uint64_t bytes_down;
+};
+
+struct Frame {
+    Counters scope[kMaxScopes];
+    unsigned perf_warnings;
+};
+
+bool enabled;
+Frame current;
+Frame last;
+// Scope 0 collects calls made outside any scope.
+const char *scope_names[kMaxScopes] = {"other"};
+int num_scopes = 1;
+int cur_scope;
+
+// Only calls on the main thread are counted. Calls from other threads, like the
+// upload thread, go to a per-thread counter which is ignored.
+thread_local bool is_main_thread;
+thread_local Counters other_thread;
+
+// Get the counters for the current scope.
+inline Counters &Scope() {
+    return is_main_thread ? current.scope[cur_scope] : other_thread;
+}
+
+inline void Count(Func f) {
+    Scope().calls[f]++;
+}
+
+// Record a call in the frame capture, if one is in progress.
+template <typename... A>
+inline void Capture(Func f, A... args) {
+    if (is_main_thread && GLCapturing()) {
+        GLCaptureCall(f, args...);
+    }
+}
+
+// Return the number of bytes in an image with the given format.
+uint64_t ImageBytes(GLenum format, GLenum type, GLsizei width,
+                    GLsizei height) {
+    int size;
+    switch (type) {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:
+        size = 1;
+        break;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+        size = 2;
+        break;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+        // Packed, one value per pixel.
+        return static_cast<uint64_t>(width) * height * 4;
+    default:
+        size = 4;
+        break;
+    }
+    int components;
+    switch (format) {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+        components = 1;
+        break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+        components = 2;
+        break;
+    case GL_RGB:
+    case GL_BGR:
+        components = 3;
+        break;
+    default:
+        components = 4;
+        break;
+    }
+    return static_cast<uint64_t>(width) * height * components * size;
+}
+
+#if !defined __APPLE__
+
+// Wrapper for a function loaded by GLEW, which counts calls.
+template <Func F, typename T>
+struct Wrap;
+
+template <Func F, typename R, typename... A>
+struct Wrap<F, R (*)(A...)> {
+    static R (*real)(A...);
+    static R Call(A... a) {
+        Count(F);
+        Capture(F, a...);
+        if constexpr (std::is_pointer<R>::value) {
+            R r = real(a...);
+            if (is_main_thread && GLCapturing()) {
+                GLCaptureMapped(F, r);
+            }
+            return r;
+        } else {
+            return real(a...);
+        }
+    }
+};
+
+template <Func F, typename R, typename... A>
+R (*Wrap<F, R (*)(A...)>::real)(A...);
+
+template <Func F, typename T>
+void Install(T *ptr) {
+    if (*ptr != nullptr) {
+        Wrap<F, T>::real = *ptr;
+        *ptr = Wrap<F, T>::Call;
+    }
+}
+
+decltype(__glewBufferData) real_BufferData;
+decltype(__glewBufferSubData) real_BufferSubData;
+
+void TraceBufferData(GLenum target, GLsizeiptr size, const void *data,
+                     GLenum usage) {
+    Count(kBufferData);
+    Capture(kBufferData, target, size, data, usage);
+    if (data != nullptr) {
+        Scope().bytes_up += size;
+    }
+    real_BufferData(target, size, data, usage);
+}
+
+void TraceBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+                        const void *data) {
+    Count(kBufferSubData);
+    Capture(kBufferSubData, target, offset, size, data);
+    Scope().bytes_up += size;
+    real_BufferSubData(target, offset, size, data);
+}
+
+// Look up the real version of an OpenGL 1.1 function.
+template <typename T>
+T *Real(T *fn, const char *name) {
+    (void)fn;
+    void *ptr = dlsym(RTLD_NEXT, name);
+    if (ptr == nullptr) {
+        Die("Could not find %s", name);
+    }
+    return reinterpret_cast<T *>(ptr);
+}
+
+void DebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                   GLsizei length, const GLchar *message,
+                   const void *user_param) {
+    (void)source;
+    (void)id;
+    (void)user_param;
+    switch (type) {
+    case GL_DEBUG_TYPE_PERFORMANCE:
+        current.perf_warnings++;
+        Warning("GL performance: %.*s", static_cast<int>(length), message);
+        break;
+    case GL_DEBUG_TYPE_ERROR:
+        Error("GL: %.*s", static_cast<int>(length), message);
+        break;
+    default:
+        if (severity != GL_DEBUG_SEVERITY_NOTIFICATION) {
+            Warning("GL: %.*s", static_cast<int>(length), message);
+        }
+        break;
+    }
+}
+
+#endif // !__APPLE__
+
+StatusItem *status;
+
+// Append a summary of the counters to a string.
+void Summarize(std::string *out, const Counters &c) {
+    unsigned calls = 0, state = 0, draws = 0, uploads = 0;
+    for (int i = 0; i < kNumFuncs; i++) {
+        unsigned n = c.calls[i];
+        calls += n;
+        switch (FuncKind[i]) {
+        case Kind::State:
+            state += n;
+            break;
+        case Kind::Draw:
+            draws += n;
+            break;
+        case Kind::Upload:
+            uploads += n;
+            break;
+        default:
+            break;
+        }
+    }
+    char buf[128];
+    std::snprintf(buf, sizeof(buf),
+                  "%u calls, %u state, %u draw, %u upload, %.1f KiB up, "
+                  "%.1f KiB down",
+                  calls, state, draws, uploads, c.bytes_up / 1024.0,
+                  c.bytes_down / 1024.0);
+    out->append(buf);
+}
+
+} // namespace
+
+#if !defined __APPLE__
+
+} // namespace tcm
+
+// OpenGL 1.0 and 1.1 functions, interposed on the versions in libGL.
+extern "C" {
+
+void glBindTexture(GLenum target, GLuint texture) {
+    static auto real = tcm::Real(glBindTexture, "glBindTexture");
+    tcm::Count(tcm::kBindTexture);
+    tcm::Capture(tcm::kBindTexture, target, texture);
+    real(target, texture);
+}
+
+void glBlendFunc(GLenum sfactor, GLenum dfactor) {
+    static auto real = tcm::Real(glBlendFunc, "glBlendFunc");
+    tcm::Count(tcm::kBlendFunc);
+    tcm::Capture(tcm::kBlendFunc, sfactor, dfactor);
+    real(sfactor, dfactor);
+}
+
+void glClear(GLbitfield mask) {
+    static auto real = tcm::Real(glClear, "glClear");
+    tcm::Count(tcm::kClear);
+    tcm::Capture(tcm::kClear, mask);
+    real(mask);
+}
+
+void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+    static auto real = tcm::Real(glClearColor, "glClearColor");
+    tcm::Count(tcm::kClearColor);
+    tcm::Capture(tcm::kClearColor, red, green, blue, alpha);
+    real(red, green, blue, alpha);
+}
+
+void glDeleteTextures(GLsizei n, const GLuint *textures) {
+    static auto real = tcm::Real(glDeleteTextures, "glDeleteTextures");
+    tcm::Count(tcm::kDeleteTextures);
+    tcm::Capture(tcm::kDeleteTextures, n, textures);
+    real(n, textures);
+}
+
+void glDepthFunc(GLenum func) {
+    static auto real = tcm::Real(glDepthFunc, "glDepthFunc");
+    tcm::Count(tcm::kDepthFunc);
+    tcm::Capture(tcm::kDepthFunc, func);
+    real(func);
+}
+
+void glDisable(GLenum cap) {
+    static auto real = tcm::Real(glDisable, "glDisable");
+    tcm::Count(tcm::kDisable);
+    tcm::Capture(tcm::kDisable, cap);
+    real(cap);
+}
+
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    static auto real = tcm::Real(glDrawArrays, "glDrawArrays");
+    tcm::Count(tcm::kDrawArrays);
+    tcm::Capture(tcm::kDrawArrays, mode, first, count);
+    real(mode, first, count);
+}
+
+void glDrawElements(GLenum mode, GLsizei count, GLenum type,
+                    const void *indices) {
+    static auto real = tcm::Real(glDrawElements, "glDrawElements");
+    tcm::Count(tcm::kDrawElements);
+    tcm::Capture(tcm::kDrawElements, mode, count, type, indices);
+    real(mode, count, type, indices);
+}
+
+void glEnable(GLenum cap) {
+    static auto real = tcm::Real(glEnable, "glEnable");
+    tcm::Count(tcm::kEnable);
+    tcm::Capture(tcm::kEnable, cap);
+    real(cap);
+}
+
+void glGenTextures(GLsizei n, GLuint *textures) {
+    static auto real = tcm::Real(glGenTextures, "glGenTextures");
+    tcm::Count(tcm::kGenTextures);
+    tcm::Capture(tcm::kGenTextures, n, textures);
+    real(n, textures);
+}
+
+void glPixelStorei(GLenum pname, GLint param) {
+    static auto real = tcm::Real(glPixelStorei, "glPixelStorei");
+    tcm::Count(tcm::kPixelStorei);
+    tcm::Capture(tcm::kPixelStorei, pname, param);
+    real(pname, param);
+}
+
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height,
+                  GLenum format, GLenum type, void *pixels) {
+    static auto real = tcm::Real(glReadPixels, "glReadPixels");
+    tcm::Count(tcm::kReadPixels);
+    tcm::Capture(tcm::kReadPixels, x, y, width, height, format, type,
+                  pixels);
+    tcm::Scope().bytes_down += tcm::ImageBytes(format, type, width, height);
+    real(x, y, width, height, format, type, pixels);
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint internalformat,
+                  GLsizei width, GLsizei height, GLint border, GLenum format,
+                  GLenum type, const void *pixels) {
+    static auto real = tcm::Real(glTexImage2D, "glTexImage2D");
+    tcm::Count(tcm::kTexImage2D);
+    tcm::Capture(tcm::kTexImage2D, target, level, internalformat, width,
+                  height, border, format, type, pixels);
+    if (pixels != nullptr) {
+        tcm::Scope().bytes_up += tcm::ImageBytes(format, type, width, height);
+    }
+    real(target, level, internalformat, width, height, border, format, type,
+         pixels);
+}
+
+void glTexParameteri(GLenum target, GLenum pname, GLint param) {
+    static auto real = tcm::Real(glTexParameteri, "glTexParameteri");
+    tcm::Count(tcm::kTexParameteri);
+    tcm::Capture(tcm::kTexParameteri, target, pname, param);
+    real(target, pname, param);
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                     GLsizei width, GLsizei height, GLenum format, GLenum type,
+                     const void *pixels) {
+    static auto real = tcm::Real(glTexSubImage2D, "glTexSubImage2D");
+    tcm::Count(tcm::kTexSubImage2D);
+    tcm::Capture(tcm::kTexSubImage2D, target, level, xoffset, yoffset,
+                  width, height, format, type, pixels);
+    tcm::Scope().bytes_up += tcm::ImageBytes(format, type, width, height);
+    real(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    static auto real = tcm::Real(glViewport, "glViewport");
+    tcm::Count(tcm::kViewport);
+    tcm::Capture(tcm::kViewport, x, y, width, height);
+    real(x, y, width, height);
+}
+
+} // extern "C"
+
+namespace tcm {
+
+#endif // !__APPLE__
+
+void GLTraceInit() {
+    status = new StatusItem("GL calls");
+#if defined __APPLE__
+    Warning("OpenGL call tracing is not supported on this platform");
+#else
+#define X(name, kind) Install<k##name>(&__glew##name);
+    TRACE_GLEW_FUNCTIONS(X)
+#undef X
+    if (__glewBufferData != nullptr) {
+        real_BufferData = __glewBufferData;
+        __glewBufferData = TraceBufferData;
+    }
+    if (__glewBufferSubData != nullptr) {
+        real_BufferSubData = __glewBufferSubData;
+        __glewBufferSubData = TraceBufferSubData;
+    }
+    if (GLEW_KHR_debug) {
+        glEnable(GL_DEBUG_OUTPUT);
+        // Report messages on the thread which made the call, at the call.
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(DebugCallback, nullptr);
+    } else {
+        Warning("KHR_debug is not available");
+    }
+#endif
+    is_main_thread = true;
+    enabled = true;
+}
+
+void GLTraceEndFrame() {
+    if (!enabled) {
+        return;
+    }
+    last = current;
+    std::memset(&current, 0, sizeof(current));
+    Counters total{};
+    for (int s = 0; s < num_scopes; s++) {
+        const Counters &c = last.scope[s];
+        for (int i = 0; i < kNumFuncs; i++) {
+            total.calls[i] += c.calls[i];
+        }
+        total.bytes_up += c.bytes_up;
+        total.bytes_down += c.bytes_down;
+    }
+    std::string text;
+    Summarize(&text, total);
+    if (last.perf_warnings != 0) {
+        text.append(", ");
+        text.append(std::to_string(last.perf_warnings));
+        text.append(" performance warnings");
+    }
+    for (int s = 0; s < num_scopes; s++) {
+        text.append("\n  ");
+        text.append(scope_names[s]);
+        text.append(": ");
+        Summarize(&text, last.scope[s]);
+    }
+    status->Set(std::move(text));
+}
+
+void GLTraceDump() {
+    Info("OpenGL calls in last frame:");
+    for (int i = 0; i < kNumFuncs; i++) {
+        unsigned n = 0;
+        for (int s = 0; s < num_scopes; s++) {
+            n += last.scope[s].calls[i];
+        }
+        if (n == 0) {
+            continue;
+        }
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "  %-26s %6u", FuncName[i], n);
+        std::string line{buf};
+        for (int s = 0; s < num_scopes; s++) {
+            unsigned c = last.scope[s].calls[i];
+            if (c != 0) {
+                std::snprintf(buf, sizeof(buf), "  %s=%u", scope_names[s], c);
+                line.append(buf);
+            }
+        }
+        Info("%s", line.c_str());
+    }
+}
+
+GLTraceScope::GLTraceScope(const char *name) : prev_{cur_scope} {
+    int i = 0;
+    while (i < num_scopes && scope_names[i] != name) {
+        i++;
+    }
+    if (i == num_scopes) {
+        if (num_scopes == kMaxScopes) {
+            // Out of scopes, attribute to the enclosing scope.
+            return;
+        }
+        scope_names[num_scopes++] = name;
+    }
+    cur_scope = i;
+}
+
+GLTraceScope::~GLTraceScope() {
+    cur_scope = prev_;
+}
+
+} // namespace tcm
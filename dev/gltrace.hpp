@@ -0,0 +1,30 @@
+// gltrace.hpp - OpenGL call statistics.
+#pragma once
+
+namespace tcm {
+
+// Install the tracing layer. Must be called after GLEW is initialized, before
+// other OpenGL calls. Also enables KHR_debug output if available. Does nothing
+// on platforms without GLEW.
+void GLTraceInit();
+
+// Finish a frame. Call counts for the frame are shown in the overlay.
+void GLTraceEndFrame();
+
+// Print the per-function call counts for the last frame.
+void GLTraceDump();
+
+// Attribute OpenGL calls to a named scope while this object exists. The name
+// must have static storage duration.
+class GLTraceScope {
+public:
+    explicit GLTraceScope(const char *name);
+    GLTraceScope(const GLTraceScope &) = delete;
+    ~GLTraceScope();
+    GLTraceScope &operator=(const GLTraceScope &) = delete;
+
+private:
+    int prev_;
+};
+
+} // namespace tcm
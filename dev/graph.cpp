@@ -0,0 +1,184 @@
+// graph.cpp - Frame time graph.
+//
+// Frame times are kept in a ring buffer in a GPU buffer object, and each frame
+// only the new samples are written. The whole graph is drawn with a single
+// instanced draw call, one instance per sample column. The shader scrolls the
+// columns so the oldest sample is on the left.
+#include "dev/graph.hpp"
+
+#include "dev/shader.hpp"
+#include "dev/text.hpp"
+#include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace tcm {
+
+namespace {
+
+// Number of samples in the graph, one pixel each.
+const int kSamples = 256;
+
+// Number of frames of GPU queries in flight.
+const int kPending = 4;
+
+// Frame time budget, in milliseconds.
+const float kBudget = 1000.0f / 60.0f;
+
+// Graph position and size, in overlay pixels.
+const int kX = 8;
+const int kHeight = 64;
+const int kY = OverlayHeight - 8 - kHeight;
+
+// Vertical scale, in pixels per millisecond. The budget line is halfway up.
+const float kPixelsPerMs = kHeight / (2.0f * kBudget);
+
+// How often the labels are updated, in frames.
+const int kLabelInterval = 15;
+
+struct Sample {
+    float cpu;
+    float gpu;
+};
+
+// A frame whose GPU time is not yet known.
+struct Pending {
+    float cpu;
+    GLuint query[2];
+};
+
+Shader *shader_vert;
+Shader *shader_frag;
+Program *program;
+GLuint prog;
+
+GLuint arr;
+GLuint buf;
+// Index of the next sample to write.
+int head;
+
+Pending pending[kPending];
+// Frames from pending_tail to pending_head are waiting for results.
+unsigned pending_head;
+unsigned pending_tail;
+std::chrono::steady_clock::time_point frame_start;
+
+TextLabel *label;
+Sample label_max;
+int label_frames;
+
+// Add a sample to the graph.
+void AddSample(Sample sample) {
+    glstate_bind_buffer(GL_ARRAY_BUFFER, buf);
+    glBufferSubData(GL_ARRAY_BUFFER, head * sizeof(Sample), sizeof(Sample),
+                    &sample);
+    head = (head + 1) % kSamples;
+
+    // Show the worst frame since the last update.
+    label_max.cpu = std::max(label_max.cpu, sample.cpu);
+    label_max.gpu = std::max(label_max.gpu, sample.gpu);
+    if (++label_frames >= kLabelInterval) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "CPU %5.2f ms  GPU %5.2f ms",
+                      label_max.cpu, label_max.gpu);
+        label->Set(text);
+        label_max = Sample{0.0f, 0.0f};
+        label_frames = 0;
+    }
+}
+
+} // namespace
+
+void GraphInit() {
+    shader_vert = new Shader(DevShaderDir + "graph.vert", GL_VERTEX_SHADER);
+    shader_frag = new Shader(DevShaderDir + "graph.frag", GL_FRAGMENT_SHADER);
+    program = new Program(&prog, "graph", {shader_vert, shader_frag});
+    label = new TextLabel(kX, kY - 16);
+
+    glGenVertexArrays(1, &arr);
+    glstate_bind_vertex_array(arr);
+    glGenBuffers(1, &buf);
+    memtrack_add(MEMTRACK_BUFFER, buf, "graph");
+    memtrack_set_size(MEMTRACK_BUFFER, buf, sizeof(Sample) * kSamples);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, buf);
+    Sample zero[kSamples] = {};
+    glBufferData(GL_ARRAY_BUFFER, sizeof(zero), zero, GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 1);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Sample), 0);
+
+    for (Pending &p : pending) {
+        glGenQueries(2, p.query);
+    }
+}
+
+void GraphTerm() {
+    glstate_delete_buffers(1, &buf);
+    glstate_delete_vertex_arrays(1, &arr);
+    buf = 0;
+    arr = 0;
+    for (Pending &p : pending) {
+        glDeleteQueries(2, p.query);
+    }
+    delete program;
+    delete shader_vert;
+    delete shader_frag;
+    delete label;
+}
+
+void GraphBeginFrame() {
+    frame_start = std::chrono::steady_clock::now();
+    if (pending_head - pending_tail >= kPending) {
+        // Results are too far behind, skip this frame.
+        return;
+    }
+    glQueryCounter(pending[pending_head % kPending].query[0], GL_TIMESTAMP);
+}
+
+void GraphEndFrame() {
+    std::chrono::duration<float, std::milli> cpu =
+        std::chrono::steady_clock::now() - frame_start;
+    if (pending_head - pending_tail < kPending) {
+        Pending &p = pending[pending_head % kPending];
+        p.cpu = cpu.count();
+        glQueryCounter(p.query[1], GL_TIMESTAMP);
+        pending_head++;
+    }
+    while (pending_tail != pending_head) {
+        const Pending &p = pending[pending_tail % kPending];
+        GLint available;
+        glGetQueryObjectiv(p.query[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        GLint64 t0, t1;
+        glGetQueryObjecti64v(p.query[0], GL_QUERY_RESULT, &t0);
+        glGetQueryObjecti64v(p.query[1], GL_QUERY_RESULT, &t1);
+        AddSample(Sample{p.cpu, (t1 - t0) * 1e-6f});
+        pending_tail++;
+    }
+}
+
+void GraphDraw() {
+    if (prog == 0) {
+        return;
+    }
+    glstate_use_program(prog);
+    glstate_bind_vertex_array(arr);
+    glstate_set_blend(true);
+    glstate_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUniform2f(glGetUniformLocation(prog, "origin"), kX, kY);
+    glUniform2f(glGetUniformLocation(prog, "size"), kSamples, kHeight);
+    glUniform1i(glGetUniformLocation(prog, "head"), head);
+    glUniform1i(glGetUniformLocation(prog, "count"), kSamples);
+    glUniform1f(glGetUniformLocation(prog, "ms_scale"), kPixelsPerMs);
+    glUniform1f(glGetUniformLocation(prog, "budget"), kBudget * kPixelsPerMs);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, kSamples);
+    glstate_set_blend(false);
+}
+
+} // namespace tcm
@@ -0,0 +1,20 @@
+// graph.hpp - Frame time graph.
+#pragma once
+
+namespace tcm {
+
+void GraphInit();
+
+// Release the resources used for the graph.
+void GraphTerm();
+
+// Mark the start of a frame's work.
+void GraphBeginFrame();
+
+// Mark the end of a frame's work, before swapping buffers.
+void GraphEndFrame();
+
+// Draw the graph on the overlay.
+void GraphDraw();
+
+} // namespace tcm
@@ -2,6 +2,8 @@
 
 #include "dev/callback.hpp"
 #include "dev/log.hpp"
+#include "dev/replay.hpp"
+#include "dev/trace.hpp"
 
 #include <errno.h>
 #include <fcntl.h>
@@ -95,6 +97,7 @@ bool TimeEqual(const timespec &x, const timespec &y) {
 
 // A pending file change to report.
 struct Change {
+    const std::string *path;
     WatchCallback *callback;
     DataBuffer data;
 };
@@ -110,6 +113,11 @@ public:
     // Poll the file for changes.
     void Poll();
 
+    // Call the callback with the given contents, in place of the file on disk.
+    void Replay(const DataBuffer &data) { callback_(data); }
+
+    const std::string &path() const { return path_; }
+
 private:
     struct Contents {
         static Contents Error(int error) { return {nullptr, {0, 0}, error}; }
@@ -132,7 +140,7 @@ Watch::Watch(std::string path, WatchCallback callback)
 
 void Watch::GetChange(std::vector<Change> *changes) {
     if (changed_) {
-        changes->push_back({&callback_, contents_.data});
+        changes->push_back({&path_, &callback_, contents_.data});
     }
     changed_ = false;
 }
@@ -187,12 +195,31 @@ std::vector<Change> GetChanges() {
 
 bool PollFilesScheduled;
 
+// Deliver the file changes recorded for this frame, instead of reading files.
+void ReplayFiles() {
+    for (const auto &change : ReplayFileChanges()) {
+        for (auto &watch : watches) {
+            if (watch->path() == change.first) {
+                watch->Replay(change.second);
+            }
+        }
+    }
+}
+
 void PollFiles() {
+    TraceSpan span{"PollFiles"};
+    if (IsReplaying()) {
+        ReplayFiles();
+        return;
+    }
     for (auto &watch : watches) {
         watch->Poll();
     }
     const std::vector<Change> changes = GetChanges();
     for (const auto &change : changes) {
+        if (IsRecording()) {
+            RecordFileChange(*change.path, change.data);
+        }
         (*change.callback)(change.data);
     }
 }
@@ -1,5 +1,15 @@
 #include "dev/log.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,48 +35,285 @@ const struct GLErrorCode GLERROR_CODES[] = {
     {0x0506, "INVALID_FRAMEBUFFER_OPERATION"},
 };
 
-} // namespace
+// Maximum number of threads which can log through rings. Other threads write
+// directly.
+const int kMaxThreads = 16;
 
-const char *GLErrorName(int glerror) {
-    for (const auto &code : GLERROR_CODES) {
-        if (code.value == glerror) {
-            return code.name;
+// Number of messages in each ring. Must be a power of two.
+const uint64_t kRingSize = 1024;
+
+// Maximum message length, including nul terminator. Longer messages are
+// truncated.
+const size_t kMaxMessage = 256;
+
+// How often the logging thread checks for messages.
+const std::chrono::milliseconds kPollInterval{10};
+
+// Repeats of a message within this many nanoseconds of the previous copy are
+// collapsed. While they continue, the count is written this often.
+const int64_t kRepeatWindow = 1000000000;
+
+enum class Level {
+    Info,
+    Warning,
+    Error,
+};
+
+const char *const kLevelPrefix[] = {"", "Warning: ", "Error: "};
+
+struct Message {
+    int64_t time;
+    unsigned frame;
+    Level level;
+    char text[kMaxMessage];
+};
+
+// Messages from one thread. Only that thread writes to the ring, and only the
+// thread holding drain_mutex reads from it, so neither side needs a lock.
+struct Ring {
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<unsigned> dropped;
+    Message messages[kRingSize];
+};
+
+Ring rings[kMaxThreads];
+std::atomic<int> num_rings;
+thread_local Ring *thread_ring;
+thread_local bool thread_ring_full;
+
+std::atomic<unsigned> frame;
+const std::chrono::steady_clock::time_point start_time =
+    std::chrono::steady_clock::now();
+
+// Held while writing output.
+std::mutex drain_mutex;
+FILE *output = stderr;
+// The last message written, for collapsing repeats.
+Level last_level;
+char last_text[kMaxMessage];
+int64_t last_time;
+unsigned last_frame;
+unsigned repeats;
+// When the last message or repeat count was written.
+int64_t repeats_written;
+
+// The logging thread. Never destroyed, so exiting with it running is safe.
+std::thread *thread;
+std::mutex thread_mutex;
+std::condition_variable thread_cond;
+bool stopping;
+// Set once the logging thread has stopped, after which messages are written
+// synchronously.
+std::atomic<bool> stopped;
+
+int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start_time)
+        .count();
+}
+
+Ring *ThreadRing() {
+    Ring *r = thread_ring;
+    if (r == nullptr && !thread_ring_full) {
+        int i = num_rings.fetch_add(1, std::memory_order_relaxed);
+        if (i >= kMaxThreads) {
+            thread_ring_full = true;
+            return nullptr;
         }
+        r = &rings[i];
+        thread_ring = r;
     }
-    return nullptr;
+    return r;
+}
+
+void WritePrefix(int64_t time, unsigned frame) {
+    fprintf(output, "[%9.3f %6u] ", time * 1e-9, frame);
 }
 
-static void VError(const char *fmt, va_list ap) {
-    fputs("Error: ", stderr);
-    vfprintf(stderr, fmt, ap);
-    fputc('\n', stderr);
+void WriteRepeats() {
+    if (repeats > 0) {
+        WritePrefix(last_time, last_frame);
+        fprintf(output, "(last message repeated %u times)\n", repeats);
+        repeats = 0;
+    }
 }
 
-static void VErrorErrno(int ecode, const char *fmt, va_list ap) {
-    fputs("Error: ", stderr);
-    vfprintf(stderr, fmt, ap);
-    fputs(": ", stderr);
-    fputs(strerror(ecode), stderr);
-    fputc('\n', stderr);
+// Write a message, unless it repeats the last one. Must hold drain_mutex.
+void WriteMessage(const Message &m) {
+    if (m.level == last_level && strcmp(m.text, last_text) == 0 &&
+        m.time - last_time < kRepeatWindow) {
+        repeats++;
+        last_time = m.time;
+        last_frame = m.frame;
+        if (m.time - repeats_written >= kRepeatWindow) {
+            WriteRepeats();
+            repeats_written = m.time;
+        }
+        return;
+    }
+    WriteRepeats();
+    WritePrefix(m.time, m.frame);
+    fputs(kLevelPrefix[int(m.level)], output);
+    fputs(m.text, output);
+    fputc('\n', output);
+    last_level = m.level;
+    strcpy(last_text, m.text);
+    last_time = m.time;
+    last_frame = m.frame;
+    repeats_written = m.time;
 }
 
-static void VErrorGL(int glerror, const char *fmt, va_list ap) {
-    fputs("Error: ", stderr);
-    vfprintf(stderr, fmt, ap);
-    fputs(": ", stderr);
+// Write all pending messages. Must hold drain_mutex.
+void Drain() {
+    std::vector<const Message *> pending;
+    std::vector<std::pair<Ring *, uint64_t>> heads;
+    unsigned dropped = 0;
+    int n = std::min(num_rings.load(std::memory_order_relaxed), kMaxThreads);
+    for (int i = 0; i < n; i++) {
+        Ring &r = rings[i];
+        dropped += r.dropped.exchange(0, std::memory_order_relaxed);
+        uint64_t head = r.head.load(std::memory_order_acquire);
+        for (uint64_t t = r.tail.load(std::memory_order_relaxed); t != head;
+             t++) {
+            pending.push_back(&r.messages[t & (kRingSize - 1)]);
+        }
+        heads.emplace_back(&r, head);
+    }
+    // Interleave threads in time order.
+    std::stable_sort(std::begin(pending), std::end(pending),
+                     [](const Message *x, const Message *y) {
+                         return x->time < y->time;
+                     });
+    for (const Message *m : pending) {
+        WriteMessage(*m);
+    }
+    for (const auto &h : heads) {
+        h.first->tail.store(h.second, std::memory_order_release);
+    }
+    if (dropped > 0) {
+        WriteRepeats();
+        WritePrefix(Now(), frame.load(std::memory_order_relaxed));
+        fprintf(output, "(%u messages dropped, log buffer full)\n", dropped);
+    }
+    if (repeats > 0 && Now() - last_time >= kRepeatWindow) {
+        WriteRepeats();
+        // Let the next copy be written in full.
+        last_text[0] = '\0';
+    }
+    fflush(output);
+}
+
+void LogThread() {
+    std::unique_lock<std::mutex> lock{thread_mutex};
+    while (!stopping) {
+        thread_cond.wait_for(lock, kPollInterval);
+        std::lock_guard<std::mutex> drain_lock{drain_mutex};
+        Drain();
+    }
+}
+
+// Format a message. The suffix, if not null, is appended after a colon. If
+// sync is true, the message and all pending messages are written before
+// returning.
+void VLog(Level level, bool sync, const char *suffix, const char *fmt,
+          va_list ap) {
+    if (stopped.load(std::memory_order_acquire)) {
+        sync = true;
+    }
+    Ring *r = sync ? nullptr : ThreadRing();
+    Message tmp;
+    Message *m = &tmp;
+    uint64_t head = 0;
+    if (r != nullptr) {
+        head = r->head.load(std::memory_order_relaxed);
+        if (head - r->tail.load(std::memory_order_acquire) >= kRingSize) {
+            r->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m = &r->messages[head & (kRingSize - 1)];
+    }
+    m->time = Now();
+    m->frame = frame.load(std::memory_order_relaxed);
+    m->level = level;
+    int len = vsnprintf(m->text, kMaxMessage, fmt, ap);
+    if (suffix != nullptr && len >= 0 &&
+        static_cast<size_t>(len) < kMaxMessage) {
+        snprintf(m->text + len, kMaxMessage - len, ": %s", suffix);
+    }
+    if (r != nullptr) {
+        r->head.store(head + 1, std::memory_order_release);
+    } else {
+        std::lock_guard<std::mutex> lock{drain_mutex};
+        Drain();
+        WriteMessage(*m);
+        WriteRepeats();
+        fflush(output);
+    }
+}
+
+const char *GLErrorSuffix(int glerror, char (&buf)[32]) {
     const char *name = GLErrorName(glerror);
     if (name == nullptr) {
-        fprintf(stderr, "unknown error (0x%04x)", glerror);
-    } else {
-        fputs(name, stderr);
+        snprintf(buf, sizeof(buf), "unknown error (0x%04x)", glerror);
+        return buf;
+    }
+    return name;
+}
+
+} // namespace
+
+void LogStart(const char *path) {
+    if (path != nullptr) {
+        FILE *fp = fopen(path, "w");
+        if (fp == nullptr) {
+            DieErrno(errno, "Could not open %s", path);
+        }
+        std::lock_guard<std::mutex> lock{drain_mutex};
+        output = fp;
+    }
+    thread = new std::thread{LogThread};
+}
+
+void LogStop() {
+    if (thread != nullptr) {
+        {
+            std::lock_guard<std::mutex> lock{thread_mutex};
+            stopping = true;
+        }
+        thread_cond.notify_all();
+        thread->join();
+        delete thread;
+        thread = nullptr;
     }
-    fputc('\n', stderr);
+    stopped.store(true, std::memory_order_release);
+    LogFlush();
+}
+
+void LogFlush() {
+    std::lock_guard<std::mutex> lock{drain_mutex};
+    Drain();
+    WriteRepeats();
+    fflush(output);
+}
+
+void LogEndFrame() {
+    frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+const char *GLErrorName(int glerror) {
+    for (const auto &code : GLERROR_CODES) {
+        if (code.value == glerror) {
+            return code.name;
+        }
+    }
+    return nullptr;
 }
 
 void Die(const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    VError(fmt, ap);
+    VLog(Level::Error, true, nullptr, fmt, ap);
     va_end(ap);
     exit(1);
 }
@@ -74,7 +321,7 @@ void Die(const char *fmt, ...) {
 void DieErrno(int ecode, const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    VErrorErrno(ecode, fmt, ap);
+    VLog(Level::Error, true, strerror(ecode), fmt, ap);
     va_end(ap);
     exit(1);
 }
@@ -82,31 +329,37 @@ void DieErrno(int ecode, const char *fmt, ...) {
 void Error(const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    VError(fmt, ap);
+    VLog(Level::Error, false, nullptr, fmt, ap);
     va_end(ap);
 }
 
 void ErrorErrno(int ecode, const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    VErrorErrno(ecode, fmt, ap);
+    VLog(Level::Error, false, strerror(ecode), fmt, ap);
     va_end(ap);
 }
 
 void ErrorGL(int glerror, const char *fmt, ...) {
+    char buf[32];
     va_list ap;
     va_start(ap, fmt);
-    VErrorGL(glerror, fmt, ap);
+    VLog(Level::Error, false, GLErrorSuffix(glerror, buf), fmt, ap);
     va_end(ap);
 }
 
 void Warning(const char *fmt, ...) {
-    fputs("Warning: ", stderr);
     va_list ap;
     va_start(ap, fmt);
-    vfprintf(stderr, fmt, ap);
+    VLog(Level::Warning, false, nullptr, fmt, ap);
+    va_end(ap);
+}
+
+void Info(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    VLog(Level::Info, false, nullptr, fmt, ap);
     va_end(ap);
-    fputc('\n', stderr);
 }
 
 } // namespace tcm
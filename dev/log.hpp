@@ -2,10 +2,32 @@
 
 namespace tcm {
 
+// Messages are formatted into a ring buffer for the calling thread, and written
+// by a background thread, so logging never waits for I/O. Each message is
+// prefixed with the time since startup and the frame number. Repeats of the
+// same message in quick succession are collapsed into a count, which is written
+// at least once a second while the repeats continue.
+
+// Start the logging thread. Messages are written to the given file, or to
+// stderr if the path is null. Messages logged before this are kept until the
+// thread starts.
+void LogStart(const char *path);
+
+// Write all pending messages and stop the logging thread. Messages logged after
+// this are written immediately.
+void LogStop();
+
+// Write all pending messages now.
+void LogFlush();
+
+// Advance the frame number shown in messages.
+void LogEndFrame();
+
 // Return the name of the given error code returned from glError.
 const char *GLErrorName(int glerror);
 
-// Print an error message and exit the program.
+// Print an error message and exit the program. Pending messages are written
+// first.
 void Die(const char *fmt, ...) __attribute__((noreturn, format(printf, 1, 2)));
 
 // Print an error message with an errno error code and exit the program.
@@ -26,4 +48,7 @@ void ErrorGL(int glerror, const char *fmt, ...)
 // Print a warning message.
 void Warning(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
 
+// Print an informational message.
+void Info(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
 } // namespace tcm
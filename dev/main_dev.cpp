@@ -5,18 +5,37 @@
 #define GLFW_INCLUDE_NONE
 
 #include "dev/callback.hpp"
+#include "dev/glcapture.hpp"
+#include "dev/gltrace.hpp"
+#include "dev/graph.hpp"
 #include "dev/loader.hpp"
 #include "dev/log.hpp"
+#include "dev/replay.hpp"
 #include "dev/screenshot.hpp"
 #include "dev/shader.hpp"
 #include "dev/text.hpp"
+#include "dev/trace.hpp"
+#include "dev/upload.hpp"
+#include "tcm/audio.h"
+#include "tcm/clock.h"
 #include "tcm/demo.h"
 #include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
+#include "tcm/particles.h"
+#include "tcm/post.h"
 #include "tcm/shaders.h"
+#include "tcm/stream.h"
 
 #include <GLFW/glfw3.h>
 
+#include <cerrno>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
 
 namespace tcm {
 
@@ -28,12 +47,38 @@ void GLInit() {
 #endif
 }
 
-void KeyCallback(GLFWwindow *window, int key, int scancode, int action,
-                 int mods) {
-    (void)window;
-    (void)scancode;
-    (void)mods;
+void HandleKey(int key, int action) {
     switch (key) {
+    case GLFW_KEY_F5:
+        if (action == GLFW_PRESS) {
+            post_set_effects(post_effects() ^ POST_BLOOM);
+        }
+        break;
+    case GLFW_KEY_F6:
+        if (action == GLFW_PRESS) {
+            post_set_effects(post_effects() ^ POST_BLUR);
+        }
+        break;
+    case GLFW_KEY_F7:
+        if (action == GLFW_PRESS) {
+            post_set_effects(post_effects() ^ POST_TONEMAP);
+        }
+        break;
+    case GLFW_KEY_F9:
+        if (action == GLFW_PRESS) {
+            GLCaptureNextFrame();
+        }
+        break;
+    case GLFW_KEY_F10:
+        if (action == GLFW_PRESS) {
+            GLTraceDump();
+        }
+        break;
+    case GLFW_KEY_F11:
+        if (action == GLFW_PRESS) {
+            TraceDump();
+        }
+        break;
     case GLFW_KEY_F12:
         if (action == GLFW_PRESS) {
             CaptureScreenshot();
@@ -42,10 +87,283 @@ void KeyCallback(GLFWwindow *window, int key, int scancode, int action,
     }
 }
 
+void KeyCallback(GLFWwindow *window, int key, int scancode, int action,
+                 int mods) {
+    (void)window;
+    (void)scancode;
+    // While replaying, keys come from the recording instead.
+    if (IsReplaying()) {
+        return;
+    }
+    if (IsRecording()) {
+        RecordKey(key, action, mods);
+    }
+    HandleKey(key, action);
+}
+
+// Show the number of state changes in the last frame.
+void ShowStateStats() {
+    static StatusItem status{"GL state"};
+    glstate_stats stats = glstate_frame_stats();
+    char text[64];
+    std::snprintf(text, sizeof(text), "%u issued, %u skipped", stats.issued,
+                  stats.skipped);
+    status.Set(text);
+}
+
+// Show the resources allocated.
+void ShowMemoryStats() {
+    static StatusItem status{"Memory"};
+    memtrack_totals totals = memtrack_get_totals();
+    std::string text;
+    for (int i = 0; i < MEMTRACK_KIND_COUNT; i++) {
+        char item[64];
+        std::snprintf(item, sizeof(item), "%s%u %s, %.1f KiB",
+                      i == 0 ? "" : "; ", totals.count[i],
+                      memtrack_kind_name(static_cast<memtrack_kind>(i)),
+                      totals.bytes[i] / 1024.0);
+        text.append(item);
+    }
+    status.Set(std::move(text));
+}
+
+// Show the amount of data streamed in the last frame.
+void ShowStreamStats() {
+    static StatusItem status{"Stream"};
+    stream_stats stats = stream_frame_stats();
+    char text[96];
+    std::snprintf(text, sizeof(text),
+                  "%zu bytes, %u stalls, %u orphans, %u failures", stats.bytes,
+                  stats.stalls, stats.orphans, stats.failures);
+    status.Set(text);
+}
+
+// Show which post-processing effects are enabled, and the time spent in each
+// kind of pass.
+void ShowPostStats() {
+    static StatusItem status{"Post"};
+    unsigned effects = post_effects();
+    post_timings timings = post_get_timings();
+    char text[96];
+    std::snprintf(text, sizeof(text), "bloom %s, blur %s, tonemap %s",
+                  (effects & POST_BLOOM) ? "on" : "off",
+                  (effects & POST_BLUR) ? "on" : "off",
+                  (effects & POST_TONEMAP) ? "on" : "off");
+    std::string line{text};
+    for (int i = 0; i < POST_PASS_COUNT; i++) {
+        if (timings.count[i] == 0) {
+            continue;
+        }
+        std::snprintf(text, sizeof(text), "\n  %s: %.3f ms, %d passes",
+                      post_pass_name(static_cast<post_pass>(i)),
+                      timings.ms[i], timings.count[i]);
+        line.append(text);
+    }
+    status.Set(std::move(line));
+}
+
+// Write the resources which were not released to the log, one message per
+// line.
+void ReportLeaks() {
+    char *text = nullptr;
+    size_t size = 0;
+    FILE *fp = open_memstream(&text, &size);
+    if (fp == nullptr) {
+        ErrorErrno(errno, "Could not report leaks");
+        return;
+    }
+    memtrack_report(fp);
+    std::fclose(fp);
+    for (char *line = text; *line != '\0';) {
+        char *end = std::strchr(line, '\n');
+        if (end == nullptr) {
+            end = line + std::strlen(line);
+        }
+        Warning("%.*s", static_cast<int>(end - line), line);
+        line = *end == '\0' ? end : end + 1;
+    }
+    std::free(text);
+}
+
+// Run the demo until the window is closed.
+void Run(GLFWwindow *window, audio_sink sink) {
+    Shader triangle_vert(ShaderDir + "triangle.vert", GL_VERTEX_SHADER);
+    Shader triangle_frag(ShaderDir + "triangle.frag", GL_FRAGMENT_SHADER);
+    Program triangle_prog(&shader_triangle, "triangle",
+                          {&triangle_vert, &triangle_frag});
+    Shader line_vert(ShaderDir + "line.vert", GL_VERTEX_SHADER);
+    Shader line_geom(ShaderDir + "line.geom", GL_GEOMETRY_SHADER);
+    Shader line_frag(ShaderDir + "line.frag", GL_FRAGMENT_SHADER);
+    Program line_prog(&shader_line, "line",
+                      {&line_vert, &line_geom, &line_frag});
+    Shader dragon_instanced_vert(ShaderDir + "dragon_instanced.vert",
+                                 GL_VERTEX_SHADER);
+    Program dragon_instanced_prog(&shader_dragon_instanced, "dragon_instanced",
+                                  {&dragon_instanced_vert, &line_geom,
+                                   &line_frag});
+    Shader curve_vert(ShaderDir + "curve.vert", GL_VERTEX_SHADER);
+    Program curve_prog(&shader_curve, "curve",
+                       {&curve_vert, &line_geom, &line_frag});
+    Shader particle_update_vert(ShaderDir + "particle_update.vert",
+                                GL_VERTEX_SHADER);
+    Program particle_update_prog(
+        &shader_particle_update, "particle_update", {&particle_update_vert},
+        {std::begin(PARTICLE_VARYINGS), std::end(PARTICLE_VARYINGS)});
+    Shader particle_vert(ShaderDir + "particle.vert", GL_VERTEX_SHADER);
+    Shader particle_frag(ShaderDir + "particle.frag", GL_FRAGMENT_SHADER);
+    Program particle_prog(&shader_particle, "particle",
+                          {&particle_vert, &particle_frag});
+    Shader post_vert(ShaderDir + "post.vert", GL_VERTEX_SHADER);
+    Shader post_prefilter_frag(ShaderDir + "post_prefilter.frag",
+                               GL_FRAGMENT_SHADER);
+    Program post_prefilter_prog(&shader_post_prefilter, "post_prefilter",
+                                {&post_vert, &post_prefilter_frag});
+    Shader post_down_frag(ShaderDir + "post_down.frag", GL_FRAGMENT_SHADER);
+    Program post_down_prog(&shader_post_down, "post_down",
+                           {&post_vert, &post_down_frag});
+    Shader post_blur_frag(ShaderDir + "post_blur.frag", GL_FRAGMENT_SHADER);
+    Program post_blur_prog(&shader_post_blur, "post_blur",
+                           {&post_vert, &post_blur_frag});
+    Shader post_up_frag(ShaderDir + "post_up.frag", GL_FRAGMENT_SHADER);
+    Program post_up_prog(&shader_post_up, "post_up",
+                         {&post_vert, &post_up_frag});
+    Shader post_composite_frag(ShaderDir + "post_composite.frag",
+                               GL_FRAGMENT_SHADER);
+    Program post_composite_prog(&shader_post_composite, "post_composite",
+                                {&post_vert, &post_composite_frag});
+    VariantBuilder variants;
+    variants.Add(SHADER_PROGRAM_LINE, ShaderDir + "line.vert",
+                 GL_VERTEX_SHADER, {&line_geom, &line_frag});
+    variants.Add(SHADER_PROGRAM_DRAGON_INSTANCED,
+                 ShaderDir + "dragon_instanced.vert", GL_VERTEX_SHADER,
+                 {&line_geom, &line_frag});
+    variants.Add(SHADER_PROGRAM_POST_COMPOSITE,
+                 ShaderDir + "post_composite.frag", GL_FRAGMENT_SHADER,
+                 {&post_vert});
+    demo_init();
+    // Pass timings are shown in the overlay.
+    post_set_timing(true);
+    audio_init(sink);
+
+    demo_clock clock;
+    demo_clock_init(&clock, glfwGetTime());
+    int replay_frames = 0;
+    double replay_start = glfwGetTime();
+    while (!glfwWindowShouldClose(window)) {
+        ReplayFrame frame;
+        if (IsReplaying()) {
+            if (!ReplayBeginFrame(&frame)) {
+                double elapsed = glfwGetTime() - replay_start;
+                Info("Replayed %d frames in %.3f s, %.3f ms/frame",
+                     replay_frames, elapsed,
+                     replay_frames > 0 ? elapsed * 1e3 / replay_frames : 0.0);
+                break;
+            }
+            replay_frames++;
+        }
+        TraceSpan frame_span{"frame"};
+        GraphBeginFrame();
+        // Variants asked for last frame start compiling this frame.
+        variants.Update();
+        {
+            TraceSpan span{"InvokeCallbacks"};
+            GLTraceScope scope{"callbacks"};
+            InvokeCallbacks();
+        }
+
+        if (!IsReplaying()) {
+            frame.wall = glfwGetTime();
+            frame.time = demo_clock_update(&clock, frame.wall);
+            glfwGetFramebufferSize(window, &frame.width, &frame.height);
+            if (IsRecording()) {
+                RecordFrame(frame);
+            }
+        }
+        // While replaying, the recorded size is used even if the window is a
+        // different size, so the same work is done.
+        const int width = frame.width, height = frame.height;
+
+        GLCaptureBegin(width, height);
+        {
+            TraceSpan span{"demo_draw"};
+            GpuTraceSpan gpu_span{"demo_draw"};
+            GLTraceScope scope{"demo"};
+            demo_draw(frame.time, width, height);
+        }
+        {
+            TraceSpan span{"TextDraw"};
+            GpuTraceSpan gpu_span{"TextDraw"};
+            GLTraceScope scope{"text"};
+            TextDraw();
+            GraphDraw();
+        }
+        GLCaptureEnd();
+        GraphEndFrame();
+        LogEndFrame();
+        glstate_end_frame();
+        stream_end_frame();
+        GLTraceEndFrame();
+        TraceEndFrame();
+        ShowStateStats();
+        ShowStreamStats();
+        ShowMemoryStats();
+        ShowPostStats();
+
+        {
+            TraceSpan span{"glfwSwapBuffers"};
+            glfwSwapBuffers(window);
+        }
+        {
+            TraceSpan span{"glfwPollEvents"};
+            glfwPollEvents();
+        }
+        if (IsReplaying()) {
+            for (const ReplayKey &key : ReplayEndFrame()) {
+                HandleKey(key.key, key.action);
+            }
+        }
+    }
+
+    audio_term();
+}
+
 int Main(int argc, char **argv) {
-    (void)argc;
-    (void)argv;
+    audio_sink sink = AUDIO_SINK_DEVICE;
+    const char *log_path = nullptr;
+    const char *record_path = nullptr;
+    const char *replay_path = nullptr;
+    bool headless = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--null-audio") == 0) {
+            sink = AUDIO_SINK_NULL;
+        } else if (std::strncmp(argv[i], "--log=", 6) == 0) {
+            log_path = argv[i] + 6;
+        } else if (std::strncmp(argv[i], "--record=", 9) == 0) {
+            record_path = argv[i] + 9;
+        } else if (std::strncmp(argv[i], "--replay=", 9) == 0) {
+            replay_path = argv[i] + 9;
+        } else if (std::strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+            sink = AUDIO_SINK_NULL;
+        } else {
+            Die("Unknown option: %s", argv[i]);
+        }
+    }
+    if (record_path != nullptr && replay_path != nullptr) {
+        Die("Cannot use both --record and --replay");
+    }
     ChdirWorkspaceRoot();
+    LogStart(log_path);
+    if (record_path != nullptr) {
+        RecordStart(record_path);
+    }
+    if (replay_path != nullptr) {
+        ReplayStart(replay_path);
+    }
+
+    // Start preparing assets while the window is created.
+    UploadStart();
+    TextLoadFont();
 
     if (!glfwInit()) {
         Die("Could not initialize GLFW");
@@ -70,6 +388,11 @@ int Main(int argc, char **argv) {
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // Debug contexts report performance warnings through KHR_debug.
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+    if (headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
 
     GLFWwindow *window = glfwCreateWindow(
         640, 360, "Terrestrial Collection Machine", NULL, NULL);
@@ -79,35 +402,32 @@ int Main(int argc, char **argv) {
     }
 
     glfwMakeContextCurrent(window);
-    fprintf(stderr, "GL_VERSION: %s\n", glGetString(GL_VERSION));
-    fprintf(stderr, "GL_VENDOR: %s\n", glGetString(GL_VENDOR));
-    fprintf(stderr, "GL_RENDERER: %s\n", glGetString(GL_RENDERER));
+    if (headless) {
+        // Don't wait for vertical sync.
+        glfwSwapInterval(0);
+    }
+    Info("GL_VERSION: %s", glGetString(GL_VERSION));
+    Info("GL_VENDOR: %s", glGetString(GL_VENDOR));
+    Info("GL_RENDERER: %s", glGetString(GL_RENDERER));
     GLInit();
+    GLTraceInit();
+    TraceInit();
+    UploadSetContext(window);
     TextInit();
+    GraphInit();
     glfwSetKeyCallback(window, KeyCallback);
 
-    Shader triangle_vert(ShaderDir + "triangle.vert", GL_VERTEX_SHADER);
-    Shader triangle_frag(ShaderDir + "triangle.frag", GL_FRAGMENT_SHADER);
-    Program triangle_prog(&shader_triangle, "triangle",
-                          {&triangle_vert, &triangle_frag});
-    Shader line_vert(ShaderDir + "line.vert", GL_VERTEX_SHADER);
-    Shader line_geom(ShaderDir + "line.geom", GL_GEOMETRY_SHADER);
-    Shader line_frag(ShaderDir + "line.frag", GL_FRAGMENT_SHADER);
-    Program line_prog(&shader_line, "line",
-                      {&line_vert, &line_geom, &line_frag});
-    demo_init();
-
-    while (!glfwWindowShouldClose(window)) {
-        InvokeCallbacks();
-
-        double time = glfwGetTime();
-
-        demo_draw(time);
-        TextDraw();
+    Run(window, sink);
+    RecordStop();
+    UploadStop();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+    // Release everything, so anything left over is a leak.
+    GraphTerm();
+    TextTerm();
+    demo_term();
+    stream_term();
+    ReportLeaks();
+    LogStop();
 
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -0,0 +1,221 @@
+#include "dev/replay.hpp"
+
+#include "dev/log.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace tcm {
+
+namespace {
+
+// File format:
+//
+// The file starts with the magic "TCMREC2\n". This is followed by records,
+// each starting with a type byte. All numbers are little-endian.
+//
+// - File change: u32 path length, path, i32 error (0 or 1 if the file could
+//   not be read), u32 data length, data.
+// - Frame: f64 wall time, f64 demo time, i32 framebuffer width, i32
+//   framebuffer height.
+// - Key: i16 key, u8 action, u8 mods.
+//
+// Each frame is the file changes which happen before the frame's time is
+// read, then the frame record, then the key events received at the end of the
+// frame.
+
+const char Magic[] = "TCMREC2\n";
+const size_t MagicSize = sizeof(Magic) - 1;
+
+enum RecordType : uint8_t {
+    kFileChange = 1,
+    kFrame = 2,
+    kKey = 3,
+};
+
+// =============================================================================
+// Recording
+// =============================================================================
+
+std::FILE *record_file;
+std::string record_path;
+
+void Write(const void *data, size_t size) {
+    // Not every short write sets errno.
+    errno = 0;
+    if (std::fwrite(data, 1, size, record_file) != size) {
+        if (std::ferror(record_file) && errno != 0) {
+            DieErrno(errno, "%s", record_path.c_str());
+        }
+        Die("%s: Could not write recording", record_path.c_str());
+    }
+}
+
+template <typename T>
+void WriteValue(T value) {
+    // All supported platforms are little-endian.
+    Write(&value, sizeof(value));
+}
+
+// =============================================================================
+// Replay
+// =============================================================================
+
+std::vector<unsigned char> replay_data;
+size_t replay_pos;
+bool replaying;
+std::vector<std::pair<std::string, DataBuffer>> replay_files;
+
+[[noreturn]] void Corrupt() {
+    Die("Replay: Corrupt recording at offset %zu", replay_pos);
+}
+
+void Read(void *data, size_t size) {
+    if (size > replay_data.size() - replay_pos) {
+        Corrupt();
+    }
+    std::memcpy(data, replay_data.data() + replay_pos, size);
+    replay_pos += size;
+}
+
+template <typename T>
+T ReadValue() {
+    T value;
+    Read(&value, sizeof(value));
+    return value;
+}
+
+// Return the type of the next record, or 0 at the end.
+int PeekType() {
+    if (replay_pos >= replay_data.size()) {
+        return 0;
+    }
+    return replay_data[replay_pos];
+}
+
+} // namespace
+
+void RecordStart(const std::string &path) {
+    record_file = std::fopen(path.c_str(), "wb");
+    if (record_file == nullptr) {
+        DieErrno(errno, "%s", path.c_str());
+    }
+    record_path = path;
+    Write(Magic, MagicSize);
+    Info("Recording to %s", path.c_str());
+}
+
+void RecordStop() {
+    if (record_file == nullptr) {
+        return;
+    }
+    if (std::fclose(record_file) != 0) {
+        ErrorErrno(errno, "%s", record_path.c_str());
+    }
+    record_file = nullptr;
+}
+
+bool IsRecording() {
+    return record_file != nullptr;
+}
+
+void RecordFrame(const ReplayFrame &frame) {
+    WriteValue<uint8_t>(kFrame);
+    WriteValue<double>(frame.wall);
+    WriteValue<double>(frame.time);
+    WriteValue<int32_t>(frame.width);
+    WriteValue<int32_t>(frame.height);
+}
+
+void RecordKey(int key, int action, int mods) {
+    WriteValue<uint8_t>(kKey);
+    WriteValue<int16_t>(key);
+    WriteValue<uint8_t>(action);
+    WriteValue<uint8_t>(mods);
+}
+
+void RecordFileChange(const std::string &path, const DataBuffer &data) {
+    WriteValue<uint8_t>(kFileChange);
+    WriteValue<uint32_t>(path.size());
+    Write(path.data(), path.size());
+    WriteValue<int32_t>(data ? 0 : 1);
+    WriteValue<uint32_t>(data ? data->size() : 0);
+    if (data) {
+        Write(data->data(), data->size());
+    }
+}
+
+void ReplayStart(const std::string &path) {
+    std::vector<char> data;
+    int r = ReadFile(path, &data);
+    if (r != 0) {
+        DieErrno(r, "%s", path.c_str());
+    }
+    if (data.size() < MagicSize ||
+        std::memcmp(data.data(), Magic, MagicSize) != 0) {
+        Die("%s: Not a recording", path.c_str());
+    }
+    replay_data.assign(data.begin(), data.end());
+    replay_pos = MagicSize;
+    replaying = true;
+    Info("Replaying %s", path.c_str());
+}
+
+bool IsReplaying() {
+    return replaying;
+}
+
+bool ReplayBeginFrame(ReplayFrame *frame) {
+    replay_files.clear();
+    for (;;) {
+        switch (PeekType()) {
+        case 0:
+            return false;
+        case kFileChange: {
+            replay_pos++;
+            uint32_t pathlen = ReadValue<uint32_t>();
+            std::string path(pathlen, '\0');
+            Read(&path[0], pathlen);
+            int32_t error = ReadValue<int32_t>();
+            uint32_t size = ReadValue<uint32_t>();
+            DataBuffer data;
+            if (error == 0) {
+                auto buf = std::make_shared<std::vector<char>>(size);
+                Read(buf->data(), size);
+                data = std::move(buf);
+            }
+            replay_files.emplace_back(std::move(path), std::move(data));
+        } break;
+        case kFrame:
+            replay_pos++;
+            frame->wall = ReadValue<double>();
+            frame->time = ReadValue<double>();
+            frame->width = ReadValue<int32_t>();
+            frame->height = ReadValue<int32_t>();
+            return true;
+        default:
+            Corrupt();
+        }
+    }
+}
+
+std::vector<std::pair<std::string, DataBuffer>> ReplayFileChanges() {
+    return std::move(replay_files);
+}
+
+std::vector<ReplayKey> ReplayEndFrame() {
+    std::vector<ReplayKey> keys;
+    while (PeekType() == kKey) {
+        replay_pos++;
+        int key = ReadValue<int16_t>();
+        int action = ReadValue<uint8_t>();
+        int mods = ReadValue<uint8_t>();
+        keys.push_back({key, action, mods});
+    }
+    return keys;
+}
+
+} // namespace tcm
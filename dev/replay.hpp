@@ -0,0 +1,67 @@
+// replay.hpp - Record and replay sessions.
+#pragma once
+
+#include "dev/loader.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tcm {
+
+// A session is recorded as the inputs to each frame: the wall clock and demo
+// time, the framebuffer size, key events, and the contents of watched files as
+// they change. Replaying a session feeds these back in place of the real
+// inputs, so the same frames are drawn again, as fast as possible.
+
+// Start recording the session to a file.
+void RecordStart(const std::string &path);
+
+// Finish writing the recording.
+void RecordStop();
+
+// Return true if the session is being recorded.
+bool IsRecording();
+
+// The inputs read at the start of a frame.
+struct ReplayFrame {
+    double wall;
+    double time;
+    int width;
+    int height;
+};
+
+// Record the times and framebuffer size used for this frame.
+void RecordFrame(const ReplayFrame &frame);
+
+// Record a key event.
+void RecordKey(int key, int action, int mods);
+
+// Record a change to a watched file. The data is null if the file could not be
+// read.
+void RecordFileChange(const std::string &path, const DataBuffer &data);
+
+// Start replaying a recorded session. Exits on failure.
+void ReplayStart(const std::string &path);
+
+// Return true if a session is being replayed.
+bool IsReplaying();
+
+// Start replaying the next frame, and get its times and framebuffer size.
+// Returns false after the last frame.
+bool ReplayBeginFrame(ReplayFrame *frame);
+
+// Get the file changes for the current frame.
+std::vector<std::pair<std::string, DataBuffer>> ReplayFileChanges();
+
+// A recorded key event.
+struct ReplayKey {
+    int key;
+    int action;
+    int mods;
+};
+
+// Finish replaying the current frame, and get its key events.
+std::vector<ReplayKey> ReplayEndFrame();
+
+} // namespace tcm
@@ -6,6 +6,8 @@
 #include "dev/log.hpp"
 #include "dev/path.hpp"
 #include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
 
 #include <memory>
 #include <string>
@@ -46,7 +48,7 @@ Screenshot::Screenshot()
 
 Screenshot::~Screenshot() {
     if (buffer_) {
-        glDeleteBuffers(1, &buffer_);
+        glstate_delete_buffers(1, &buffer_);
     }
 }
 
@@ -59,16 +61,18 @@ void Screenshot::Capture() {
             ErrorGL(glGetError(), "glGenBuffers");
             return;
         }
+        memtrack_add(MEMTRACK_BUFFER, buffer_, "screenshot");
     }
     int x = viewport[0];
     int y = viewport[1];
     int width = viewport[2];
     int height = viewport[3];
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer_);
+    glstate_bind_buffer(GL_PIXEL_PACK_BUFFER, buffer_);
     glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr,
                  GL_STREAM_READ);
+    memtrack_set_size(MEMTRACK_BUFFER, buffer_, width * height * 4);
     glReadPixels(x, y, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8, 0);
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glstate_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
     has_shot_ = true;
     width_ = width;
     height_ = height;
@@ -79,18 +83,18 @@ void Screenshot::Save() {
         return;
     }
     has_shot_ = false;
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer_);
+    glstate_bind_buffer(GL_PIXEL_PACK_BUFFER, buffer_);
     void *data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
     if (data == nullptr) {
         ErrorGL(glGetError(), "glMapBuffer");
     } else {
         std::string path = path_template.Create();
         if (WritePNG(path, data, width_, height_)) {
-            std::fprintf(stderr, "Wrote screenshot %s\n", path.c_str());
+            Info("Wrote screenshot %s", path.c_str());
         }
         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
     }
-    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glstate_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 }
 
 } // namespace
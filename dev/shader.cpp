@@ -1,32 +1,327 @@
 #include "dev/shader.hpp"
 
 #include "dev/log.hpp"
+#include "dev/trace.hpp"
+#include "dev/upload.hpp"
+#include "tcm/frame.h"
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
 
 #include <algorithm>
+#include <memory>
+#include <unordered_map>
 
 namespace tcm {
 
 const std::string ShaderDir{"tcm/shader/"};
 const std::string DevShaderDir{"dev/shader/"};
 
-Shader::Shader(std::string path, GLenum type)
-    : status_{path},
+// A file containing GLSL source code, which may be used by multiple shaders.
+// Files form a graph through their include directives. Each file keeps a list
+// of the shaders which use it, so a change is only propagated to those shaders.
+class SourceFile {
+public:
+    explicit SourceFile(std::string path);
+    SourceFile(const SourceFile &) = delete;
+    SourceFile &operator=(const SourceFile &) = delete;
+
+    const std::string &path() const { return path_; }
+
+    // Return true if the file has been read, or reading has failed.
+    bool loaded() const { return loaded_; }
+
+    // Get the file contents, or nullptr if the file could not be read.
+    const DataBuffer &data() const { return data_; }
+
+    // Get the paths of the files included by this file, in order.
+    const std::vector<std::string> &includes() const { return includes_; }
+
+    void AddUser(Shader *shader) { users_.push_back(shader); }
+    void RemoveUser(Shader *shader);
+
+private:
+    void Load(const DataBuffer &buf);
+
+    const std::string path_;
+    bool loaded_;
+    DataBuffer data_;
+    std::vector<std::string> includes_;
+    std::vector<Shader *> users_;
+};
+
+namespace {
+
+std::unordered_map<std::string, std::unique_ptr<SourceFile>> source_files;
+
+// Get the source file with the given path, watching it if necessary.
+SourceFile *GetSourceFile(const std::string &path) {
+    std::unique_ptr<SourceFile> &file = source_files[path];
+    if (!file) {
+        file = std::make_unique<SourceFile>(path);
+    }
+    return file.get();
+}
+
+// If the line is an include directive, get the included path and return true.
+bool ParseInclude(const char *ptr, const char *end, std::string *path) {
+    auto skip_space = [&]() {
+        while (ptr != end && (*ptr == ' ' || *ptr == '\t')) {
+            ptr++;
+        }
+    };
+    static const char kInclude[] = "include";
+    const size_t kIncludeLen = sizeof(kInclude) - 1;
+    skip_space();
+    if (ptr == end || *ptr != '#') {
+        return false;
+    }
+    ptr++;
+    skip_space();
+    if (static_cast<size_t>(end - ptr) < kIncludeLen ||
+        !std::equal(ptr, ptr + kIncludeLen, kInclude)) {
+        return false;
+    }
+    ptr += kIncludeLen;
+    skip_space();
+    if (ptr == end || *ptr != '"') {
+        return false;
+    }
+    ptr++;
+    const char *start = ptr;
+    while (ptr != end && *ptr != '"') {
+        ptr++;
+    }
+    if (ptr == end || ptr == start) {
+        return false;
+    }
+    path->assign(start, ptr);
+    return true;
+}
+
+// Call a function with each line in a buffer, without the line terminator.
+template <typename F>
+void ForEachLine(const std::vector<char> &data, F f) {
+    const char *ptr = data.data(), *end = ptr + data.size();
+    while (ptr != end) {
+        const char *eol = std::find(ptr, end, '\n');
+        f(ptr, eol);
+        ptr = eol == end ? end : eol + 1;
+    }
+}
+
+// Convert #define lines to a short label, like "DEPTH=5 BLOOM=1".
+std::string DefinesLabel(const std::string &defines) {
+    static const char kDefine[] = "#define ";
+    const size_t kDefineLen = sizeof(kDefine) - 1;
+    std::string label;
+    size_t pos = 0;
+    while (pos < defines.size()) {
+        size_t eol = defines.find('\n', pos);
+        if (eol == std::string::npos) {
+            eol = defines.size();
+        }
+        if (defines.compare(pos, kDefineLen, kDefine) == 0) {
+            std::string def = defines.substr(pos + kDefineLen,
+                                             eol - pos - kDefineLen);
+            std::replace(std::begin(def), std::end(def), ' ', '=');
+            if (!label.empty()) {
+                label.push_back(' ');
+            }
+            label.append(def);
+        }
+        pos = eol + 1;
+    }
+    return label;
+}
+
+// Get the name to show for a shader or program, with its defines.
+std::string VariantName(const std::string &name, const std::string &defines) {
+    if (defines.empty()) {
+        return name;
+    }
+    return name + " " + DefinesLabel(defines);
+}
+
+// Resolve an include path relative to the including file. Leading ".."
+// components are resolved, so a file has the same path however it is included.
+std::string IncludePath(const std::string &from, const std::string &path) {
+    size_t end = from.rfind('/');
+    end = end == std::string::npos ? 0 : end + 1;
+    size_t pos = 0;
+    while (end >= 2 && path.compare(pos, 3, "../") == 0) {
+        size_t slash = from.rfind('/', end - 2);
+        size_t start = slash == std::string::npos ? 0 : slash + 1;
+        if (from.compare(start, end - start, "../") == 0) {
+            break;
+        }
+        end = start;
+        pos += 3;
+    }
+    return from.substr(0, end) + path.substr(pos);
+}
+
+// Append the contents of a source file to the shader text, with includes
+// expanded. Line directives are added so errors refer to the original files,
+// with each file identified by its index in the list of sources.
+void ExpandSource(const std::vector<SourceFile *> &sources, size_t index,
+                  std::vector<bool> *seen, std::string *out) {
+    (*seen)[index] = true;
+    const SourceFile *file = sources[index];
+    int lineno = 0;
+    std::string path;
+    ForEachLine(*file->data(), [&](const char *ptr, const char *end) {
+        lineno++;
+        if (!ParseInclude(ptr, end, &path)) {
+            out->append(ptr, end);
+            out->push_back('\n');
+            return;
+        }
+        path = IncludePath(file->path(), path);
+        auto it = std::find_if(
+            std::begin(sources), std::end(sources),
+            [&](const SourceFile *f) { return f->path() == path; });
+        size_t inc = it - std::begin(sources);
+        if (it == std::end(sources) || (*seen)[inc]) {
+            out->push_back('\n');
+            return;
+        }
+        *out += "#line 1 " + std::to_string(inc) + "\n";
+        ExpandSource(sources, inc, seen, out);
+        *out += "#line " + std::to_string(lineno + 1) + " " +
+                std::to_string(index) + "\n";
+    });
+}
+
+} // namespace
+
+SourceFile::SourceFile(std::string path)
+    : path_{std::move(path)}, loaded_{false} {
+    WatchFile(path_, [this](const DataBuffer &buf) { Load(buf); });
+}
+
+void SourceFile::RemoveUser(Shader *shader) {
+    auto it = std::find(std::begin(users_), std::end(users_), shader);
+    if (it != std::end(users_)) {
+        users_.erase(it);
+    }
+}
+
+void SourceFile::Load(const DataBuffer &buf) {
+    loaded_ = true;
+    data_ = buf;
+    std::vector<std::string> includes;
+    if (buf) {
+        std::string path;
+        ForEachLine(*buf, [&](const char *ptr, const char *end) {
+            if (ParseInclude(ptr, end, &path)) {
+                includes.push_back(IncludePath(path_, path));
+            }
+        });
+    }
+    bool includes_changed = includes != includes_;
+    includes_ = std::move(includes);
+    for (Shader *shader : users_) {
+        shader->SourceChanged(includes_changed);
+    }
+}
+
+Shader::Shader(std::string path, GLenum type, std::string defines)
+    : status_{VariantName(path, defines)},
       path_{std::move(path)},
       type_{type},
+      defines_{std::move(defines)},
       shader_{0},
-      ok_{false} {
-    WatchFile(path_, [this](const DataBuffer &buf) { Load(buf); });
+      ok_{false},
+      compiling_{false},
+      source_changed_{false},
+      includes_changed_{false} {
+    SourceFile *file = GetSourceFile(path_);
+    file->AddUser(this);
+    sources_.push_back(file);
+    if (file->loaded()) {
+        SourceChanged(true);
+    }
+}
+
+Shader::~Shader() {
+    for (SourceFile *file : sources_) {
+        file->RemoveUser(this);
+    }
+    if (shader_ != 0) {
+        glDeleteShader(shader_);
+    }
 }
 
-Shader::~Shader() {}
+void Shader::SourceChanged(bool includes) {
+    includes_changed_ = includes_changed_ || includes;
+    if (!source_changed_) {
+        source_changed_ = true;
+        Schedule([this]() { Compile(); });
+    }
+}
 
-void Shader::Load(const DataBuffer &buf) {
-    if (!buf) {
-        status_.Set("No file.");
-        SetFailed();
+void Shader::UpdateSources() {
+    // Walk the include graph in the same order that includes are expanded.
+    std::vector<SourceFile *> sources;
+    std::vector<SourceFile *> stack{sources_[0]};
+    while (!stack.empty()) {
+        SourceFile *file = stack.back();
+        stack.pop_back();
+        if (std::find(std::begin(sources), std::end(sources), file) !=
+            std::end(sources)) {
+            continue;
+        }
+        sources.push_back(file);
+        const std::vector<std::string> &includes = file->includes();
+        for (auto it = includes.rbegin(); it != includes.rend(); ++it) {
+            stack.push_back(GetSourceFile(*it));
+        }
+    }
+    for (SourceFile *file : sources_) {
+        if (std::find(std::begin(sources), std::end(sources), file) ==
+            std::end(sources)) {
+            file->RemoveUser(this);
+        }
+    }
+    for (SourceFile *file : sources) {
+        if (std::find(std::begin(sources_), std::end(sources_), file) ==
+            std::end(sources_)) {
+            file->AddUser(this);
+        }
+    }
+    sources_ = std::move(sources);
+}
+
+void Shader::Compile() {
+    if (!source_changed_ || compiling_) {
+        // If compiling, this is called again when compilation finishes.
         return;
     }
-    const std::vector<char> &data = *buf;
+    TraceSpan span{"Shader::Compile"};
+    source_changed_ = false;
+    if (includes_changed_) {
+        includes_changed_ = false;
+        UpdateSources();
+    }
+    for (const SourceFile *file : sources_) {
+        if (!file->loaded()) {
+            // Newly included file, which will be read on the next poll.
+            return;
+        }
+        if (!file->data()) {
+            status_.Set("No file: " + file->path());
+            SetFailed();
+            return;
+        }
+    }
+    auto source = std::make_shared<std::string>();
+    std::vector<bool> seen(sources_.size());
+    ExpandSource(sources_, 0, &seen, source.get());
+    if (!defines_.empty()) {
+        size_t eol = source->find('\n');
+        size_t pos = eol == std::string::npos ? source->size() : eol + 1;
+        source->insert(pos, defines_ + "#line 2 0\n");
+    }
     if (shader_ == 0) {
         shader_ = glCreateShader(type_);
         if (shader_ == 0) {
@@ -37,28 +332,58 @@ void Shader::Load(const DataBuffer &buf) {
             return;
         }
     }
-    const char *srctext[1] = {data.data()};
-    const GLint srclen[1] = {static_cast<GLint>(data.size())};
-    glShaderSource(shader_, 1, srctext, srclen);
-    glCompileShader(shader_);
-    GLint status;
-    glGetShaderiv(shader_, GL_COMPILE_STATUS, &status);
+    // Compile on the upload thread, since the driver may block until
+    // compilation is done.
+    struct Result {
+        GLint status;
+        std::vector<char> log;
+    };
+    auto result = std::make_shared<Result>();
+    GLuint shader = shader_;
+    compiling_ = true;
+    Upload(UploadTask{
+        nullptr,
+        [shader, source, result]() {
+            const char *srctext[1] = {source->data()};
+            const GLint srclen[1] = {static_cast<GLint>(source->size())};
+            glShaderSource(shader, 1, srctext, srclen);
+            glCompileShader(shader);
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &result->status);
+            GLint loglen;
+            // loglen includes nul terminator.
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &loglen);
+            if (loglen > 1) {
+                result->log.resize(loglen);
+                glGetShaderInfoLog(shader, loglen, nullptr,
+                                   result->log.data());
+            }
+        },
+        [this, result]() { Compiled(result->status, result->log); },
+    });
+}
+
+void Shader::Compiled(GLint status, const std::vector<char> &log) {
+    compiling_ = false;
     std::string text;
     if (!status) {
         text.append("Compilation failed.\n");
     }
-    GLint loglen;
-    // loglen includes nul terminator.
-    glGetShaderiv(shader_, GL_INFO_LOG_LENGTH, &loglen);
-    if (loglen > 1) {
-        std::vector<char> log(loglen);
-        glGetShaderInfoLog(shader_, loglen, nullptr, log.data());
+    if (!log.empty()) {
         if (text.empty()) {
             text.append("Compilation succeeded.\n");
         }
-        text.append(log.data(), loglen - 1);
+        text.append(log.data(), log.size() - 1);
+        if (sources_.size() > 1) {
+            for (size_t i = 0; i < sources_.size(); i++) {
+                text += "\n" + std::to_string(i) + ": " + sources_[i]->path();
+            }
+        }
     }
     status_.Set(std::move(text));
+    if (source_changed_) {
+        // Changed again while compiling.
+        Schedule([this]() { Compile(); });
+    }
     if (!status) {
         SetFailed();
         return;
@@ -75,10 +400,12 @@ void Shader::SetFailed() {
 }
 
 Program::Program(GLuint *program, std::string name,
-                 std::initializer_list<Shader *> shaders)
+                 std::vector<Shader *> shaders,
+                 std::vector<const char *> varyings)
     : status_{name},
       program_ptr_{program},
       name_{std::move(name)},
+      varyings_{std::move(varyings)},
       program_{0},
       ok_{false},
       shader_changed_{false} {
@@ -94,7 +421,12 @@ Program::Program(GLuint *program, std::string name,
     std::fill(it, std::end(shaders_), nullptr);
 }
 
-Program::~Program() {}
+Program::~Program() {
+    if (program_ != 0) {
+        *program_ptr_ = 0;
+        glstate_delete_program(program_);
+    }
+}
 
 void Program::ShaderChanged() {
     if (!shader_changed_) {
@@ -107,11 +439,16 @@ void Program::Update() {
     if (!shader_changed_) {
         return;
     }
+    TraceSpan span{"Program::Update"};
     shader_changed_ = false;
     GLuint shaders[kMaxShaders];
     for (int i = 0; i < kMaxShaders; i++) {
         Shader *sp = shaders_[i];
         if (sp != nullptr) {
+            if (sp->compiling()) {
+                // Relinked when compilation finishes.
+                return;
+            }
             if (!sp->ok()) {
                 status_.Clear();
                 SetFailed();
@@ -131,11 +468,17 @@ void Program::Update() {
             SetFailed();
             return;
         }
+        memtrack_add(MEMTRACK_PROGRAM, program_, name_.c_str());
         for (int i = 0; i < kMaxShaders; i++) {
             if (shaders[i] != 0) {
                 glAttachShader(program_, shaders[i]);
             }
         }
+        if (!varyings_.empty()) {
+            glTransformFeedbackVaryings(program_, varyings_.size(),
+                                        varyings_.data(),
+                                        GL_INTERLEAVED_ATTRIBS);
+        }
     }
     glLinkProgram(program_);
     GLint status;
@@ -160,6 +503,7 @@ void Program::Update() {
         SetFailed();
         return;
     }
+    frame_bind_block(program_);
     *program_ptr_ = program_;
     ok_ = true;
 }
@@ -169,4 +513,46 @@ void Program::SetFailed() {
     ok_ = false;
 }
 
+VariantBuilder::VariantBuilder() : count_{0} {}
+
+VariantBuilder::~VariantBuilder() = default;
+
+void VariantBuilder::Add(shader_program program, std::string path,
+                         GLenum type, std::vector<Shader *> shared) {
+    sources_[program] = Source{std::move(path), type, std::move(shared)};
+}
+
+void VariantBuilder::Update() {
+    int count;
+    struct shader_variant *variants = shader_variants(&count);
+    for (; count_ < count; count_++) {
+        struct shader_variant &variant = variants[count_];
+        const Source &source = sources_[variant.program];
+        if (source.path.empty()) {
+            Warning("No shaders for variants of %s",
+                    shader_program_name(variant.program));
+            continue;
+        }
+        char buf[256];
+        size_t len = shader_defines(variant.program, &variant.key, buf,
+                                    sizeof(buf));
+        if (len >= sizeof(buf)) {
+            Warning("Shader defines too long for %s",
+                    shader_program_name(variant.program));
+            continue;
+        }
+        std::string defines{buf, len};
+        auto shader =
+            std::make_unique<Shader>(source.path, source.type, defines);
+        std::vector<Shader *> shaders{shader.get()};
+        shaders.insert(std::end(shaders), std::begin(source.shared),
+                       std::end(source.shared));
+        programs_.push_back(std::make_unique<Program>(
+            &variant.id,
+            VariantName(shader_program_name(variant.program), defines),
+            std::move(shaders)));
+        shaders_.push_back(std::move(shader));
+    }
+}
+
 } // namespace tcm
@@ -5,19 +5,30 @@
 #include "dev/loader.hpp"
 #include "dev/text.hpp"
 #include "tcm/gl.h"
+#include "tcm/shaders.h"
 
-#include <initializer_list>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace tcm {
 
+class SourceFile;
+
 extern const std::string ShaderDir;
 extern const std::string DevShaderDir;
 
-// An OpenGL shader.
+// An OpenGL shader. Shaders may include other files with:
+//
+//     #include "name.glsl"
+//
+// Paths are relative to the including file, and each file is included at most
+// once in a shader. A shader is recompiled when any file it includes changes.
+// If defines are given, they are inserted after the first line, which should be
+// the #version line.
 class Shader {
 public:
-    Shader(std::string path, GLenum type);
+    Shader(std::string path, GLenum type, std::string defines = {});
     Shader(const Shader &) = delete;
     Shader &operator=(const Shader &) = delete;
     ~Shader();
@@ -28,12 +39,27 @@ public:
     // Return true if the shader is loaded and compiled.
     bool ok() const { return ok_; }
 
+    // Return true if the shader is being compiled in the background.
+    bool compiling() const { return compiling_; }
+
     // Call a function when the shader changes.
     void OnChanged(Callback cb) { onchanged_.Add(std::move(cb)); }
 
 private:
-    // Load the shader from a file.
-    void Load(const DataBuffer &buf);
+    friend class SourceFile;
+
+    // Respond to a source file changing. If includes is true, the list of
+    // files the source file includes has changed.
+    void SourceChanged(bool includes);
+
+    // Update the set of source files used by this shader.
+    void UpdateSources();
+
+    // Compile the shader from its source files, in the background.
+    void Compile();
+
+    // Finish compiling the shader.
+    void Compiled(GLint status, const std::vector<char> &log);
 
     // Mark the shader as having failed to load or compile.
     void SetFailed();
@@ -41,16 +67,23 @@ private:
     StatusItem status_;
     const std::string path_;
     const GLenum type_;
+    const std::string defines_;
     GLuint shader_;
     bool ok_;
+    bool compiling_;
+    bool source_changed_;
+    bool includes_changed_;
+    // The main source file, and all files it includes, in include order.
+    std::vector<SourceFile *> sources_;
     CallbackList onchanged_;
 };
 
-// An OpenGL shader program.
+// An OpenGL shader program. If varyings are given, they are captured with
+// transform feedback, interleaved in one buffer.
 class Program {
 public:
-    Program(GLuint *program, std::string name,
-            std::initializer_list<Shader *> shaders);
+    Program(GLuint *program, std::string name, std::vector<Shader *> shaders,
+            std::vector<const char *> varyings = {});
     Program(const Program &) = delete;
     Program &operator=(const Program &) = delete;
     ~Program();
@@ -74,9 +107,42 @@ private:
     GLuint *program_ptr_;
     const std::string name_;
     Shader *shaders_[kMaxShaders];
+    const std::vector<const char *> varyings_;
     GLuint program_;
     bool ok_;
     bool shader_changed_;
 };
 
+// Builds the shader variants requested with shader_variant(), in the
+// background. For each program with variants, one shader is compiled for each
+// variant, and linked with shaders shared with the general program.
+class VariantBuilder {
+public:
+    VariantBuilder();
+    VariantBuilder(const VariantBuilder &) = delete;
+    VariantBuilder &operator=(const VariantBuilder &) = delete;
+    ~VariantBuilder();
+
+    // Set the shaders for a program with variants. The shader at path is
+    // compiled with the defines for each variant.
+    void Add(shader_program program, std::string path, GLenum type,
+             std::vector<Shader *> shared);
+
+    // Start building the variants added to the cache since the last call.
+    void Update();
+
+private:
+    struct Source {
+        std::string path;
+        GLenum type;
+        std::vector<Shader *> shared;
+    };
+
+    Source sources_[SHADER_PROGRAM_COUNT];
+    // Number of entries in the variant cache which have been seen.
+    int count_;
+    std::vector<std::unique_ptr<Shader>> shaders_;
+    std::vector<std::unique_ptr<Program>> programs_;
+};
+
 } // namespace tcm
@@ -0,0 +1,29 @@
+#version 330
+
+in VertexData {
+    flat vec2 sample;
+    float height;
+} din;
+
+out vec4 out_color;
+
+// Height of the frame budget line, in pixels.
+uniform float budget;
+
+void main() {
+    vec4 color = vec4(0.0, 0.0, 0.0, 0.5);
+    if (din.sample.x > budget) {
+        // Hitch marker.
+        color = vec4(0.6, 0.0, 0.0, 0.6);
+    }
+    if (din.height < din.sample.x) {
+        color = vec4(0.2, 0.6, 1.0, 1.0);
+    }
+    if (din.height < din.sample.y) {
+        color = vec4(1.0, 0.6, 0.2, 1.0);
+    }
+    if (abs(din.height - budget) < 0.5) {
+        color = vec4(0.2, 1.0, 0.2, 1.0);
+    }
+    out_color = color;
+}
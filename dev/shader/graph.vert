@@ -0,0 +1,26 @@
+#version 330
+
+#include "overlay.glsl"
+
+// Frame times for this column, in milliseconds: CPU, GPU.
+layout(location = 0) in vec2 in_sample;
+
+uniform vec2 origin;
+uniform vec2 size;
+uniform int head;
+uniform int count;
+uniform float ms_scale;
+
+out VertexData {
+    flat vec2 sample;
+    float height;
+} dout;
+
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    float column = float((gl_InstanceID - head + count) % count);
+    vec2 pos = origin + vec2(column + corner.x, size.y * (1.0 - corner.y));
+    dout.sample = in_sample * ms_scale;
+    dout.height = corner.y * size.y;
+    gl_Position = vec4(overlay_to_clip(pos), 0.0, 1.0);
+}
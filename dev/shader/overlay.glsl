@@ -0,0 +1,14 @@
+#include "../../tcm/shader/frame.glsl"
+
+// Size of the overlay coordinate system. Matches OverlayWidth and
+// OverlayHeight in text.hpp.
+const vec2 overlay_size = vec2(640.0, 360.0);
+
+// Convert a position in overlay coordinates, with the origin at the top left,
+// to clip coordinates. The overlay is scaled to fit the framebuffer without
+// stretching.
+vec2 overlay_to_clip(vec2 pos) {
+    float scale = min(resolution.x / overlay_size.x,
+                      resolution.y / overlay_size.y);
+    return vec2(-1.0, 1.0) + vec2(2.0, -2.0) * scale * pos / resolution;
+}
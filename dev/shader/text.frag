@@ -1,5 +1,8 @@
 #version 330
 
+// Draw text from a signed distance field atlas, made by font_sdf.py. Values
+// above 0.5 are inside the glyphs.
+
 in VertexData {
     vec2 texcoord;
 } din;
@@ -9,6 +12,9 @@ out vec4 out_color;
 uniform sampler2D glyphs;
 
 void main() {
-    float a = texture(glyphs, din.texcoord).r;
+    float d = texture(glyphs, din.texcoord).r;
+    // Antialias over about one pixel on screen, at any scale.
+    float w = max(0.5 * fwidth(d), 1e-4);
+    float a = smoothstep(0.5 - w, 0.5 + w, d);
     out_color = vec4(vec3(a), 1.0);
 }
@@ -1,19 +1,24 @@
 #version 330
 
+#include "overlay.glsl"
+
 layout(location = 0) in vec2 in_quad;
 layout(location = 1) in vec2 in_pos;
 layout(location = 2) in ivec4 in_glyph;
 
-uniform vec2 scale;
+// Glyph size, in overlay units.
 uniform vec2 csize;
+// Size of a cell in the atlas, offset of the glyph in its cell, and size of the
+// glyph, in texture coordinates.
 uniform vec2 tsize;
+uniform vec2 toffset;
+uniform vec2 tglyph;
 
 out VertexData {
     vec2 texcoord;
 } dout;
 
 void main() {
-    dout.texcoord = (vec2(in_glyph.xy) + in_quad) * tsize;
-    gl_Position =
-        vec4(vec2(-1.0, 1.0) + scale * (in_quad * csize + in_pos), 0.0, 1.0);
+    dout.texcoord = vec2(in_glyph.xy) * tsize + toffset + in_quad * tglyph;
+    gl_Position = vec4(overlay_to_clip(in_quad * csize + in_pos), 0.0, 1.0);
 }
@@ -1,143 +1,23 @@
 #include "dev/text.hpp"
 
-#include "dev/loader.hpp"
+#include "dev/font_atlas.hpp"
 #include "dev/log.hpp"
 #include "dev/shader.hpp"
+#include "dev/upload.hpp"
 #include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
 
 #include <string>
 
-#include <cassert>
-#include <cstring>
+#include <algorithm>
+#include <memory>
 #include <vector>
 
 namespace tcm {
 
 namespace {
 
-const uint8_t MAGIC_1[] = {0x36, 0x04};
-const uint8_t MAGIC_2[] = {0x72, 0xb5, 0x4a, 0x86};
-
-enum {
-    Mode512 = 0x01,
-    ModeHasTab = 0x02,
-};
-
-enum {
-    FlagHasTab = 0x01,
-};
-
-const uint32_t MinSize = 6;
-const uint32_t MaxSize = 48;
-const uint32_t MaxCount = 1024;
-const uint32_t Columns = 16;
-
-uint32_t Read(const char *ptr) {
-    uint32_t x;
-    std::memcpy(&x, ptr, 4);
-    return x;
-}
-
-uint32_t RoundUpPow2(uint32_t x) {
-    x -= 1;
-    x |= x >> 1;
-    x |= x >> 2;
-    x |= x >> 4;
-    x |= x >> 8;
-    x |= x >> 16;
-    return x + 1;
-}
-
-struct Metrics {
-    uint32_t cwidth;
-    uint32_t cheight;
-    uint32_t iwidth;
-    uint32_t iheight;
-};
-
-struct Font {
-    std::vector<uint8_t> pixels;
-    Metrics metrics;
-};
-
-void LoadFont(const std::string &path, Font *font) {
-    std::vector<char> data;
-    int r;
-    r = ReadFile(path, &data);
-    if (r != 0) {
-        DieErrno(r, "Could not read %s", path.c_str());
-    }
-    if (data.size() < 4) {
-        Die("Unknown font format: %s", path.c_str());
-    }
-    uint32_t count, headersize, cheight, cwidth;
-    // bool has_table;
-    if (std::memcmp(data.data(), MAGIC_1, 2) == 0) {
-        uint8_t mode = data[2];
-        uint8_t charsize = data[3];
-        count = (mode & Mode512) != 0 ? 512 : 256;
-        // has_table = (mode & ModeHasTab) != 0;
-        headersize = 4;
-        cheight = charsize;
-        cwidth = 8;
-    } else if (std::memcmp(data.data(), MAGIC_2, 4) == 0) {
-        if (data.size() < 4 * 8) {
-            Die("Invalid PSF2: %s", path.c_str());
-        }
-        const char *ptr = data.data();
-        uint32_t version = Read(ptr + 4);
-        if (version != 0) {
-            Die("Unknown PSF2 version: %s", path.c_str());
-        }
-        headersize = Read(ptr + 8);
-        // uint32_t flags = Read(ptr + 12);
-        // has_table = (flags & FlagHasTab) != 0;
-        count = Read(ptr + 16);
-        cheight = Read(ptr + 24);
-        cwidth = Read(ptr + 32);
-        if (count > MaxCount) {
-            Die("Too many glyphs in font: %s", path.c_str());
-        }
-    } else {
-        Die("Unknown font format: %s", path.c_str());
-    }
-    if (cwidth > MaxSize || cheight > MaxSize) {
-        Die("Font size %ux%u too large: %s", cwidth, cheight, path.c_str());
-    }
-    if (cwidth < MinSize || cheight < MinSize) {
-        Die("Font size %ux%u too small: %s", cwidth, cheight, path.c_str());
-    }
-    uint32_t gsize = (cwidth + 7) / 8 * cheight * count;
-    if (headersize > data.size() || gsize > data.size() - headersize) {
-        Die("Invalid font %s", path.c_str());
-    }
-    uint32_t iwidth = RoundUpPow2(cwidth * Columns);
-    uint32_t iheight = RoundUpPow2(cheight * ((count + Columns - 1) / Columns));
-    std::vector<uint8_t> pixels(iwidth * iheight);
-    uint8_t *pdata = pixels.data();
-    const char *idata = data.data() + headersize;
-    for (uint32_t i = 0; i < count; i++) {
-        uint32_t x0 = (i % Columns) * cwidth;
-        uint32_t y0 = (i / Columns) * cheight;
-        for (uint32_t y = 0; y < cheight; y++) {
-            for (uint32_t xb = 0; xb < cwidth; xb += 8) {
-                uint32_t d = static_cast<uint8_t>(*idata++);
-                uint32_t nbits = cwidth - xb;
-                if (nbits > 8) {
-                    nbits = 8;
-                }
-                for (uint32_t bit = 0; bit < nbits; bit++) {
-                    pdata[(y0 + y) * iwidth + x0 + xb + bit] =
-                        (d & (0x80 >> bit)) != 0 ? 0xff : 0x00;
-                }
-            }
-        }
-    }
-    *font = Font{std::move(pixels), Metrics{cwidth, cheight, iwidth, iheight}};
-}
-
-const char FONT_PATH[] = "font/ter-i16n.psf";
-
 Shader *shader_vert;
 Shader *shader_frag;
 Program *program;
@@ -146,42 +26,73 @@ GLuint prog;
 GLuint texture;
 GLuint arr;
 GLuint buf[2]; // quad, text
-int icsize[2];
-float csize[2];
-float tsize[2];
+// Glyph size, in overlay units.
+const int icsize[2] = {FontCellWidth, FontCellHeight};
+const float csize[2] = {FontCellWidth, FontCellHeight};
+// Size of a glyph cell in the atlas, the offset of the glyph within its cell,
+// and the size of the glyph, in texture coordinates.
+const float tsize[2] = {
+    static_cast<float>((FontCellWidth + 2 * FontPadding) * FontTexelsPerPixel) /
+        FontAtlasWidth,
+    static_cast<float>((FontCellHeight + 2 * FontPadding) *
+                       FontTexelsPerPixel) /
+        FontAtlasHeight,
+};
+const float toffset[2] = {
+    static_cast<float>(FontPadding * FontTexelsPerPixel) / FontAtlasWidth,
+    static_cast<float>(FontPadding * FontTexelsPerPixel) / FontAtlasHeight,
+};
+const float tglyph[2] = {
+    static_cast<float>(FontCellWidth * FontTexelsPerPixel) / FontAtlasWidth,
+    static_cast<float>(FontCellHeight * FontTexelsPerPixel) / FontAtlasHeight,
+};
 
 } // namespace
 
+void TextLoadFont() {
+    // The atlas is generated from the font at build time by font_sdf.py. The
+    // texture is created on the upload thread.
+    auto tex = std::make_shared<GLuint>(0);
+    Upload(UploadTask{
+        nullptr,
+        [tex]() {
+            glGenTextures(1, tex.get());
+            memtrack_add(MEMTRACK_TEXTURE, *tex, "font");
+            memtrack_set_size(MEMTRACK_TEXTURE, *tex,
+                              FontAtlasWidth * FontAtlasHeight);
+            glBindTexture(GL_TEXTURE_2D, *tex);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, FontAtlasWidth,
+                         FontAtlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE,
+                         FontAtlasData);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            // The distance field is filtered linearly, and the shader finds
+            // the edge, so one level serves every size.
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                            GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                            GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        },
+        [tex]() { texture = *tex; },
+    });
+}
+
 void TextInit() {
     shader_vert = new Shader(DevShaderDir + "text.vert", GL_VERTEX_SHADER);
     shader_frag = new Shader(DevShaderDir + "text.frag", GL_FRAGMENT_SHADER);
     program = new Program(&prog, "text", {shader_vert, shader_frag});
 
-    Font font;
-    LoadFont(FONT_PATH, &font);
-    const Metrics &m = font.metrics;
-    icsize[0] = m.cwidth;
-    icsize[1] = m.cheight;
-    csize[0] = m.cwidth;
-    csize[1] = m.cheight;
-    tsize[0] = static_cast<float>(m.cwidth) / static_cast<float>(m.iwidth);
-    tsize[1] = static_cast<float>(m.cheight) / static_cast<float>(m.iheight);
-
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m.iwidth, m.iheight, 0, GL_RED,
-                 GL_UNSIGNED_BYTE, font.pixels.data());
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                    GL_NEAREST_MIPMAP_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
     glGenVertexArrays(1, &arr);
-    glBindVertexArray(arr);
+    glstate_bind_vertex_array(arr);
     glGenBuffers(2, buf);
+    memtrack_add(MEMTRACK_BUFFER, buf[0], "text quad");
+    memtrack_set_size(MEMTRACK_BUFFER, buf[0], sizeof(int16_t) * 8);
+    memtrack_add(MEMTRACK_BUFFER, buf[1], "text");
 
-    glBindBuffer(GL_ARRAY_BUFFER, buf[0]);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, buf[0]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(int16_t) * 8,
                  (const int16_t[4][2]){
                      {0, 0},
@@ -193,21 +104,34 @@ void TextInit() {
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, 0, 0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, buf[1]);
+    // The text is only uploaded when it changes.
+    glstate_bind_buffer(GL_ARRAY_BUFFER, buf[1]);
     glEnableVertexAttribArray(1);
     glVertexAttribDivisor(1, 1);
     glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, 8, 0);
     glEnableVertexAttribArray(2);
     glVertexAttribDivisor(2, 1);
-    glVertexAttribIPointer(2, 4, GL_UNSIGNED_BYTE, 8, (void *)(uintptr_t)4);
+    glVertexAttribIPointer(2, 4, GL_UNSIGNED_BYTE, 8,
+                           reinterpret_cast<void *>(4));
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+void TextTerm() {
+    glstate_delete_buffers(2, buf);
+    glstate_delete_vertex_arrays(1, &arr);
+    glstate_delete_textures(1, &texture);
+    delete program;
+    delete shader_vert;
+    delete shader_frag;
+    buf[0] = 0;
+    buf[1] = 0;
+    arr = 0;
+    texture = 0;
 }
 
 namespace {
 
 std::vector<StatusItem *> status_items;
+std::vector<TextLabel *> labels;
 bool status_items_changed;
 
 struct Vertex {
@@ -229,7 +153,7 @@ Pos PutText(Pos pos, const std::string &text) {
     size_t i = 0;
     while (true) {
         size_t limit = i;
-        int rem = (640 - 2 * pos0.x - cur.x) / icsize[0];
+        int rem = (OverlayWidth - 2 * pos0.x - cur.x) / icsize[0];
         if (rem > 0) {
             limit += rem;
         }
@@ -254,8 +178,8 @@ Pos PutText(Pos pos, const std::string &text) {
             Vertex v;
             v.x = cur.x;
             v.y = cur.y;
-            v.u = c % Columns;
-            v.v = c / Columns;
+            v.u = c % FontAtlasColumns;
+            v.v = c / FontAtlasColumns;
             v.fg = 0;
             v.bg = 0;
             vertexes.push_back(v);
@@ -292,10 +216,14 @@ void UpdateText() {
             pos.y += 4;
         }
     }
-    glBindBuffer(GL_ARRAY_BUFFER, buf[1]);
+    for (const TextLabel *label : labels) {
+        PutText(Pos{label->x(), label->y()}, label->value());
+    }
+    glstate_bind_buffer(GL_ARRAY_BUFFER, buf[1]);
     glBufferData(GL_ARRAY_BUFFER, vertexes.size() * sizeof(Vertex),
                  vertexes.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    memtrack_set_size(MEMTRACK_BUFFER, buf[1],
+                      vertexes.size() * sizeof(Vertex));
 }
 
 } // namespace
@@ -325,8 +253,26 @@ void StatusItem::Set(std::string s) {
     }
 }
 
+TextLabel::TextLabel(int x, int y) : x_{x}, y_{y} {
+    labels.push_back(this);
+}
+
+TextLabel::~TextLabel() {
+    auto it = std::find(std::begin(labels), std::end(labels), this);
+    if (it != std::end(labels)) {
+        labels.erase(it);
+    }
+}
+
+void TextLabel::Set(std::string s) {
+    if (text_ != s) {
+        status_items_changed = true;
+        text_ = std::move(s);
+    }
+}
+
 void TextDraw() {
-    if (prog == 0) {
+    if (prog == 0 || texture == 0) {
         return;
     }
     if (status_items_changed) {
@@ -335,19 +281,16 @@ void TextDraw() {
     if (vertexes.empty()) {
         return;
     }
-    glUseProgram(prog);
-    glBindVertexArray(arr);
-    glUniform2f(glGetUniformLocation(prog, "scale"), 2.0 / 640.0, -2.0 / 360.0);
+    glstate_use_program(prog);
+    glstate_bind_vertex_array(arr);
     glUniform2fv(glGetUniformLocation(prog, "csize"), 1, csize);
     glUniform2fv(glGetUniformLocation(prog, "tsize"), 1, tsize);
+    glUniform2fv(glGetUniformLocation(prog, "toffset"), 1, toffset);
+    glUniform2fv(glGetUniformLocation(prog, "tglyph"), 1, tglyph);
     glUniform1i(glGetUniformLocation(prog, "texture"), 0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    glstate_bind_texture(0, GL_TEXTURE_2D, texture);
 
     glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, vertexes.size());
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
 }
 
 } // namespace tcm
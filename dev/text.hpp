@@ -5,7 +5,19 @@
 
 namespace tcm {
 
+// Size of the overlay coordinate system. The origin is at the top left. Shaders
+// convert to clip coordinates with overlay_to_clip() from overlay.glsl.
+const int OverlayWidth = 640;
+const int OverlayHeight = 360;
+
+// Start loading the font in the background. May be called before the OpenGL
+// context is created.
+void TextLoadFont();
+
 void TextInit();
+
+// Release the resources used for text.
+void TextTerm();
 void TextDraw();
 
 // A status item which can be displayed on the screen.
@@ -27,4 +39,24 @@ private:
     std::string text_;
 };
 
+// A line of text displayed at a fixed position on the overlay.
+class TextLabel {
+public:
+    TextLabel(int x, int y);
+    TextLabel(const TextLabel &) = delete;
+    ~TextLabel();
+    TextLabel &operator=(const TextLabel &) = delete;
+
+    int x() const { return x_; }
+    int y() const { return y_; }
+    const std::string &value() const { return text_; }
+
+    void Set(std::string s);
+
+private:
+    int x_;
+    int y_;
+    std::string text_;
+};
+
 } // namespace tcm
@@ -0,0 +1,263 @@
+// trace.cpp - CPU and GPU timeline tracing.
+#include "dev/trace.hpp"
+
+#include "dev/log.hpp"
+#include "dev/path.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+
+namespace tcm {
+
+namespace {
+
+// Maximum number of threads which can record spans.
+const int kMaxThreads = 16;
+
+// Number of spans kept for each thread. Must be a power of two.
+const uint64_t kRingSize = 1 << 14;
+
+// Maximum number of GPU spans waiting for query results.
+const unsigned kMaxGpuSpans = 256;
+
+// Amount of history written to a trace file, in nanoseconds.
+const int64_t kDumpDuration = 10 * 1000000000LL;
+
+// How often the GPU clock is aligned with the CPU clock, in nanoseconds.
+const int64_t kCalibrateInterval = 1000000000LL;
+
+struct Event {
+    const char *name;
+    int64_t start;
+    int64_t duration;
+};
+
+// Spans recorded by a single thread. Only that thread writes to the ring, so
+// writing is wait-free. Readers copy events and then discard any which may have
+// been overwritten while copying.
+struct Ring {
+    std::atomic<uint64_t> head;
+    std::atomic<const char *> thread_name;
+    Event events[kRingSize];
+};
+
+// One ring per thread, plus one ring for GPU spans.
+Ring rings[kMaxThreads + 1];
+Ring &gpu_ring = rings[kMaxThreads];
+std::atomic<int> num_rings;
+thread_local Ring *thread_ring;
+thread_local bool thread_ring_full;
+
+PathTemplate path_template{"traces", "trace", ".json"};
+
+int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Get the ring for the current thread, or nullptr if there are too many
+// threads.
+Ring *ThreadRing() {
+    Ring *r = thread_ring;
+    if (r == nullptr && !thread_ring_full) {
+        int i = num_rings.fetch_add(1, std::memory_order_relaxed);
+        if (i >= kMaxThreads) {
+            thread_ring_full = true;
+            return nullptr;
+        }
+        r = &rings[i];
+        thread_ring = r;
+    }
+    return r;
+}
+
+void Push(Ring *r, const Event &e) {
+    uint64_t head = r->head.load(std::memory_order_relaxed);
+    r->events[head & (kRingSize - 1)] = e;
+    r->head.store(head + 1, std::memory_order_release);
+}
+
+// A GPU span waiting for query results.
+struct GpuSpan {
+    const char *name;
+    GLuint query[2];
+};
+
+bool gpu_ok;
+GpuSpan gpu_spans[kMaxGpuSpans];
+// Spans from gpu_tail to gpu_head are pending.
+unsigned gpu_head;
+unsigned gpu_tail;
+// Offset from GPU timestamps to CPU timestamps.
+int64_t gpu_offset;
+int64_t gpu_calibrated;
+
+void Calibrate() {
+    GLint64 gpu_time;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+    int64_t cpu_time = Now();
+    gpu_offset = cpu_time - gpu_time;
+    gpu_calibrated = cpu_time;
+}
+
+// Copy the events in a ring which end after the given time.
+void CopyEvents(Ring &r, int64_t since, std::vector<Event> *out) {
+    uint64_t head = r.head.load(std::memory_order_acquire);
+    uint64_t start = head > kRingSize ? head - kRingSize : 0;
+    size_t pos = out->size();
+    for (uint64_t i = start; i < head; i++) {
+        out->push_back(r.events[i & (kRingSize - 1)]);
+    }
+    // Discard events which the writer may have overwritten during the copy.
+    uint64_t new_head = r.head.load(std::memory_order_acquire);
+    uint64_t valid = new_head > kRingSize ? new_head - kRingSize : 0;
+    if (valid > start) {
+        size_t n = std::min<uint64_t>(valid - start, head - start);
+        out->erase(out->begin() + pos, out->begin() + pos + n);
+    }
+    out->erase(std::remove_if(out->begin() + pos, out->end(),
+                              [since](const Event &e) {
+                                  return e.start + e.duration < since;
+                              }),
+               out->end());
+}
+
+void WriteString(std::FILE *fp, const char *s) {
+    std::fputc('"', fp);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            std::fputc('\\', fp);
+        }
+        std::fputc(*s, fp);
+    }
+    std::fputc('"', fp);
+}
+
+} // namespace
+
+TraceSpan::TraceSpan(const char *name) : name_{name}, start_{Now()} {}
+
+TraceSpan::~TraceSpan() {
+    Ring *r = ThreadRing();
+    if (r != nullptr) {
+        Push(r, Event{name_, start_, Now() - start_});
+    }
+}
+
+GpuTraceSpan::GpuTraceSpan(const char *name) : slot_{-1} {
+    if (!gpu_ok || gpu_head - gpu_tail >= kMaxGpuSpans) {
+        return;
+    }
+    slot_ = gpu_head % kMaxGpuSpans;
+    gpu_head++;
+    GpuSpan &span = gpu_spans[slot_];
+    span.name = name;
+    glQueryCounter(span.query[0], GL_TIMESTAMP);
+}
+
+GpuTraceSpan::~GpuTraceSpan() {
+    if (slot_ >= 0) {
+        glQueryCounter(gpu_spans[slot_].query[1], GL_TIMESTAMP);
+    }
+}
+
+void TraceThreadName(const char *name) {
+    Ring *r = ThreadRing();
+    if (r != nullptr) {
+        r->thread_name.store(name, std::memory_order_relaxed);
+    }
+}
+
+void TraceInit() {
+    TraceThreadName("main");
+    gpu_ring.thread_name.store("GPU", std::memory_order_relaxed);
+    for (GpuSpan &span : gpu_spans) {
+        glGenQueries(2, span.query);
+    }
+    Calibrate();
+    gpu_ok = true;
+}
+
+void TraceEndFrame() {
+    if (!gpu_ok) {
+        return;
+    }
+    // Collect results in order, stopping at the first span not yet finished.
+    while (gpu_tail != gpu_head) {
+        const GpuSpan &span = gpu_spans[gpu_tail % kMaxGpuSpans];
+        GLint available;
+        glGetQueryObjectiv(span.query[1], GL_QUERY_RESULT_AVAILABLE,
+                           &available);
+        if (!available) {
+            break;
+        }
+        GLint64 t0, t1;
+        glGetQueryObjecti64v(span.query[0], GL_QUERY_RESULT, &t0);
+        glGetQueryObjecti64v(span.query[1], GL_QUERY_RESULT, &t1);
+        Push(&gpu_ring, Event{span.name, t0 + gpu_offset, t1 - t0});
+        gpu_tail++;
+    }
+    // The GPU and CPU clocks drift, so align them periodically.
+    if (Now() - gpu_calibrated > kCalibrateInterval) {
+        Calibrate();
+    }
+}
+
+void TraceDump() {
+    int64_t since = Now() - kDumpDuration;
+    int nthreads = std::min(num_rings.load(), kMaxThreads);
+    std::vector<std::vector<Event>> events(kMaxThreads + 1);
+    int64_t origin = INT64_MAX;
+    for (int i = 0; i <= kMaxThreads; i++) {
+        if (i < nthreads || i == kMaxThreads) {
+            CopyEvents(rings[i], since, &events[i]);
+            for (const Event &e : events[i]) {
+                origin = std::min(origin, e.start);
+            }
+        }
+    }
+    std::string path = path_template.Create();
+    std::FILE *fp = std::fopen(path.c_str(), "w");
+    if (fp == nullptr) {
+        ErrorErrno(errno, "Could not create %s", path.c_str());
+        return;
+    }
+    std::fputs("{\"traceEvents\":[\n", fp);
+    bool first = true;
+    size_t count = 0;
+    for (int i = 0; i <= kMaxThreads; i++) {
+        const char *name = rings[i].thread_name.load();
+        if (name != nullptr) {
+            std::fprintf(fp,
+                         "%s{\"ph\":\"M\",\"name\":\"thread_name\","
+                         "\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                         first ? "" : ",\n", i);
+            WriteString(fp, name);
+            std::fputs("}}", fp);
+            first = false;
+        }
+        for (const Event &e : events[i]) {
+            std::fprintf(fp, "%s{\"ph\":\"X\",\"name\":", first ? "" : ",\n");
+            WriteString(fp, e.name);
+            std::fprintf(fp, ",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         i, (e.start - origin) * 1e-3, e.duration * 1e-3);
+            first = false;
+            count++;
+        }
+    }
+    std::fputs("\n]}\n", fp);
+    if (std::fclose(fp) != 0) {
+        ErrorErrno(errno, "Could not write %s", path.c_str());
+        return;
+    }
+    Info("Wrote trace %s (%zu spans)", path.c_str(), count);
+}
+
+} // namespace tcm
@@ -0,0 +1,53 @@
+// trace.hpp - CPU and GPU timeline tracing.
+#pragma once
+
+#include "tcm/gl.h"
+
+#include <cstdint>
+
+namespace tcm {
+
+// Record a CPU span from construction to destruction. Spans are written to a
+// ring buffer owned by the calling thread, without locks or allocation. The
+// name must have static storage duration.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char *name);
+    TraceSpan(const TraceSpan &) = delete;
+    ~TraceSpan();
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name_;
+    int64_t start_;
+};
+
+// Record a GPU span around the OpenGL commands issued from construction to
+// destruction, using timestamp queries. May only be used on the render thread.
+// The name must have static storage duration.
+class GpuTraceSpan {
+public:
+    explicit GpuTraceSpan(const char *name);
+    GpuTraceSpan(const GpuTraceSpan &) = delete;
+    ~GpuTraceSpan();
+    GpuTraceSpan &operator=(const GpuTraceSpan &) = delete;
+
+private:
+    int slot_;
+};
+
+// Set the name of the calling thread, shown in the trace viewer. The name must
+// have static storage duration.
+void TraceThreadName(const char *name);
+
+// Initialize GPU tracing. Call on the render thread after OpenGL is ready.
+void TraceInit();
+
+// Collect finished GPU spans. Call on the render thread once per frame.
+void TraceEndFrame();
+
+// Write the last few seconds of spans to a trace file, which can be opened
+// with chrome://tracing or https://ui.perfetto.dev/.
+void TraceDump();
+
+} // namespace tcm
@@ -0,0 +1,188 @@
+// upload.cpp - Background resource loading.
+//
+// The upload thread has its own OpenGL context, on a hidden window, which
+// shares objects with the main context. After a task's commands are issued, the
+// upload thread inserts a fence. The main thread polls the fences once per
+// frame without waiting, and finishes tasks whose fences have been signaled.
+#include "dev/upload.hpp"
+
+#include "dev/log.hpp"
+#include "dev/trace.hpp"
+#include "tcm/gl.h"
+
+#include <GLFW/glfw3.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace tcm {
+
+namespace {
+
+// A task which has been uploaded, waiting for the GPU.
+struct Finished {
+    GLsync fence;
+    Callback done;
+};
+
+// Never destroyed, so exiting the program with the thread running is safe.
+std::thread *thread;
+std::mutex mutex;
+std::condition_variable cond;
+// The following are protected by mutex.
+std::deque<UploadTask> queue;
+GLFWwindow *context;
+bool context_failed;
+bool stopping;
+std::deque<Finished> finished;
+
+// The hidden window owning the upload context. Only used by the main thread.
+GLFWwindow *context_window;
+bool poll_scheduled;
+
+// Run a task's callback on the main thread once its fence is signaled.
+void PollFinished() {
+    std::deque<Finished> ready;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        while (!finished.empty()) {
+            Finished &f = finished.front();
+            if (f.fence != nullptr) {
+                GLenum r = glClientWaitSync(f.fence, 0, 0);
+                if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) {
+                    break;
+                }
+                glDeleteSync(f.fence);
+            }
+            ready.push_back(std::move(f));
+            finished.pop_front();
+        }
+    }
+    for (Finished &f : ready) {
+        if (f.done) {
+            f.done();
+        }
+    }
+}
+
+void UploadThread() {
+    TraceThreadName("upload");
+    bool has_context = false;
+    std::unique_lock<std::mutex> lock{mutex};
+    while (true) {
+        cond.wait(lock, [] { return stopping || !queue.empty(); });
+        if (stopping) {
+            break;
+        }
+        UploadTask task = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        if (task.prepare) {
+            TraceSpan span{"Upload prepare"};
+            task.prepare();
+        }
+        lock.lock();
+        if (task.upload) {
+            // Prepare tasks can run before the main window exists, but
+            // uploads must wait for a context.
+            cond.wait(lock, [] {
+                return stopping || context != nullptr || context_failed;
+            });
+            if (stopping) {
+                break;
+            }
+            if (context_failed) {
+                // Finish the task on the main thread.
+                finished.push_back(Finished{nullptr, [task]() {
+                                                task.upload();
+                                                if (task.done) {
+                                                    task.done();
+                                                }
+                                            }});
+                continue;
+            }
+            lock.unlock();
+            if (!has_context) {
+                glfwMakeContextCurrent(context);
+                has_context = true;
+            }
+            GLsync fence;
+            {
+                TraceSpan span{"Upload"};
+                task.upload();
+                fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                // Without a flush, the fence may never be signaled.
+                glFlush();
+            }
+            lock.lock();
+            finished.push_back(Finished{fence, std::move(task.done)});
+        } else {
+            finished.push_back(Finished{nullptr, std::move(task.done)});
+        }
+    }
+    lock.unlock();
+    if (has_context) {
+        glfwMakeContextCurrent(nullptr);
+    }
+}
+
+} // namespace
+
+void UploadStart() {
+    thread = new std::thread{UploadThread};
+}
+
+void UploadSetContext(GLFWwindow *window) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    context_window = glfwCreateWindow(1, 1, "Upload", nullptr, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (context_window == nullptr) {
+        Warning("Could not create upload context, uploading on main thread");
+    }
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        context = context_window;
+        context_failed = context_window == nullptr;
+    }
+    cond.notify_all();
+    if (!poll_scheduled) {
+        poll_scheduled = true;
+        ScheduleEveryFrame(PollFinished);
+    }
+}
+
+void UploadStop() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    cond.notify_all();
+    if (thread != nullptr) {
+        thread->join();
+        delete thread;
+        thread = nullptr;
+    }
+    for (Finished &f : finished) {
+        if (f.fence != nullptr) {
+            glDeleteSync(f.fence);
+        }
+    }
+    finished.clear();
+    queue.clear();
+    if (context_window != nullptr) {
+        glfwDestroyWindow(context_window);
+        context_window = nullptr;
+    }
+}
+
+void Upload(UploadTask task) {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        queue.push_back(std::move(task));
+    }
+    cond.notify_all();
+}
+
+} // namespace tcm
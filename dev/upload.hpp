@@ -0,0 +1,40 @@
+// upload.hpp - Background resource loading.
+#pragma once
+
+#include "dev/callback.hpp"
+
+#include <functional>
+
+struct GLFWwindow;
+
+namespace tcm {
+
+// A resource to load in the background.
+struct UploadTask {
+    // Prepare data on the upload thread, without an OpenGL context. Optional.
+    std::function<void()> prepare;
+    // Issue OpenGL commands on the upload thread, with a context that shares
+    // objects with the main context. Optional.
+    std::function<void()> upload;
+    // Called on the main thread once the upload has completed on the GPU.
+    // Objects must be bound again on the main thread to see their new contents.
+    Callback done;
+};
+
+// Start the upload thread. Tasks can be queued immediately, but nothing is
+// uploaded until a context is available.
+void UploadStart();
+
+// Create the upload context, sharing objects with the given window's context,
+// and hand it to the upload thread. Must be called on the main thread.
+void UploadSetContext(GLFWwindow *window);
+
+// Stop the upload thread and discard any tasks not yet finished.
+void UploadStop();
+
+// Queue a task on the upload thread. Tasks are run in order, and completed in
+// order. If the upload thread could not get a context, tasks are run on the
+// main thread instead.
+void Upload(UploadTask task);
+
+} // namespace tcm
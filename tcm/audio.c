@@ -0,0 +1,226 @@
+// audio.c - Audio output.
+#include "tcm/audio.h"
+
+#include "tcm/music.h"
+#include "tcm/spsc.h"
+#include "tcm/synth.h"
+
+#include <portaudio.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+enum {
+    CHANNELS = 2,
+    // Ring buffer capacity, in samples.
+    RING_SIZE = 8192,
+    // Number of samples the synthesizer thread keeps buffered ahead of the
+    // audio device. This is the output latency.
+    BUFFER_TARGET = 4096,
+    // Number of frames the synthesizer renders at a time.
+    RENDER_FRAMES = 256,
+};
+
+static struct {
+    bool active;
+    struct synth *synth;
+    struct music music;
+    struct sample_ring ring;
+    struct param_queue params;
+    pthread_t thread;
+    atomic_bool running;
+    // Number of frames consumed by the sink.
+    atomic_long consumed;
+    // Output latency of the sink, in seconds.
+    double latency;
+    PaStream *stream;
+    pthread_t null_thread;
+} audio;
+
+// Render audio into the ring buffer until asked to stop.
+static void *synth_thread(void *arg) {
+    (void)arg;
+    float buf[RENDER_FRAMES * CHANNELS];
+    while (atomic_load_explicit(&audio.running, memory_order_relaxed)) {
+        struct param_msg msg;
+        while (param_queue_pop(&audio.params, &msg)) {
+            synth_set_param(audio.synth, msg.param, msg.value);
+        }
+        size_t buffered = RING_SIZE - sample_ring_write_avail(&audio.ring);
+        if (buffered + RENDER_FRAMES * CHANNELS <= BUFFER_TARGET) {
+            music_render(&audio.music, audio.synth, buf, RENDER_FRAMES);
+            sample_ring_write(&audio.ring, buf, RENDER_FRAMES * CHANNELS);
+        } else {
+            nanosleep(&(struct timespec){.tv_nsec = 1000000}, NULL);
+        }
+    }
+    return NULL;
+}
+
+// Called by PortAudio on its own thread to get samples for the device.
+static int audio_callback(const void *input, void *output,
+                          unsigned long frames,
+                          const PaStreamCallbackTimeInfo *time_info,
+                          PaStreamCallbackFlags flags, void *user_data) {
+    (void)input;
+    (void)time_info;
+    (void)flags;
+    (void)user_data;
+    float *out = output;
+    size_t count = frames * CHANNELS;
+    size_t n = sample_ring_read(&audio.ring, out, count);
+    // On underrun, play silence rather than waiting.
+    memset(out + n, 0, (count - n) * sizeof(*out));
+    // Count only the soundtrack actually played, so the clock stays with the
+    // music through an underrun.
+    atomic_fetch_add_explicit(&audio.consumed, n / CHANNELS,
+                              memory_order_release);
+    return paContinue;
+}
+
+static double monotonic_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+// Consume and discard samples at the rate a real device would.
+static void *null_thread(void *arg) {
+    (void)arg;
+    enum {
+        PERIOD = 256,
+    };
+    float buf[PERIOD * CHANNELS];
+    double start = monotonic_time();
+    // Number of frames the device would have played, including silence.
+    long played = 0;
+    while (atomic_load_explicit(&audio.running, memory_order_relaxed)) {
+        long target = (long)((monotonic_time() - start) * SYNTH_RATE);
+        while (played + PERIOD <= target) {
+            size_t n = sample_ring_read(&audio.ring, buf, PERIOD * CHANNELS);
+            played += PERIOD;
+            atomic_fetch_add_explicit(&audio.consumed, n / CHANNELS,
+                                      memory_order_release);
+        }
+        nanosleep(&(struct timespec){.tv_nsec = 1000000}, NULL);
+    }
+    return NULL;
+}
+
+static void pa_warning(const char *what, PaError err) {
+    fprintf(stderr, "Warning: %s: %s\n", what, Pa_GetErrorText(err));
+}
+
+// Open the audio device.
+static bool device_open(void) {
+    PaError err = Pa_Initialize();
+    if (err != paNoError) {
+        pa_warning("Could not initialize audio", err);
+        return false;
+    }
+    err = Pa_OpenDefaultStream(&audio.stream, 0, CHANNELS, paFloat32,
+                               SYNTH_RATE, paFramesPerBufferUnspecified,
+                               audio_callback, NULL);
+    if (err != paNoError) {
+        pa_warning("Could not open audio stream", err);
+        audio.stream = NULL;
+        Pa_Terminate();
+        return false;
+    }
+    const PaStreamInfo *info = Pa_GetStreamInfo(audio.stream);
+    audio.latency = info != NULL ? info->outputLatency : 0.0;
+    return true;
+}
+
+static void device_close(void) {
+    Pa_CloseStream(audio.stream);
+    audio.stream = NULL;
+    Pa_Terminate();
+}
+
+bool audio_init(enum audio_sink sink) {
+    audio.synth = synth_new();
+    if (audio.synth == NULL || !sample_ring_init(&audio.ring, RING_SIZE)) {
+        fputs("Warning: No memory for audio\n", stderr);
+        synth_free(audio.synth);
+        audio.synth = NULL;
+        return false;
+    }
+    music_init(&audio.music);
+    atomic_store(&audio.consumed, 0);
+    audio.latency = 0.0;
+    if (sink == AUDIO_SINK_DEVICE && !device_open()) {
+        goto fail;
+    }
+    atomic_store(&audio.running, true);
+    if (pthread_create(&audio.thread, NULL, synth_thread, NULL) != 0) {
+        fputs("Warning: Could not create synthesizer thread\n", stderr);
+        goto fail_thread;
+    }
+    if (sink == AUDIO_SINK_DEVICE) {
+        PaError err = Pa_StartStream(audio.stream);
+        if (err != paNoError) {
+            pa_warning("Could not start audio stream", err);
+            goto fail_start;
+        }
+    } else if (pthread_create(&audio.null_thread, NULL, null_thread, NULL) !=
+               0) {
+        fputs("Warning: Could not create audio thread\n", stderr);
+        goto fail_start;
+    }
+    audio.active = true;
+    return true;
+
+fail_start:
+    atomic_store(&audio.running, false);
+    pthread_join(audio.thread, NULL);
+fail_thread:
+    atomic_store(&audio.running, false);
+    if (audio.stream != NULL) {
+        device_close();
+    }
+fail:
+    sample_ring_destroy(&audio.ring);
+    synth_free(audio.synth);
+    audio.synth = NULL;
+    return false;
+}
+
+void audio_term(void) {
+    if (!audio.active) {
+        return;
+    }
+    audio.active = false;
+    if (audio.stream != NULL) {
+        Pa_StopStream(audio.stream);
+    }
+    atomic_store(&audio.running, false);
+    pthread_join(audio.thread, NULL);
+    if (audio.stream != NULL) {
+        device_close();
+    } else {
+        pthread_join(audio.null_thread, NULL);
+    }
+    sample_ring_destroy(&audio.ring);
+    synth_free(audio.synth);
+    audio.synth = NULL;
+}
+
+void audio_set_param(int param, float value) {
+    if (!audio.active) {
+        return;
+    }
+    param_queue_push(&audio.params, (struct param_msg){param, value});
+}
+
+bool audio_position(double *time) {
+    if (!audio.active) {
+        return false;
+    }
+    long consumed =
+        atomic_load_explicit(&audio.consumed, memory_order_acquire);
+    *time = (double)consumed / SYNTH_RATE - audio.latency;
+    return true;
+}
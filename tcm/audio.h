@@ -0,0 +1,41 @@
+// audio.h - Audio output.
+#pragma once
+
+#include <stdbool.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// Where audio output goes.
+enum audio_sink {
+    // The default audio device.
+    AUDIO_SINK_DEVICE,
+    // Discard audio at the same rate a device would consume it. This runs the
+    // entire audio pipeline and clock without sound hardware.
+    AUDIO_SINK_NULL,
+};
+
+// Start playing the soundtrack. The synthesizer runs on its own thread and
+// feeds the sink through a lock-free ring buffer. Returns false if audio could
+// not be started, in which case the demo runs silently.
+bool audio_init(enum audio_sink sink);
+
+// Stop playing audio and free all resources.
+void audio_term(void);
+
+// Change a synthesizer parameter. May only be called from the main thread.
+// This never blocks; if the synthesizer falls too far behind, the change is
+// dropped.
+void audio_set_param(int param, float value);
+
+// Get the playback position of the soundtrack, in seconds: the number of
+// samples consumed by the sink, less the output latency. Silence played during
+// an underrun is not counted, so the position stays with the music. The
+// position advances in steps, once per device buffer. Returns false if audio is
+// not playing.
+bool audio_position(double *time);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,67 @@
+// clock.c - Demo master clock.
+#include "tcm/clock.h"
+
+#include "tcm/audio.h"
+
+#include <math.h>
+
+// If the smoothed clock is further than this from the audio position, in
+// seconds, jump directly to the audio position. This happens at startup.
+static const double SNAP_THRESHOLD = 0.25;
+
+// Loop gains. The proportional term corrects phase error, the integral term
+// corrects drift between the audio clock and wall clock.
+static const double GAIN_P = 0.05;
+static const double GAIN_I = 0.002;
+
+// Maximum rate deviation from the wall clock.
+static const double MAX_RATE_ERROR = 0.05;
+
+void demo_clock_init(struct demo_clock *c, double wall) {
+    *c = (struct demo_clock){
+        .wall_start = wall,
+        .wall_last = wall,
+        .time = 0.0,
+        .rate = 1.0,
+        .locked = false,
+    };
+}
+
+double demo_clock_update(struct demo_clock *c, double wall) {
+    double audio;
+    bool has_audio = audio_position(&audio);
+    return demo_clock_update_with(c, wall, has_audio, audio);
+}
+
+double demo_clock_update_with(struct demo_clock *c, double wall,
+                              bool has_audio, double audio) {
+    double dt = wall - c->wall_last;
+    c->wall_last = wall;
+    double time;
+    if (!has_audio) {
+        c->locked = false;
+        time = wall - c->wall_start;
+    } else {
+        double predicted = c->time + dt * c->rate;
+        double error = audio - predicted;
+        if (!c->locked || fabs(error) > SNAP_THRESHOLD) {
+            c->locked = true;
+            c->rate = 1.0;
+            time = audio;
+        } else {
+            time = predicted + GAIN_P * error;
+            c->rate += GAIN_I * error;
+            if (c->rate > 1.0 + MAX_RATE_ERROR) {
+                c->rate = 1.0 + MAX_RATE_ERROR;
+            } else if (c->rate < 1.0 - MAX_RATE_ERROR) {
+                c->rate = 1.0 - MAX_RATE_ERROR;
+            }
+        }
+    }
+    // Never go backwards, even when snapping.
+    if (time < c->time) {
+        time = c->time;
+    }
+    c->time = time;
+    return time;
+}
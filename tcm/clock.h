@@ -0,0 +1,44 @@
+// clock.h - Demo master clock.
+#pragma once
+
+#include <stdbool.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// The master clock, which decides what time the demo shows each frame.
+//
+// When audio is playing, demo time follows the audio playback position so the
+// visuals stay in sync with the music. The raw audio position advances in
+// steps of one device buffer, so it is smoothed with a phase-locked loop
+// driven by the wall clock. The result is monotonic and free of jitter, and
+// still converges on the audio position after frame hitches. Without audio,
+// the wall clock is used directly.
+struct demo_clock {
+    // Wall clock time at the start of the demo.
+    double wall_start;
+    // Wall clock time of the last update.
+    double wall_last;
+    // Demo time returned by the last update.
+    double time;
+    // Rate at which demo time advances relative to the wall clock.
+    double rate;
+    // True if the clock is locked to the audio position.
+    bool locked;
+};
+
+// Initialize the clock. The wall clock time must be monotonic.
+void demo_clock_init(struct demo_clock *c, double wall);
+
+// Update the clock and return the demo time for this frame.
+double demo_clock_update(struct demo_clock *c, double wall);
+
+// Update the clock using the given audio position, rather than querying the
+// audio system. If has_audio is false, the wall clock is used.
+double demo_clock_update_with(struct demo_clock *c, double wall,
+                              bool has_audio, double audio);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,123 @@
+// curve.c - Draw L-system curves.
+#include "tcm/curve.h"
+
+#include "tcm/drawlist.h"
+#include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/lsystem.h"
+#include "tcm/memtrack.h"
+#include "tcm/shaders.h"
+
+#include <stdio.h>
+
+enum {
+    MAX_CURVES = 32,
+};
+
+// A curve uploaded to the GPU. The buffer contains the x coordinates followed
+// by the y coordinates, with the first and last vertex repeated, to give the
+// ends of the line strip adjacency.
+struct curve {
+    const struct lsystem *ls;
+    int depth;
+    // Number of vertices, not counting the repeated vertices.
+    int count;
+    GLuint buffer;
+    GLuint array;
+};
+
+static struct curve curves[MAX_CURVES];
+static int curve_count;
+
+// Find a cached curve, generating it if necessary. Returns NULL on failure.
+static struct curve *curve_get(const struct lsystem *ls, int depth) {
+    for (int i = 0; i < curve_count; i++) {
+        if (curves[i].ls == ls && curves[i].depth == depth) {
+            return curves[i].count > 0 ? &curves[i] : NULL;
+        }
+    }
+    if (curve_count >= MAX_CURVES) {
+        fputs("Warning: Too many curves\n", stderr);
+        return NULL;
+    }
+    // Failures are cached too, so they are not retried every frame.
+    struct curve *c = &curves[curve_count++];
+    *c = (struct curve){.ls = ls, .depth = depth};
+    struct lsystem_curve data;
+    if (!lsystem_generate(ls, depth, 0, &data)) {
+        fprintf(stderr, "Warning: Could not generate curve: %s, depth %d\n",
+                ls->name, depth);
+        return NULL;
+    }
+    int n = data.count;
+    GLsizeiptr size = sizeof(float) * (n + 2);
+    glGenBuffers(1, &c->buffer);
+    memtrack_add(MEMTRACK_BUFFER, c->buffer, "curve");
+    memtrack_set_size(MEMTRACK_BUFFER, c->buffer, size * 2);
+    glGenVertexArrays(1, &c->array);
+    glstate_bind_vertex_array(c->array);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, c->buffer);
+    glBufferData(GL_ARRAY_BUFFER, size * 2, NULL, GL_STATIC_DRAW);
+    const float *coords[2] = {data.x, data.y};
+    for (int i = 0; i < 2; i++) {
+        const float *p = coords[i];
+        GLintptr base = size * i;
+        glBufferSubData(GL_ARRAY_BUFFER, base, sizeof(float), p);
+        glBufferSubData(GL_ARRAY_BUFFER, base + sizeof(float),
+                        sizeof(float) * n, p);
+        glBufferSubData(GL_ARRAY_BUFFER, base + sizeof(float) * (n + 1),
+                        sizeof(float), p + n - 1);
+        glEnableVertexAttribArray(i);
+        glVertexAttribPointer(i, 1, GL_FLOAT, GL_FALSE, 0, (void *)base);
+    }
+    lsystem_curve_destroy(&data);
+    c->count = n;
+    return c;
+}
+
+bool curve_prepare(const struct lsystem *ls, int depth) {
+    return curve_get(ls, depth) != NULL;
+}
+
+static void curve_uniforms(const struct draw_item *item) {
+    glUniform4fv(glGetUniformLocation(item->program, "transform"), 1,
+                 item->params);
+}
+
+void curve_draw(struct drawlist *dl, const struct lsystem *ls, int depth,
+                float x, float y, float scale, float part) {
+    if (shader_curve == 0) {
+        return;
+    }
+    struct curve *c = curve_get(ls, depth);
+    if (c == NULL) {
+        return;
+    }
+    if (part > 1.0f) {
+        part = 1.0f;
+    }
+    int count = (int)(part * (float)c->count);
+    if (count < 2) {
+        return;
+    }
+    drawlist_add(dl, &(struct draw_item){
+                         .program = shader_curve,
+                         .vertex_array = c->array,
+                         .mode = GL_LINE_STRIP_ADJACENCY,
+                         .first = 0,
+                         .count = count + 2,
+                         .uniforms = curve_uniforms,
+                         .params = {x, y, scale, (float)c->count},
+                     });
+}
+
+void curve_term(void) {
+    for (int i = 0; i < curve_count; i++) {
+        struct curve *c = &curves[i];
+        if (c->count > 0) {
+            glstate_delete_vertex_arrays(1, &c->array);
+            glstate_delete_buffers(1, &c->buffer);
+        }
+    }
+    curve_count = 0;
+}
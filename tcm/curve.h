@@ -0,0 +1,28 @@
+// curve.h - Draw L-system curves.
+#pragma once
+
+#include <stdbool.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct drawlist;
+struct lsystem;
+
+// Generate an L-system curve and upload it, if it is not already cached.
+// Returns false on failure.
+bool curve_prepare(const struct lsystem *ls, int depth);
+
+// Draw the first part of an L-system curve, from 0 to 1, centered at (x, y) and
+// with the given scale. Curves are generated the first time they are drawn, and
+// cached by L-system and depth.
+void curve_draw(struct drawlist *dl, const struct lsystem *ls, int depth,
+                float x, float y, float scale, float part);
+
+// Release all cached curves.
+void curve_term(void);
+
+#if defined __cplusplus
+}
+#endif
@@ -1,14 +1,137 @@
 // demo.c - Main demo entry point.
 #include "tcm/demo.h"
 
+#include "tcm/curve.h"
 #include "tcm/dragon.h"
+#include "tcm/drawlist.h"
+#include "tcm/frame.h"
 #include "tcm/gl.h"
+#include "tcm/lsystem.h"
+#include "tcm/particles.h"
+#include "tcm/post.h"
+
+#include <math.h>
+
+enum {
+    PARTICLE_COUNT = 1 << 18,
+    // Size of the grid of small dragons in the background.
+    FIELD_COLUMNS = 24,
+    FIELD_ROWS = 13,
+};
+
+// Curves shown in turn, each drawn over CURVE_TIME seconds. The demo shows each
+// curve once.
+static const struct {
+    const struct lsystem *ls;
+    int depth;
+} CURVES[] = {
+    {&LSYSTEM_HILBERT, 5},
+    {&LSYSTEM_GOSPER, 4},
+    {&LSYSTEM_KOCH, 4},
+    {&LSYSTEM_SIERPINSKI, 6},
+    {&LSYSTEM_LEVY, 10},
+    {&LSYSTEM_DRAGON, 10},
+};
+
+enum {
+    CURVE_COUNT = sizeof(CURVES) / sizeof(*CURVES),
+};
+
+#define CURVE_TIME (DEMO_LENGTH / CURVE_COUNT)
+
+// Time over which the image blurs out and back in when the curve changes.
+#define BLUR_TIME 0.4
+
+// Draw commands for the current frame.
+static struct drawlist drawlist;
+
+static struct particles particles;
+
+// Demo time of the last frame, for computing the time step.
+static double last_time;
 
 void demo_init(void) {
+    drawlist_init(&drawlist);
+    post_init();
     dragon_init();
+    particles_init(&particles, PARTICLE_COUNT);
+    for (int i = 0; i < CURVE_COUNT; i++) {
+        curve_prepare(CURVES[i].ls, CURVES[i].depth);
+    }
+}
+
+void demo_term(void) {
+    curve_term();
+    particles_destroy(&particles);
+    dragon_term();
+    post_term();
+    frame_term();
+    drawlist_destroy(&drawlist);
 }
 
-void demo_draw(double time) {
+// Draw a grid of small dragons, each turning and changing shape out of phase
+// with its neighbors.
+static void draw_field(double time, float pixels) {
+    static struct dragon_instance field[FIELD_COLUMNS * FIELD_ROWS];
+    const float spacing = 2.0f / FIELD_ROWS;
+    for (int row = 0; row < FIELD_ROWS; row++) {
+        for (int col = 0; col < FIELD_COLUMNS; col++) {
+            float u = (float)col / (FIELD_COLUMNS - 1);
+            float v = (float)row / (FIELD_ROWS - 1);
+            double phase = 0.7 * col + 1.1 * row;
+            field[row * FIELD_COLUMNS + col] = (struct dragon_instance){
+                .x = ((float)col - 0.5f * (FIELD_COLUMNS - 1)) * spacing,
+                .y = ((float)row - 0.5f * (FIELD_ROWS - 1)) * spacing,
+                .scale = 0.4f * spacing,
+                .angle = (float)(0.5 * time + phase),
+                .a = (float)(0.5 * sin(1.3 * time + phase)),
+                .color = {(uint8_t)(40 + 80 * u), 40, (uint8_t)(40 + 80 * v)},
+            };
+        }
+    }
+    dragon_draw_instances(&drawlist, field, FIELD_COLUMNS * FIELD_ROWS, pixels);
+}
+
+void demo_draw(double time, int width, int height) {
+    // Clamp the step, so seeking or a long hitch does not explode the
+    // simulation.
+    double dt = time - last_time;
+    last_time = time;
+    if (dt < 0.0) {
+        dt = 0.0;
+    } else if (dt > 0.1) {
+        dt = 0.1;
+    }
+    particles_update(&particles, (float)dt);
+
+    frame_update(time, width, height);
+    post_begin(width, height);
     glClear(GL_COLOR_BUFFER_BIT);
-    dragon_draw(time);
+    // Pixels per unit, for the view the shaders fit to the framebuffer.
+    const struct frame_uniforms *frame = frame_current();
+    float pixels = 0.5f * frame->resolution[1] * frame->view[1];
+    draw_field(time, pixels);
+    particles_draw(&particles, &drawlist);
+    dragon_draw(&drawlist, time, pixels);
+    float blur = 0.0f;
+    if (time >= 0.0) {
+        double n = floor(time / CURVE_TIME);
+        int i = (int)fmod(n, CURVE_COUNT);
+        double t = time - n * CURVE_TIME;
+        float part = (float)(t / (CURVE_TIME * 0.75));
+        curve_draw(&drawlist, CURVES[i].ls, CURVES[i].depth, 1.25f, 0.4f,
+                   0.45f, part);
+        double edge = fmin(t, CURVE_TIME - t) / BLUR_TIME;
+        if (edge < 1.0) {
+            blur = (float)(1.0 - edge * edge);
+        }
+    }
+    drawlist_submit(&drawlist);
+    post_end(&(struct post_params){
+        .bloom_threshold = 0.5f,
+        .bloom_knee = 0.25f,
+        .bloom_intensity = 0.8f,
+        .blur = blur,
+        .exposure = 1.0f,
+    });
 }
@@ -5,9 +5,16 @@
 extern "C" {
 #endif
 
+// Length of the demo, in seconds.
+#define DEMO_LENGTH 48.0
+
 void demo_init(void);
 
-void demo_draw(double time);
+// Release the demo's resources. Only needed to check for leaks.
+void demo_term(void);
+
+// Draw a frame, to a framebuffer with the given size in pixels.
+void demo_draw(double time, int width, int height);
 
 #if defined __cplusplus
 }
@@ -1,24 +1,158 @@
-// dragon.h - Draw dragon curve.
+// dragon.c - Draw dragon curve.
 #include "tcm/dragon.h"
 
+#include "tcm/drawlist.h"
 #include "tcm/gl.h"
+#include "tcm/glstate.h"
 #include "tcm/shaders.h"
+#include "tcm/stream.h"
 
 #include <math.h>
+#include <stddef.h>
 
 GLuint arr;
 
+// Vertex array for instances, which reads from the stream buffer.
+static GLuint instance_arr;
+
 void dragon_init(void) {
     glGenVertexArrays(1, &arr);
+    glGenVertexArrays(1, &instance_arr);
+    glstate_bind_vertex_array(instance_arr);
+    for (int i = 0; i < 3; i++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+}
+
+void dragon_term(void) {
+    glstate_delete_vertex_arrays(1, &arr);
+    glstate_delete_vertex_arrays(1, &instance_arr);
+    arr = 0;
+    instance_arr = 0;
+}
+
+enum {
+    // Maximum number of subdivisions, which bounds the number of vertices.
+    MAX_DEPTH = 14,
+};
+
+// Target length of a segment on screen, in pixels.
+static const float SEGMENT_PIXELS = 4.0f;
+
+// In variants of the programs, depth is a constant, and setting it does
+// nothing.
+static void dragon_uniforms(const struct draw_item *item) {
+    GLuint prog = item->program;
+    glUniform1f(glGetUniformLocation(prog, "a"), item->params[0]);
+    glUniform1i(glGetUniformLocation(prog, "depth"), (GLint)item->params[1]);
+    glUniform1f(glGetUniformLocation(prog, "morph"), item->params[2]);
+}
+
+// Return the subdivision depth where segments are the target length on
+// screen. The fractional part is used to morph between depths.
+static float dragon_depth(float a, float pixels) {
+    // Each subdivision replaces a segment with two segments, each shorter by
+    // this factor. The curve starts as one segment of length 2.
+    float shrink = sqrtf(0.25f + a * a);
+    float depth = logf(SEGMENT_PIXELS / (2.0f * pixels)) / logf(shrink);
+    if (!(depth > 0.0f)) {
+        return 0.0f;
+    }
+    return depth < MAX_DEPTH ? depth : MAX_DEPTH;
+}
+
+// The curve is drawn one level deeper than the whole part of the depth, with
+// the last level morphed in.
+int dragon_lod(float a, float pixels, float *morph) {
+    float depth = dragon_depth(a, pixels);
+    int coarse = (int)depth;
+    if (coarse + 1 > MAX_DEPTH) {
+        *morph = 1.0f;
+        return MAX_DEPTH;
+    }
+    *morph = depth - (float)coarse;
+    return coarse + 1;
 }
 
-void dragon_draw(double time) {
+void dragon_draw(struct drawlist *dl, double time, float pixels) {
     if (shader_line == 0) {
         return;
     }
-    glUseProgram(shader_line);
-    glBindVertexArray(arr);
-    glUniform1f(glGetUniformLocation(shader_line, "a"), 0.5 * sin(time));
-    const int N = 8;
-    glDrawArrays(GL_LINE_STRIP_ADJACENCY, 0, (1 << N) + 3);
+    float a = (float)(0.5 * sin(time));
+    float morph;
+    int n = dragon_lod(a, pixels, &morph);
+    GLuint prog = shader_variant(
+        SHADER_PROGRAM_LINE,
+        &(struct shader_key){.knob[SHADER_KNOB_DEPTH] = n});
+    if (prog == 0) {
+        prog = shader_line;
+    }
+    drawlist_add(dl, &(struct draw_item){
+                         .program = prog,
+                         .vertex_array = arr,
+                         .mode = GL_LINE_STRIP_ADJACENCY,
+                         .first = 0,
+                         .count = (1 << n) + 3,
+                         .uniforms = dragon_uniforms,
+                         .params = {a, (float)n, morph},
+                     });
+}
+
+static void dragon_instance_uniforms(const struct draw_item *item) {
+    GLuint prog = item->program;
+    glUniform1i(glGetUniformLocation(prog, "depth"), (GLint)item->params[0]);
+    glUniform1f(glGetUniformLocation(prog, "morph"), item->params[1]);
+}
+
+void dragon_draw_instances(struct drawlist *dl,
+                           const struct dragon_instance *instances, int count,
+                           float pixels) {
+    if (shader_dragon_instanced == 0 || count <= 0) {
+        return;
+    }
+    // Segments are longest for the largest curve, and shrink most slowly for
+    // the largest value of a.
+    float max_scale = 0.0f, max_a = 0.0f;
+    for (int i = 0; i < count; i++) {
+        max_scale = fmaxf(max_scale, fabsf(instances[i].scale));
+        max_a = fmaxf(max_a, fabsf(instances[i].a));
+    }
+    float morph;
+    int n = dragon_lod(max_a, pixels * max_scale, &morph);
+    GLuint prog = shader_variant(
+        SHADER_PROGRAM_DRAGON_INSTANCED,
+        &(struct shader_key){.knob[SHADER_KNOB_DEPTH] = n});
+    if (prog == 0) {
+        prog = shader_dragon_instanced;
+    }
+
+    struct stream_range range;
+    if (!stream_write(instances, sizeof(*instances) * count,
+                      _Alignof(struct dragon_instance), &range)) {
+        return;
+    }
+    const GLsizei stride = sizeof(struct dragon_instance);
+    const GLintptr base = range.offset;
+    glstate_bind_vertex_array(instance_arr);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, range.buffer);
+    glVertexAttribPointer(
+        0, 4, GL_FLOAT, GL_FALSE, stride,
+        (void *)(base + offsetof(struct dragon_instance, x)));
+    glVertexAttribPointer(
+        1, 1, GL_FLOAT, GL_FALSE, stride,
+        (void *)(base + offsetof(struct dragon_instance, a)));
+    glVertexAttribPointer(
+        2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+        (void *)(base + offsetof(struct dragon_instance, color)));
+    drawlist_add(dl, &(struct draw_item){
+                         .program = prog,
+                         .vertex_array = instance_arr,
+                         .mode = GL_LINE_STRIP_ADJACENCY,
+                         .first = 0,
+                         .count = (1 << n) + 3,
+                         .instances = count,
+                         .uniforms = dragon_instance_uniforms,
+                         .params = {(float)n, morph},
+                     });
 }
@@ -1,6 +1,41 @@
 // dragon.h - Draw dragon curve.
 #pragma once
 
+#include <stdint.h>
+
+struct drawlist;
+
+// Parameters for one copy of the dragon curve, drawn with instancing.
+struct dragon_instance {
+    // Position of the center, and scale, where 1 is the size of the curve drawn
+    // by dragon_draw().
+    float x, y;
+    float scale;
+    // Rotation counterclockwise, in radians.
+    float angle;
+    // Shape parameter, which is 0.5 * sin(time) for dragon_draw().
+    float a;
+    // Color, RGBA. Alpha is ignored.
+    uint8_t color[4];
+};
+
 void dragon_init(void);
 
-void dragon_draw(double time);
+void dragon_term(void);
+
+// Choose the level of detail for a dragon curve with shape parameter a, at the
+// given number of pixels per unit. Returns the number of subdivisions, and
+// stores the amount to morph in the last subdivision, from 0 to 1.
+int dragon_lod(float a, float pixels, float *morph);
+
+// Draw the dragon curve. The level of detail is chosen so segments are about
+// the same length on screen, given the number of pixels per unit.
+void dragon_draw(struct drawlist *dl, double time, float pixels);
+
+// Draw many copies of the dragon curve in a single draw call. The instance
+// data is copied into the stream buffer. All copies are drawn with the same
+// level of detail, chosen for the largest one. May be called at most once per
+// frame, since the draw is submitted later.
+void dragon_draw_instances(struct drawlist *dl,
+                           const struct dragon_instance *instances, int count,
+                           float pixels);
@@ -0,0 +1,173 @@
+// drawlist.c - Sorted list of draw commands.
+#include "tcm/drawlist.h"
+
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void drawlist_init(struct drawlist *dl) {
+    memset(dl, 0, sizeof(*dl));
+    memtrack_add(MEMTRACK_HOST, (uintptr_t)dl, "drawlist");
+}
+
+void drawlist_destroy(struct drawlist *dl) {
+    memtrack_remove(MEMTRACK_HOST, (uintptr_t)dl);
+    free(dl->items);
+    free(dl->keys);
+    free(dl->order);
+    free(dl->firsts);
+    free(dl->counts);
+    memset(dl, 0, sizeof(*dl));
+}
+
+static void *xrealloc(void *ptr, size_t size) {
+    ptr = realloc(ptr, size);
+    if (ptr == NULL) {
+        fputs("Error: No memory\n", stderr);
+        exit(1);
+    }
+    return ptr;
+}
+
+void drawlist_add(struct drawlist *dl, const struct draw_item *item) {
+    if (dl->count >= dl->capacity) {
+        unsigned n = dl->capacity != 0 ? dl->capacity * 2 : 64;
+        dl->items = xrealloc(dl->items, sizeof(*dl->items) * n);
+        dl->keys = xrealloc(dl->keys, sizeof(*dl->keys) * n * 2);
+        dl->order = xrealloc(dl->order, sizeof(*dl->order) * n * 2);
+        dl->firsts = xrealloc(dl->firsts, sizeof(*dl->firsts) * n);
+        dl->counts = xrealloc(dl->counts, sizeof(*dl->counts) * n);
+        dl->capacity = n;
+        memtrack_set_size(MEMTRACK_HOST, (uintptr_t)dl,
+                          (sizeof(*dl->items) + sizeof(*dl->keys) * 2 +
+                           sizeof(*dl->order) * 2 + sizeof(*dl->firsts) +
+                           sizeof(*dl->counts)) *
+                              n);
+    }
+    dl->items[dl->count++] = *item;
+}
+
+// Compute the sort key for an item: layer, then program, vertex array, and
+// texture. Object names are truncated, which only affects how well items are
+// grouped, not correctness.
+static uint64_t item_key(const struct draw_item *item) {
+    return ((uint64_t)(uint8_t)(item->layer + 128) << 56) |
+           ((uint64_t)(item->program & 0xffff) << 40) |
+           ((uint64_t)(item->vertex_array & 0xffff) << 24) |
+           ((uint64_t)(item->texture & 0xffff) << 8);
+}
+
+// Sort items by key, using a stable LSD radix sort. Returns the sorted order.
+static const uint32_t *sort_items(struct drawlist *dl) {
+    unsigned n = dl->count;
+    uint64_t *keys = dl->keys, *keys_tmp = dl->keys + dl->capacity;
+    uint32_t *order = dl->order, *order_tmp = dl->order + dl->capacity;
+    uint64_t all_and = ~(uint64_t)0, all_or = 0;
+    for (unsigned i = 0; i < n; i++) {
+        uint64_t key = item_key(&dl->items[i]);
+        keys[i] = key;
+        order[i] = i;
+        all_and &= key;
+        all_or |= key;
+    }
+    // Bits which are the same in every key do not affect the order.
+    uint64_t varying = all_and ^ all_or;
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((varying >> shift) & 0xff) == 0) {
+            continue;
+        }
+        unsigned offset[256] = {0};
+        for (unsigned i = 0; i < n; i++) {
+            offset[(keys[i] >> shift) & 0xff]++;
+        }
+        unsigned pos = 0;
+        for (int d = 0; d < 256; d++) {
+            unsigned c = offset[d];
+            offset[d] = pos;
+            pos += c;
+        }
+        for (unsigned i = 0; i < n; i++) {
+            unsigned j = offset[(keys[i] >> shift) & 0xff]++;
+            keys_tmp[j] = keys[i];
+            order_tmp[j] = order[i];
+        }
+        uint64_t *kt = keys;
+        keys = keys_tmp;
+        keys_tmp = kt;
+        uint32_t *ot = order;
+        order = order_tmp;
+        order_tmp = ot;
+    }
+    return order;
+}
+
+// Return true if two items can be drawn in the same call.
+static bool compatible(const struct draw_item *x, const struct draw_item *y) {
+    return x->program == y->program && x->vertex_array == y->vertex_array &&
+           x->texture == y->texture && x->mode == y->mode &&
+           x->instances <= 1 && y->instances <= 1 &&
+           x->uniforms == y->uniforms &&
+           (x->uniforms == NULL ||
+            memcmp(x->params, y->params, sizeof(x->params)) == 0);
+}
+
+// Return true if consecutive ranges can be joined into one range. This is only
+// true for independent primitives.
+static bool joinable(GLenum mode) {
+    return mode == GL_POINTS || mode == GL_LINES || mode == GL_TRIANGLES;
+}
+
+void drawlist_submit(struct drawlist *dl) {
+    unsigned n = dl->count;
+    const uint32_t *order = sort_items(dl);
+    unsigned calls = 0;
+    unsigned i = 0;
+    while (i < n) {
+        const struct draw_item *item = &dl->items[order[i]];
+        glstate_use_program(item->program);
+        glstate_bind_vertex_array(item->vertex_array);
+        if (item->texture != 0) {
+            glstate_bind_texture(0, GL_TEXTURE_2D, item->texture);
+        }
+        if (item->uniforms != NULL) {
+            item->uniforms(item);
+        }
+        if (item->instances > 1) {
+            glDrawArraysInstanced(item->mode, item->first, item->count,
+                                  item->instances);
+            calls++;
+            i++;
+            continue;
+        }
+        // Gather the run of compatible items.
+        dl->firsts[0] = item->first;
+        dl->counts[0] = item->count;
+        unsigned nranges = 1;
+        for (i++; i < n; i++) {
+            const struct draw_item *next = &dl->items[order[i]];
+            if (!compatible(item, next)) {
+                break;
+            }
+            GLint end = dl->firsts[nranges - 1] + dl->counts[nranges - 1];
+            if (joinable(item->mode) && next->first == end) {
+                dl->counts[nranges - 1] += next->count;
+            } else {
+                dl->firsts[nranges] = next->first;
+                dl->counts[nranges] = next->count;
+                nranges++;
+            }
+        }
+        if (nranges == 1) {
+            glDrawArrays(item->mode, dl->firsts[0], dl->counts[0]);
+        } else {
+            glMultiDrawArrays(item->mode, dl->firsts, dl->counts, nranges);
+        }
+        calls++;
+    }
+    dl->stats = (struct drawlist_stats){n, calls};
+    dl->count = 0;
+}
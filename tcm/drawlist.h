@@ -0,0 +1,73 @@
+// drawlist.h - Sorted list of draw commands.
+#pragma once
+
+#include "tcm/gl.h"
+
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct draw_item;
+
+// Function which sets uniforms for a draw item. Called after the item's
+// program is bound.
+typedef void (*draw_uniform_fn)(const struct draw_item *item);
+
+// A draw command, equivalent to glDrawArraysInstanced.
+struct draw_item {
+    // Layers are drawn in increasing order. Within a layer, items are ordered
+    // to minimize state changes.
+    int layer;
+    GLuint program;
+    GLuint vertex_array;
+    // Texture bound to unit 0, or 0 for none.
+    GLuint texture;
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+    // Number of instances. 0 is treated as 1.
+    GLsizei instances;
+    // Optional uniform setup, and data for it to use. Items are only merged if
+    // both are the same.
+    draw_uniform_fn uniforms;
+    float params[4];
+};
+
+// Counts for the last submitted list.
+struct drawlist_stats {
+    // Number of items recorded.
+    unsigned items;
+    // Number of draw calls issued.
+    unsigned calls;
+};
+
+// A list of draw commands, recorded during a frame and submitted at the end.
+struct drawlist {
+    struct draw_item *items;
+    unsigned count;
+    unsigned capacity;
+    // Sort scratch space, with room for two arrays of capacity elements.
+    uint64_t *keys;
+    uint32_t *order;
+    // Multi-draw argument arrays.
+    GLint *firsts;
+    GLsizei *counts;
+    struct drawlist_stats stats;
+};
+
+void drawlist_init(struct drawlist *dl);
+
+void drawlist_destroy(struct drawlist *dl);
+
+// Record a draw command.
+void drawlist_add(struct drawlist *dl, const struct draw_item *item);
+
+// Sort the recorded commands, submit them to OpenGL, and clear the list.
+// Consecutive commands with the same state are merged into one draw call.
+void drawlist_submit(struct drawlist *dl);
+
+#if defined __cplusplus
+}
+#endif
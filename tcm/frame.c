@@ -0,0 +1,64 @@
+// frame.c - Uniforms shared by all programs, updated once per frame.
+#include "tcm/frame.h"
+
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
+
+// Width divided by height of the view.
+static const float VIEW_ASPECT = 16.0f / 9.0f;
+
+static struct frame_uniforms current;
+
+// The buffer holding the block. It has its own buffer rather than a range of
+// the stream buffer, which may be orphaned later in the frame.
+static GLuint buffer;
+
+void frame_update(double time, int width, int height) {
+    if (width < 1) {
+        width = 1;
+    }
+    if (height < 1) {
+        height = 1;
+    }
+    float aspect = (float)width / (float)height;
+    current = (struct frame_uniforms){
+        .resolution = {(float)width, (float)height},
+        .time = (float)time,
+        .aspect = aspect,
+    };
+    if (aspect > VIEW_ASPECT) {
+        current.view[0] = 1.0f / aspect;
+        current.view[1] = 1.0f;
+    } else {
+        current.view[0] = 1.0f / VIEW_ASPECT;
+        current.view[1] = aspect / VIEW_ASPECT;
+    }
+
+    if (buffer == 0) {
+        glGenBuffers(1, &buffer);
+        memtrack_add(MEMTRACK_BUFFER, buffer, "frame");
+        memtrack_set_size(MEMTRACK_BUFFER, buffer, sizeof(current));
+    }
+    glstate_bind_buffer(GL_UNIFORM_BUFFER, buffer);
+    // Orphan the last frame's storage, which the GPU may still be reading.
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(current), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(current), &current);
+    glstate_bind_buffer_range(GL_UNIFORM_BUFFER, FRAME_BINDING, buffer, 0,
+                              sizeof(current));
+}
+
+void frame_term(void) {
+    glstate_delete_buffers(1, &buffer);
+    buffer = 0;
+}
+
+const struct frame_uniforms *frame_current(void) {
+    return &current;
+}
+
+void frame_bind_block(GLuint program) {
+    GLuint index = glGetUniformBlockIndex(program, "Frame");
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, index, FRAME_BINDING);
+    }
+}
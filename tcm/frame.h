@@ -0,0 +1,46 @@
+// frame.h - Uniforms shared by all programs, updated once per frame.
+#pragma once
+
+#include "tcm/gl.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+enum {
+    // Uniform buffer binding point for the Frame block.
+    FRAME_BINDING = 0,
+};
+
+// Contents of the Frame uniform block in shader/frame.glsl, in std140 layout.
+struct frame_uniforms {
+    // Framebuffer size, in pixels.
+    float resolution[2];
+    // Scale from view coordinates to clip coordinates. The view is 2 units high
+    // and 16:9, and is fit inside the framebuffer without stretching.
+    float view[2];
+    // Demo time, in seconds.
+    float time;
+    // Framebuffer width divided by height.
+    float aspect;
+    // Pads the block to a multiple of 16 bytes.
+    float pad[2];
+};
+
+// Set the uniforms for a frame, write them to the frame's uniform buffer, and
+// bind them to FRAME_BINDING. Call before drawing.
+void frame_update(double time, int width, int height);
+
+// Delete the uniform buffer.
+void frame_term(void);
+
+// Get the uniforms for the current frame.
+const struct frame_uniforms *frame_current(void);
+
+// Assign the Frame block of a program, if it has one, to FRAME_BINDING. Call
+// each time the program is linked.
+void frame_bind_block(GLuint program);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,247 @@
+// glstate.c - OpenGL state cache.
+#include "tcm/glstate.h"
+
+#include "tcm/memtrack.h"
+
+#include <string.h>
+
+// Value for state which is unknown, and must be set on the next call.
+#define UNKNOWN 0xffffffffu
+
+enum {
+    BUF_ARRAY,
+    BUF_ELEMENT_ARRAY,
+    BUF_PIXEL_PACK,
+    BUF_PIXEL_UNPACK,
+    BUF_UNIFORM,
+    BUF_TRANSFORM_FEEDBACK,
+    BUF_COPY_READ,
+    BUF_COPY_WRITE,
+    BUF_COUNT,
+};
+
+enum {
+    TEX_2D,
+    TEX_2D_ARRAY,
+    TEX_3D,
+    TEX_CUBE_MAP,
+    TEX_COUNT,
+};
+
+static struct {
+    GLuint program;
+    GLuint vertex_array;
+    GLuint buffer[BUF_COUNT];
+    GLuint active_texture;
+    GLuint texture[GLSTATE_TEXTURE_UNITS][TEX_COUNT];
+    GLuint blend;
+    GLuint blend_src, blend_dst;
+    GLuint depth_test;
+    GLuint depth_func;
+} state = {
+    // OpenGL defaults for state which is not zero.
+    .blend_src = GL_ONE,
+    .blend_dst = GL_ZERO,
+    .depth_func = GL_LESS,
+};
+
+static struct glstate_stats counts, last_frame;
+
+static int buffer_index(GLenum target) {
+    switch (target) {
+    case GL_ARRAY_BUFFER:
+        return BUF_ARRAY;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        return BUF_ELEMENT_ARRAY;
+    case GL_PIXEL_PACK_BUFFER:
+        return BUF_PIXEL_PACK;
+    case GL_PIXEL_UNPACK_BUFFER:
+        return BUF_PIXEL_UNPACK;
+    case GL_UNIFORM_BUFFER:
+        return BUF_UNIFORM;
+    case GL_TRANSFORM_FEEDBACK_BUFFER:
+        return BUF_TRANSFORM_FEEDBACK;
+    case GL_COPY_READ_BUFFER:
+        return BUF_COPY_READ;
+    case GL_COPY_WRITE_BUFFER:
+        return BUF_COPY_WRITE;
+    default:
+        return -1;
+    }
+}
+
+static int texture_index(GLenum target) {
+    switch (target) {
+    case GL_TEXTURE_2D:
+        return TEX_2D;
+    case GL_TEXTURE_2D_ARRAY:
+        return TEX_2D_ARRAY;
+    case GL_TEXTURE_3D:
+        return TEX_3D;
+    case GL_TEXTURE_CUBE_MAP:
+        return TEX_CUBE_MAP;
+    default:
+        return -1;
+    }
+}
+
+// Record a state change and return true if it must be issued.
+static bool update(GLuint *cached, GLuint value) {
+    if (*cached == value) {
+        counts.skipped++;
+        return false;
+    }
+    counts.issued++;
+    *cached = value;
+    return true;
+}
+
+void glstate_invalidate(void) {
+    memset(&state, 0xff, sizeof(state));
+}
+
+void glstate_end_frame(void) {
+    last_frame = counts;
+    counts = (struct glstate_stats){0, 0};
+}
+
+struct glstate_stats glstate_frame_stats(void) {
+    return last_frame;
+}
+
+void glstate_use_program(GLuint program) {
+    if (update(&state.program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void glstate_bind_vertex_array(GLuint array) {
+    if (update(&state.vertex_array, array)) {
+        glBindVertexArray(array);
+        // The element array binding is part of the vertex array state.
+        state.buffer[BUF_ELEMENT_ARRAY] = UNKNOWN;
+    }
+}
+
+void glstate_bind_buffer(GLenum target, GLuint buffer) {
+    int idx = buffer_index(target);
+    if (idx < 0) {
+        counts.issued++;
+        glBindBuffer(target, buffer);
+    } else if (update(&state.buffer[idx], buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void glstate_bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+                               GLintptr offset, GLsizeiptr size) {
+    int idx = buffer_index(target);
+    if (idx >= 0) {
+        state.buffer[idx] = buffer;
+    }
+    counts.issued++;
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void glstate_bind_texture(int unit, GLenum target, GLuint texture) {
+    int idx = texture_index(target);
+    if (idx < 0 || unit < 0 || unit >= GLSTATE_TEXTURE_UNITS) {
+        state.active_texture = UNKNOWN;
+        counts.issued += 2;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        return;
+    }
+    if (state.texture[unit][idx] == texture) {
+        counts.skipped++;
+        return;
+    }
+    if (update(&state.active_texture, unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    counts.issued++;
+    state.texture[unit][idx] = texture;
+    glBindTexture(target, texture);
+}
+
+void glstate_set_blend(bool enabled) {
+    if (update(&state.blend, enabled)) {
+        if (enabled) {
+            glEnable(GL_BLEND);
+        } else {
+            glDisable(GL_BLEND);
+        }
+    }
+}
+
+void glstate_blend_func(GLenum sfactor, GLenum dfactor) {
+    if (state.blend_src == sfactor && state.blend_dst == dfactor) {
+        counts.skipped++;
+        return;
+    }
+    counts.issued++;
+    state.blend_src = sfactor;
+    state.blend_dst = dfactor;
+    glBlendFunc(sfactor, dfactor);
+}
+
+void glstate_set_depth_test(bool enabled) {
+    if (update(&state.depth_test, enabled)) {
+        if (enabled) {
+            glEnable(GL_DEPTH_TEST);
+        } else {
+            glDisable(GL_DEPTH_TEST);
+        }
+    }
+}
+
+void glstate_depth_func(GLenum func) {
+    if (update(&state.depth_func, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void glstate_delete_program(GLuint program) {
+    if (program != 0 && state.program == program) {
+        // A program in use is only flagged for deletion, so unbind it first.
+        glstate_use_program(0);
+    }
+    memtrack_remove(MEMTRACK_PROGRAM, program);
+    glDeleteProgram(program);
+}
+
+void glstate_delete_vertex_arrays(GLsizei n, const GLuint *arrays) {
+    for (GLsizei i = 0; i < n; i++) {
+        if (arrays[i] != 0 && state.vertex_array == arrays[i]) {
+            state.vertex_array = 0;
+            state.buffer[BUF_ELEMENT_ARRAY] = UNKNOWN;
+        }
+    }
+    glDeleteVertexArrays(n, arrays);
+}
+
+void glstate_delete_buffers(GLsizei n, const GLuint *buffers) {
+    for (GLsizei i = 0; i < n; i++) {
+        for (int j = 0; j < BUF_COUNT; j++) {
+            if (buffers[i] != 0 && state.buffer[j] == buffers[i]) {
+                state.buffer[j] = 0;
+            }
+        }
+        memtrack_remove(MEMTRACK_BUFFER, buffers[i]);
+    }
+    glDeleteBuffers(n, buffers);
+}
+
+void glstate_delete_textures(GLsizei n, const GLuint *textures) {
+    for (GLsizei i = 0; i < n; i++) {
+        for (int u = 0; u < GLSTATE_TEXTURE_UNITS; u++) {
+            for (int j = 0; j < TEX_COUNT; j++) {
+                if (textures[i] != 0 && state.texture[u][j] == textures[i]) {
+                    state.texture[u][j] = 0;
+                }
+            }
+        }
+        memtrack_remove(MEMTRACK_TEXTURE, textures[i]);
+    }
+    glDeleteTextures(n, textures);
+}
@@ -0,0 +1,73 @@
+// glstate.h - OpenGL state cache.
+#pragma once
+
+#include "tcm/gl.h"
+
+#include <stdbool.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// The state cache shadows the OpenGL bindings and capabilities below, and
+// skips calls which would not change anything. All code which changes this
+// state must go through the cache, or call glstate_invalidate() afterwards.
+
+// Number of texture units tracked.
+#define GLSTATE_TEXTURE_UNITS 8
+
+// Counts of state changes.
+struct glstate_stats {
+    // Calls passed through to OpenGL.
+    unsigned issued;
+    // Calls skipped because the state was already set.
+    unsigned skipped;
+};
+
+// Forget all cached state, so the next call of each kind is issued.
+void glstate_invalidate(void);
+
+// Finish a frame, making its counts available from glstate_frame_stats().
+void glstate_end_frame(void);
+
+// Get the counts for the last completed frame.
+struct glstate_stats glstate_frame_stats(void);
+
+void glstate_use_program(GLuint program);
+
+void glstate_bind_vertex_array(GLuint array);
+
+// Bind a buffer. Supports the array, element array, pixel pack, pixel unpack,
+// uniform, transform feedback, copy read, and copy write targets. Other
+// targets are passed through uncached.
+void glstate_bind_buffer(GLenum target, GLuint buffer);
+
+// Bind a range of a buffer to an indexed binding point, with
+// glBindBufferRange. This also binds the buffer to the target, which is
+// recorded in the cache. Indexed bindings are not cached.
+void glstate_bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+                               GLintptr offset, GLsizeiptr size);
+
+// Bind a texture to a texture unit, changing the active texture unit if
+// necessary.
+void glstate_bind_texture(int unit, GLenum target, GLuint texture);
+
+void glstate_set_blend(bool enabled);
+
+void glstate_blend_func(GLenum sfactor, GLenum dfactor);
+
+void glstate_set_depth_test(bool enabled);
+
+void glstate_depth_func(GLenum func);
+
+// Delete objects, clearing any cached bindings which refer to them. OpenGL
+// implicitly unbinds deleted objects. Deleted objects are also removed from the
+// memory accounting in memtrack.h.
+void glstate_delete_program(GLuint program);
+void glstate_delete_vertex_arrays(GLsizei n, const GLuint *arrays);
+void glstate_delete_buffers(GLsizei n, const GLuint *buffers);
+void glstate_delete_textures(GLsizei n, const GLuint *textures);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,255 @@
+// load_shaders.c - Load the shaders embedded in the program.
+#include "tcm/load_shaders.h"
+
+#include "tcm/frame.h"
+#include "tcm/gl.h"
+#include "tcm/packed_shaders.h"
+#include "tcm/particles.h"
+#include "tcm/shaders.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void die(const char *msg) __attribute__((noreturn));
+
+static void die(const char *msg) {
+    fprintf(stderr, "Error: %s\n", msg);
+    exit(1);
+}
+
+// Compile a shader from a list of source strings, and return the shader
+// object.
+static GLuint compile_shader(GLenum type, GLsizei count,
+                             const char *const *strings,
+                             const GLint *lengths) {
+    GLuint shader = glCreateShader(type);
+    if (shader == 0) {
+        die("Could not create shader");
+    }
+    glShaderSource(shader, count, strings, lengths);
+    glCompileShader(shader);
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        fputs("Error: Could not compile shader.\n", stderr);
+    }
+    GLint loglen;
+    // loglen includes nul terminator.
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &loglen);
+    if (loglen > 1) {
+        char *log = malloc(loglen);
+        if (log == NULL) {
+            die("No memory");
+        }
+        glGetShaderInfoLog(shader, loglen, NULL, log);
+        log[loglen - 1] = '\0';
+        fputs("-- Shader compilation log --\n", stderr);
+        fputs(log, stderr);
+        free(log);
+    }
+    if (!status) {
+        die("Shader compilation failed.");
+    }
+    return shader;
+}
+
+// Load a single shader, and return the shader object.
+static GLuint load_shader(GLenum type, const char *source, size_t sourcelen) {
+    return compile_shader(type, 1, (const char *[]){source},
+                          (const GLint[]){sourcelen});
+}
+
+// Load a variant of a shader, with defines inserted after the #version line,
+// and return the shader object.
+static GLuint load_variant_shader(GLenum type, const char *source,
+                                  size_t sourcelen, const char *defines) {
+    const char *eol = memchr(source, '\n', sourcelen);
+    size_t head = eol != NULL ? (size_t)(eol - source) + 1 : sourcelen;
+    return compile_shader(
+        type, 3, (const char *[]){source, defines, source + head},
+        (const GLint[]){head, strlen(defines), sourcelen - head});
+}
+
+// Link an OpenGL shader program. If varyings is not NULL, it is a
+// NULL-terminated list of outputs to capture with transform feedback.
+static GLuint link_program(const GLuint *restrict shaders,
+                           const char *const *varyings) {
+    GLuint prog = glCreateProgram();
+    if (prog == 0) {
+        die("Could not create program");
+    }
+    for (int i = 0; shaders[i] != 0; i++) {
+        glAttachShader(prog, shaders[i]);
+    }
+    if (varyings != NULL) {
+        GLsizei count = 0;
+        while (varyings[count] != NULL) {
+            count++;
+        }
+        glTransformFeedbackVaryings(prog, count, varyings,
+                                    GL_INTERLEAVED_ATTRIBS);
+    }
+    glLinkProgram(prog);
+    GLint status;
+    glGetProgramiv(prog, GL_LINK_STATUS, &status);
+    if (!status) {
+        fputs("Error: Could not link program.\n", stderr);
+    }
+    GLint loglen;
+    // loglen includes nul terminator.
+    glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &loglen);
+    if (loglen > 1) {
+        char *log = malloc(loglen);
+        if (log == NULL) {
+            die("No memory");
+        }
+        glGetProgramInfoLog(prog, loglen, NULL, log);
+        log[loglen - 1] = '\0';
+        fputs("-- Shader linking log --\n", stderr);
+        fputs(log, stderr);
+        free(log);
+    }
+    if (!status) {
+        die("Shader linking failed.");
+    }
+    frame_bind_block(prog);
+    return prog;
+}
+
+// Compile the variants listed in variants.txt, and add them to the variant
+// cache. Only the shader which uses the knobs is compiled for each variant, and
+// the others are shared with the general program.
+static void load_variants(GLuint line_geom, GLuint line_frag,
+                          GLuint post_vert) {
+    const struct {
+        GLenum type;
+        const char *source;
+        size_t size;
+        GLuint shared[2];
+    } SOURCES[SHADER_PROGRAM_COUNT] = {
+        [SHADER_PROGRAM_LINE] = {GL_VERTEX_SHADER, LINE_VERT,
+                                 sizeof(LINE_VERT), {line_geom, line_frag}},
+        [SHADER_PROGRAM_DRAGON_INSTANCED] = {GL_VERTEX_SHADER,
+                                             DRAGON_INSTANCED_VERT,
+                                             sizeof(DRAGON_INSTANCED_VERT),
+                                             {line_geom, line_frag}},
+        [SHADER_PROGRAM_POST_COMPOSITE] = {GL_FRAGMENT_SHADER,
+                                           POST_COMPOSITE_FRAG,
+                                           sizeof(POST_COMPOSITE_FRAG),
+                                           {post_vert, 0}},
+    };
+    char defines[256];
+    for (const struct packed_variant *p = PACKED_VARIANTS;
+         p->program != SHADER_PROGRAM_COUNT; p++) {
+        struct shader_variant *v = shader_variant_add(p->program, &p->key);
+        if (v == NULL) {
+            die("Too many shader variants");
+        }
+        if (shader_defines(p->program, &p->key, defines, sizeof(defines)) >=
+            sizeof(defines)) {
+            die("Shader defines too long");
+        }
+        GLuint shader =
+            load_variant_shader(SOURCES[p->program].type,
+                                SOURCES[p->program].source,
+                                SOURCES[p->program].size, defines);
+        v->id = link_program(
+            (const GLuint[]){
+                shader,
+                SOURCES[p->program].shared[0],
+                SOURCES[p->program].shared[1],
+                0,
+            },
+            NULL);
+        // Freed with the program.
+        glDeleteShader(shader);
+    }
+}
+
+void load_shaders(void) {
+    const GLuint line_geom =
+        load_shader(GL_GEOMETRY_SHADER, LINE_GEOM, sizeof(LINE_GEOM));
+    const GLuint line_frag =
+        load_shader(GL_FRAGMENT_SHADER, LINE_FRAG, sizeof(LINE_FRAG));
+    shader_triangle = link_program(
+        (const GLuint[]){
+            load_shader(GL_VERTEX_SHADER, TRIANGLE_VERT, sizeof(TRIANGLE_VERT)),
+            load_shader(GL_FRAGMENT_SHADER, TRIANGLE_FRAG,
+                        sizeof(TRIANGLE_FRAG)),
+            0,
+        },
+        NULL);
+    shader_line = link_program(
+        (const GLuint[]){
+            load_shader(GL_VERTEX_SHADER, LINE_VERT, sizeof(LINE_VERT)),
+            line_geom,
+            line_frag,
+            0,
+        },
+        NULL);
+    shader_dragon_instanced = link_program(
+        (const GLuint[]){
+            load_shader(GL_VERTEX_SHADER, DRAGON_INSTANCED_VERT,
+                        sizeof(DRAGON_INSTANCED_VERT)),
+            line_geom,
+            line_frag,
+            0,
+        },
+        NULL);
+    shader_curve = link_program(
+        (const GLuint[]){
+            load_shader(GL_VERTEX_SHADER, CURVE_VERT, sizeof(CURVE_VERT)),
+            line_geom,
+            line_frag,
+            0,
+        },
+        NULL);
+    shader_particle_update = link_program(
+        (const GLuint[]){
+            load_shader(GL_VERTEX_SHADER, PARTICLE_UPDATE_VERT,
+                        sizeof(PARTICLE_UPDATE_VERT)),
+            0,
+        },
+        (const char *const[]){
+            PARTICLE_VARYINGS[0],
+            PARTICLE_VARYINGS[1],
+            PARTICLE_VARYINGS[2],
+            NULL,
+        });
+    shader_particle = link_program(
+        (const GLuint[]){
+            load_shader(GL_VERTEX_SHADER, PARTICLE_VERT, sizeof(PARTICLE_VERT)),
+            load_shader(GL_FRAGMENT_SHADER, PARTICLE_FRAG,
+                        sizeof(PARTICLE_FRAG)),
+            0,
+        },
+        NULL);
+
+    const GLuint post_vert =
+        load_shader(GL_VERTEX_SHADER, POST_VERT, sizeof(POST_VERT));
+    static const struct {
+        GLuint *program;
+        const char *frag;
+        size_t size;
+    } POST[] = {
+        {&shader_post_prefilter, POST_PREFILTER_FRAG,
+         sizeof(POST_PREFILTER_FRAG)},
+        {&shader_post_down, POST_DOWN_FRAG, sizeof(POST_DOWN_FRAG)},
+        {&shader_post_blur, POST_BLUR_FRAG, sizeof(POST_BLUR_FRAG)},
+        {&shader_post_up, POST_UP_FRAG, sizeof(POST_UP_FRAG)},
+        {&shader_post_composite, POST_COMPOSITE_FRAG,
+         sizeof(POST_COMPOSITE_FRAG)},
+    };
+    for (size_t i = 0; i < sizeof(POST) / sizeof(*POST); i++) {
+        *POST[i].program = link_program(
+            (const GLuint[]){
+                post_vert,
+                load_shader(GL_FRAGMENT_SHADER, POST[i].frag, POST[i].size),
+                0,
+            },
+            NULL);
+    }
+
+    load_variants(line_geom, line_frag, post_vert);
+}
@@ -0,0 +1,7 @@
+// load_shaders.h - Load the shaders embedded in the program.
+#pragma once
+
+// Compile and link all shader programs from the packed shader sources, and
+// store them in the variables declared in shaders.h. The variants listed in
+// shader/variants.txt are added to the variant cache. Exits on failure.
+void load_shaders(void);
@@ -0,0 +1,423 @@
+// lsystem.c - L-system curve generator.
+#include "tcm/lsystem.h"
+
+#include "tcm/vecmath.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+const struct lsystem LSYSTEM_DRAGON = {
+    .name = "dragon",
+    .axiom = "FX",
+    .rules = {['X'] = "X+YF+", ['Y'] = "-FX-Y"},
+    .draw = "F",
+    .divisions = 4,
+};
+
+const struct lsystem LSYSTEM_HILBERT = {
+    .name = "hilbert",
+    .axiom = "A",
+    .rules = {['A'] = "+BF-AFA-FB+", ['B'] = "-AF+BFB+FA-"},
+    .draw = "F",
+    .divisions = 4,
+};
+
+const struct lsystem LSYSTEM_KOCH = {
+    .name = "koch",
+    .axiom = "F--F--F",
+    .rules = {['F'] = "F+F--F+F"},
+    .draw = "F",
+    .divisions = 6,
+};
+
+const struct lsystem LSYSTEM_GOSPER = {
+    .name = "gosper",
+    .axiom = "A",
+    .rules = {['A'] = "A-B--B+A++AA+B-", ['B'] = "+A-AA--B-A++A+B"},
+    .draw = "AB",
+    .divisions = 6,
+};
+
+const struct lsystem LSYSTEM_SIERPINSKI = {
+    .name = "sierpinski",
+    .axiom = "A",
+    .rules = {['A'] = "B-A-B", ['B'] = "A+B+A"},
+    .draw = "AB",
+    .divisions = 6,
+};
+
+const struct lsystem LSYSTEM_LEVY = {
+    .name = "levy",
+    .axiom = "F",
+    .rules = {['F'] = "+F--F+"},
+    .draw = "F",
+    .divisions = 8,
+};
+
+enum {
+    MAX_THREADS = 16,
+    // Inputs smaller than this are not split between threads.
+    MIN_CHUNK = 1 << 14,
+    // Limits on the size of the expanded string and the curve.
+    MAX_SYMBOLS = 1 << 28,
+    MAX_VERTICES = 1 << 26,
+};
+
+// =============================================================================
+// Threads
+// =============================================================================
+
+typedef void (*chunk_fn)(void *arg, int chunk);
+
+struct chunk_task {
+    chunk_fn fn;
+    void *arg;
+    int chunk;
+};
+
+static void *chunk_main(void *arg) {
+    struct chunk_task *t = arg;
+    t->fn(t->arg, t->chunk);
+    return NULL;
+}
+
+// Call fn for each chunk, in parallel. Chunk 0 runs on the calling thread. If a
+// thread cannot be created, its chunk runs on the calling thread instead.
+static void run_chunks(int chunks, chunk_fn fn, void *arg) {
+    pthread_t threads[MAX_THREADS];
+    struct chunk_task tasks[MAX_THREADS];
+    bool started[MAX_THREADS] = {false};
+    for (int i = 1; i < chunks; i++) {
+        tasks[i] = (struct chunk_task){.fn = fn, .arg = arg, .chunk = i};
+        started[i] =
+            pthread_create(&threads[i], NULL, chunk_main, &tasks[i]) == 0;
+    }
+    fn(arg, 0);
+    for (int i = 1; i < chunks; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            fn(arg, i);
+        }
+    }
+}
+
+// Return the number of chunks to split n items into.
+static int chunk_count(size_t n, int threads) {
+    size_t chunks = n / MIN_CHUNK;
+    if (chunks < 1) {
+        return 1;
+    }
+    return chunks < (size_t)threads ? (int)chunks : threads;
+}
+
+// Return the start of a chunk, in a range of n items.
+static size_t chunk_start(size_t n, int chunks, int chunk) {
+    return (size_t)((uint64_t)n * chunk / chunks);
+}
+
+// =============================================================================
+// Expansion
+// =============================================================================
+
+// State for one iteration of expanding the string. The output position of each
+// chunk is the prefix sum of the lengths of the rules for the symbols before
+// it.
+struct expand {
+    const struct lsystem *ls;
+    // Output length for each symbol.
+    uint32_t length[256];
+    const unsigned char *src;
+    size_t n;
+    char *dst;
+    int chunks;
+    // Output length of each chunk, then its output position.
+    size_t offset[MAX_THREADS];
+};
+
+static void expand_measure(void *arg, int chunk) {
+    struct expand *e = arg;
+    size_t end = chunk_start(e->n, e->chunks, chunk + 1);
+    size_t total = 0;
+    for (size_t i = chunk_start(e->n, e->chunks, chunk); i < end; i++) {
+        total += e->length[e->src[i]];
+    }
+    e->offset[chunk] = total;
+}
+
+static void expand_write(void *arg, int chunk) {
+    struct expand *e = arg;
+    size_t end = chunk_start(e->n, e->chunks, chunk + 1);
+    char *out = e->dst + e->offset[chunk];
+    for (size_t i = chunk_start(e->n, e->chunks, chunk); i < end; i++) {
+        unsigned c = e->src[i];
+        const char *rule = c < 128 ? e->ls->rules[c] : NULL;
+        if (rule == NULL) {
+            *out++ = (char)c;
+        } else {
+            size_t len = e->length[c];
+            memcpy(out, rule, len);
+            out += len;
+        }
+    }
+}
+
+// Expand the L-system to the given depth. Returns the string, or NULL on
+// failure.
+static char *expand(const struct lsystem *ls, int depth, int threads,
+                    size_t *len) {
+    struct expand e = {.ls = ls};
+    for (int c = 0; c < 256; c++) {
+        const char *rule = c < 128 ? ls->rules[c] : NULL;
+        e.length[c] = rule == NULL ? 1 : strlen(rule);
+    }
+    size_t n = strlen(ls->axiom);
+    char *str = malloc(n + 1);
+    if (str == NULL) {
+        return NULL;
+    }
+    memcpy(str, ls->axiom, n);
+    for (int iter = 0; iter < depth; iter++) {
+        e.src = (const unsigned char *)str;
+        e.n = n;
+        e.chunks = chunk_count(n, threads);
+        run_chunks(e.chunks, expand_measure, &e);
+        size_t total = 0;
+        for (int i = 0; i < e.chunks; i++) {
+            size_t size = e.offset[i];
+            e.offset[i] = total;
+            total += size;
+        }
+        if (total > MAX_SYMBOLS) {
+            free(str);
+            return NULL;
+        }
+        e.dst = malloc(total + 1);
+        if (e.dst == NULL) {
+            free(str);
+            return NULL;
+        }
+        run_chunks(e.chunks, expand_write, &e);
+        free(str);
+        str = e.dst;
+        n = total;
+    }
+    str[n] = '\0';
+    *len = n;
+    return str;
+}
+
+// =============================================================================
+// Vertices
+// =============================================================================
+
+struct turtle_chunk {
+    // Summary, relative to the start of the chunk: the net number of turns,
+    // number of vertices, and displacement, as if starting with heading 0.
+    int turns;
+    size_t vertices;
+    double dx, dy;
+    // State at the start of the chunk.
+    int heading;
+    double x, y;
+    size_t first;
+    // Bounds of the vertices in the chunk.
+    float x0, y0, x1, y1;
+};
+
+// State for generating vertices. Each chunk is first summarized, then the
+// summaries are scanned to find the starting state for each chunk, so all
+// chunks can be drawn in parallel.
+struct turtle {
+    const unsigned char *src;
+    size_t n;
+    int chunks;
+    int divisions;
+    bool draw[256];
+    double dir_x[LSYSTEM_MAX_DIVISIONS];
+    double dir_y[LSYSTEM_MAX_DIVISIONS];
+    struct turtle_chunk chunk[MAX_THREADS];
+    float *x, *y;
+    // Transformation to normalize the curve.
+    struct mat4 transform;
+    size_t count;
+};
+
+static void turtle_measure(void *arg, int chunk) {
+    struct turtle *t = arg;
+    struct turtle_chunk *c = &t->chunk[chunk];
+    size_t end = chunk_start(t->n, t->chunks, chunk + 1);
+    int h = 0, div = t->divisions;
+    size_t vertices = 0;
+    double dx = 0.0, dy = 0.0;
+    for (size_t i = chunk_start(t->n, t->chunks, chunk); i < end; i++) {
+        unsigned s = t->src[i];
+        if (t->draw[s]) {
+            dx += t->dir_x[h];
+            dy += t->dir_y[h];
+            vertices++;
+        } else if (s == '+') {
+            h = h == div - 1 ? 0 : h + 1;
+        } else if (s == '-') {
+            h = h == 0 ? div - 1 : h - 1;
+        }
+    }
+    c->turns = h;
+    c->vertices = vertices;
+    c->dx = dx;
+    c->dy = dy;
+}
+
+static void turtle_draw(void *arg, int chunk) {
+    struct turtle *t = arg;
+    struct turtle_chunk *c = &t->chunk[chunk];
+    size_t end = chunk_start(t->n, t->chunks, chunk + 1);
+    int h = c->heading, div = t->divisions;
+    double x = c->x, y = c->y;
+    float *restrict px = t->x, *restrict py = t->y;
+    size_t v = c->first;
+    float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+    if (chunk == 0) {
+        px[0] = 0.0f;
+        py[0] = 0.0f;
+        x0 = x1 = y0 = y1 = 0.0f;
+    }
+    for (size_t i = chunk_start(t->n, t->chunks, chunk); i < end; i++) {
+        unsigned s = t->src[i];
+        if (t->draw[s]) {
+            x += t->dir_x[h];
+            y += t->dir_y[h];
+            float fx = (float)x, fy = (float)y;
+            px[v] = fx;
+            py[v] = fy;
+            v++;
+            x0 = fminf(x0, fx);
+            x1 = fmaxf(x1, fx);
+            y0 = fminf(y0, fy);
+            y1 = fmaxf(y1, fy);
+        } else if (s == '+') {
+            h = h == div - 1 ? 0 : h + 1;
+        } else if (s == '-') {
+            h = h == 0 ? div - 1 : h - 1;
+        }
+    }
+    c->x0 = x0;
+    c->y0 = y0;
+    c->x1 = x1;
+    c->y1 = y1;
+}
+
+static void turtle_normalize(void *arg, int chunk) {
+    struct turtle *t = arg;
+    size_t start = chunk_start(t->count, t->chunks, chunk);
+    size_t end = chunk_start(t->count, t->chunks, chunk + 1);
+    vecmath_transform2(&t->transform, t->x + start, t->y + start, t->x + start,
+                       t->y + start, (int)(end - start));
+}
+
+static int default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) {
+        return 1;
+    }
+    return n < MAX_THREADS ? (int)n : MAX_THREADS;
+}
+
+bool lsystem_generate(const struct lsystem *ls, int depth, int threads,
+                      struct lsystem_curve *curve) {
+    if (threads <= 0) {
+        threads = default_threads();
+    } else if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+    size_t n;
+    char *str = expand(ls, depth, threads, &n);
+    if (str == NULL) {
+        return false;
+    }
+
+    struct turtle t = {
+        .src = (const unsigned char *)str,
+        .n = n,
+        .chunks = chunk_count(n, threads),
+        .divisions = ls->divisions,
+    };
+    for (const char *p = ls->draw; *p != '\0'; p++) {
+        t.draw[(unsigned char)*p] = true;
+    }
+    for (int i = 0; i < ls->divisions; i++) {
+        double a = 2.0 * M_PI * i / ls->divisions;
+        t.dir_x[i] = cos(a);
+        t.dir_y[i] = sin(a);
+    }
+    run_chunks(t.chunks, turtle_measure, &t);
+
+    // Scan the summaries to find where each chunk starts. A chunk's
+    // displacement is rotated by the heading it starts with.
+    int heading = 0;
+    double x = 0.0, y = 0.0;
+    size_t count = 1;
+    for (int i = 0; i < t.chunks; i++) {
+        struct turtle_chunk *c = &t.chunk[i];
+        c->heading = heading;
+        c->x = x;
+        c->y = y;
+        c->first = count;
+        double cs = t.dir_x[heading], sn = t.dir_y[heading];
+        x += c->dx * cs - c->dy * sn;
+        y += c->dx * sn + c->dy * cs;
+        heading = (heading + c->turns) % ls->divisions;
+        count += c->vertices;
+    }
+    if (count > MAX_VERTICES) {
+        free(str);
+        return false;
+    }
+    t.x = malloc(sizeof(float) * count);
+    t.y = malloc(sizeof(float) * count);
+    if (t.x == NULL || t.y == NULL) {
+        free(t.x);
+        free(t.y);
+        free(str);
+        return false;
+    }
+    run_chunks(t.chunks, turtle_draw, &t);
+    free(str);
+
+    float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+    for (int i = 0; i < t.chunks; i++) {
+        const struct turtle_chunk *c = &t.chunk[i];
+        x0 = fminf(x0, c->x0);
+        y0 = fminf(y0, c->y0);
+        x1 = fmaxf(x1, c->x1);
+        y1 = fmaxf(y1, c->y1);
+    }
+    float size = fmaxf(x1 - x0, y1 - y0);
+    float scale = size > 0.0f ? 2.0f / size : 1.0f;
+    // Scale, and then move the center of the bounds to the origin.
+    struct mat4 scaling = mat4_scale(vec3_make(scale, scale, 1.0f));
+    struct mat4 translation = mat4_translate(vec3_make(
+        -0.5f * (x0 + x1) * scale, -0.5f * (y0 + y1) * scale, 0.0f));
+    t.transform = mat4_mul(&translation, &scaling);
+    t.count = count;
+    t.chunks = chunk_count(count, threads);
+    run_chunks(t.chunks, turtle_normalize, &t);
+
+    *curve = (struct lsystem_curve){
+        .count = (int)count,
+        .x = t.x,
+        .y = t.y,
+    };
+    return true;
+}
+
+void lsystem_curve_destroy(struct lsystem_curve *curve) {
+    free(curve->x);
+    free(curve->y);
+    *curve = (struct lsystem_curve){0};
+}
@@ -0,0 +1,58 @@
+// lsystem.h - L-system curve generator.
+#pragma once
+
+#include <stdbool.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// An L-system which describes a curve, drawn with turtle graphics. Each
+// iteration replaces every symbol with its rule, or leaves it unchanged if it
+// has no rule. The result is interpreted as:
+//
+// - Symbols in draw: Move forward one unit, adding a vertex.
+// - '+': Turn left by one division.
+// - '-': Turn right by one division.
+// - Anything else: Ignored.
+//
+// Branching is not supported, since the curve is drawn as one line strip.
+struct lsystem {
+    const char *name;
+    const char *axiom;
+    // Replacement for each symbol, or NULL to leave it unchanged.
+    const char *rules[128];
+    // Symbols which draw a line.
+    const char *draw;
+    // Number of turns in a full circle, at most LSYSTEM_MAX_DIVISIONS.
+    int divisions;
+};
+
+#define LSYSTEM_MAX_DIVISIONS 12
+
+extern const struct lsystem LSYSTEM_DRAGON;
+extern const struct lsystem LSYSTEM_HILBERT;
+extern const struct lsystem LSYSTEM_KOCH;
+extern const struct lsystem LSYSTEM_GOSPER;
+extern const struct lsystem LSYSTEM_SIERPINSKI;
+extern const struct lsystem LSYSTEM_LEVY;
+
+// Vertices of a curve, in order, in structure of arrays layout. The curve is
+// centered on the origin and scaled to fit in the square from -1 to +1.
+struct lsystem_curve {
+    int count;
+    float *x;
+    float *y;
+};
+
+// Expand an L-system to the given depth and generate the vertices of its curve.
+// Work is split across the given number of threads, or across all processors if
+// threads is 0. Returns false if out of memory or if the curve is too large.
+bool lsystem_generate(const struct lsystem *ls, int depth, int threads,
+                      struct lsystem_curve *curve);
+
+void lsystem_curve_destroy(struct lsystem_curve *curve);
+
+#if defined __cplusplus
+}
+#endif
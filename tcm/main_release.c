@@ -1,15 +1,21 @@
 // To avoid conflict when we define these twice.
 #define GLFW_INCLUDE_NONE
 
+#include "tcm/audio.h"
+#include "tcm/clock.h"
 #include "tcm/demo.h"
 #include "tcm/gl.h"
-#include "tcm/packed_shaders.h"
-#include "tcm/shaders.h"
+#include "tcm/glstate.h"
+#include "tcm/load_shaders.h"
+#include "tcm/stream.h"
 
 #include <GLFW/glfw3.h>
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 static void die(const char *msg) __attribute__((noreturn));
 
@@ -18,78 +24,66 @@ static void die(const char *msg) {
     exit(1);
 }
 
-// Load a single shader, and return the shader object.
-static GLuint load_shader(GLenum type, const char *source, size_t sourcelen) {
-    GLuint shader = glCreateShader(type);
-    if (shader == 0) {
-        die("Could not create shader");
-    }
-    glShaderSource(shader, 1, (const char *[]){source},
-                   (const GLint[]){sourcelen});
-    glCompileShader(shader);
-    GLint status;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        fputs("Error: Could not compile shader.\n", stderr);
-    }
-    GLint loglen;
-    // loglen includes nul terminator.
-    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &loglen);
-    if (loglen > 1) {
-        char *log = malloc(loglen);
-        if (log == NULL) {
-            die("No memory");
-        }
-        glGetShaderInfoLog(shader, loglen, NULL, log);
-        log[loglen - 1] = '\0';
-        fputs("-- Shader compilation log --\n", stderr);
-        fputs(log, stderr);
-        free(log);
-    }
-    if (!status) {
-        die("Shader compilation failed.");
-    }
-    return shader;
+// Return the time from a monotonic clock, in seconds.
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
 }
 
-// Link an OpenGL shader program.
-static GLuint link_program(const GLuint *restrict shaders) {
-    GLuint prog = glCreateProgram();
-    if (prog == 0) {
-        die("Could not create program");
-    }
-    for (int i = 0; shaders[i] != 0; i++) {
-        glAttachShader(prog, shaders[i]);
-    }
-    glLinkProgram(prog);
-    GLint status;
-    glGetProgramiv(prog, GL_LINK_STATUS, &status);
-    if (!status) {
-        fputs("Error: Could not link program.\n", stderr);
-    }
-    GLint loglen;
-    // loglen includes nul terminator.
-    glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &loglen);
-    if (loglen > 1) {
-        char *log = malloc(loglen);
-        if (log == NULL) {
-            die("No memory");
+// Frame rate for the timeline.
+#define TIMELINE_RATE 60
+
+// Draw every frame of the demo as fast as possible, with a fixed time step, and
+// report how long it took. Used for collecting profiles and for comparing
+// builds. Frames are finished before measuring, so the times include GPU work.
+static void run_timeline(GLFWwindow *window, double start) {
+    const int frames = (int)(DEMO_LENGTH * TIMELINE_RATE);
+    double startup = 0.0, total = 0.0, worst = 0.0;
+    for (int frame = 0; frame < frames; frame++) {
+        double t0 = now();
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        demo_draw((double)frame / TIMELINE_RATE, width, height);
+        glstate_end_frame();
+        stream_end_frame();
+        glfwSwapBuffers(window);
+        glFinish();
+        glfwPollEvents();
+        double t1 = now();
+        if (frame == 0) {
+            startup = t1 - start;
+        } else {
+            double dt = t1 - t0;
+            total += dt;
+            if (dt > worst) {
+                worst = dt;
+            }
         }
-        glGetProgramInfoLog(prog, loglen, NULL, log);
-        log[loglen - 1] = '\0';
-        fputs("-- Shader linking log --\n", stderr);
-        fputs(log, stderr);
-        free(log);
-    }
-    if (!status) {
-        die("Shader linking failed.");
     }
-    return prog;
+    printf("timeline: startup: %.2f ms\n", startup * 1e3);
+    printf("timeline: mean frame time: %.3f ms\n",
+           frames > 1 ? total * 1e3 / (frames - 1) : 0.0);
+    printf("timeline: worst frame time: %.3f ms\n", worst * 1e3);
+    fflush(stdout);
 }
 
 int main(int argc, char **argv) {
-    (void)argc;
-    (void)argv;
+    double start = now();
+    enum audio_sink sink = AUDIO_SINK_DEVICE;
+    bool timeline = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--null-audio") == 0) {
+            sink = AUDIO_SINK_NULL;
+        } else if (strcmp(argv[i], "--timeline") == 0) {
+            // The soundtrack is still synthesized, so it is measured too.
+            sink = AUDIO_SINK_NULL;
+            timeline = true;
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
 
     if (!glfwInit()) {
         die("Could not initialize GLFW");
@@ -114,6 +108,9 @@ int main(int argc, char **argv) {
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    if (timeline) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
 
     GLFWwindow *window = glfwCreateWindow(
         640, 360, "Terrestrial Collection Machine", NULL, NULL);
@@ -123,6 +120,10 @@ int main(int argc, char **argv) {
     }
 
     glfwMakeContextCurrent(window);
+    if (timeline) {
+        // Don't wait for vertical sync.
+        glfwSwapInterval(0);
+    }
     fprintf(stderr, "GL_VERSION: %s\n", glGetString(GL_VERSION));
     fprintf(stderr, "GL_VENDOR: %s\n", glGetString(GL_VENDOR));
     fprintf(stderr, "GL_RENDERER: %s\n", glGetString(GL_RENDERER));
@@ -130,28 +131,30 @@ int main(int argc, char **argv) {
     glewInit();
 #endif
 
-    shader_triangle = link_program((const GLuint[]){
-        load_shader(GL_VERTEX_SHADER, TRIANGLE_VERT, sizeof(TRIANGLE_VERT)),
-        load_shader(GL_FRAGMENT_SHADER, TRIANGLE_FRAG, sizeof(TRIANGLE_FRAG)),
-        0,
-    });
-    shader_line = link_program((const GLuint[]){
-        load_shader(GL_VERTEX_SHADER, LINE_VERT, sizeof(LINE_VERT)),
-        load_shader(GL_GEOMETRY_SHADER, LINE_GEOM, sizeof(LINE_GEOM)),
-        load_shader(GL_FRAGMENT_SHADER, LINE_FRAG, sizeof(LINE_FRAG)),
-        0,
-    });
+    load_shaders();
     demo_init();
-
-    while (!glfwWindowShouldClose(window)) {
-        double time = glfwGetTime();
-
-        demo_draw(time);
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    audio_init(sink);
+
+    if (timeline) {
+        run_timeline(window, start);
+    } else {
+        struct demo_clock clock;
+        demo_clock_init(&clock, glfwGetTime());
+        while (!glfwWindowShouldClose(window)) {
+            double time = demo_clock_update(&clock, glfwGetTime());
+
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            demo_draw(time, width, height);
+            glstate_end_frame();
+            stream_end_frame();
+
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
     }
 
+    audio_term();
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
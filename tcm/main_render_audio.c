@@ -0,0 +1,71 @@
+// Render the soundtrack offline to a WAV file, without an audio device.
+#include "tcm/music.h"
+#include "tcm/synth.h"
+#include "tcm/wav.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static void die(const char *msg) __attribute__((noreturn));
+
+static void die(const char *msg) {
+    fprintf(stderr, "Error: %s\n", msg);
+    exit(1);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    double seconds = 32.0;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:")) != -1) {
+        switch (opt) {
+        case 't':
+            seconds = strtod(optarg, NULL);
+            if (!(seconds > 0.0)) {
+                die("Invalid duration");
+            }
+            break;
+        default:
+            fputs("Usage: render_audio [-t <seconds>] <out.wav>\n", stderr);
+            return 2;
+        }
+    }
+    if (optind + 1 != argc) {
+        fputs("Usage: render_audio [-t <seconds>] <out.wav>\n", stderr);
+        return 2;
+    }
+    const char *path = argv[optind];
+
+    long nframes = (long)(seconds * SYNTH_RATE);
+    float *samples = malloc(sizeof(float) * 2 * nframes);
+    struct synth *synth = synth_new();
+    if (samples == NULL || synth == NULL) {
+        die("No memory");
+    }
+    struct music music;
+    music_init(&music);
+
+    double t0 = now();
+    music_render(&music, synth, samples, nframes);
+    double elapsed = now() - t0;
+    fprintf(stderr, "Rendered %.1f s of audio in %.3f s (%.1fx realtime)\n",
+            seconds, elapsed, seconds / elapsed);
+
+    if (!wav_write(path, samples, nframes, 2, SYNTH_RATE)) {
+        fprintf(stderr, "Error: Could not write %s: %s\n", path,
+                strerror(errno));
+        return 1;
+    }
+    synth_free(synth);
+    free(samples);
+    return 0;
+}
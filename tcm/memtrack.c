@@ -0,0 +1,118 @@
+// memtrack.c - Resource memory accounting.
+#include "tcm/memtrack.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    // Maximum tag length, including nul terminator.
+    TAG_SIZE = 32,
+};
+
+struct resource {
+    enum memtrack_kind kind;
+    uintptr_t id;
+    size_t size;
+    char tag[TAG_SIZE];
+};
+
+// There are few enough resources that a linear search is fine.
+static struct {
+    pthread_mutex_t mutex;
+    struct resource *items;
+    size_t count;
+    size_t capacity;
+} reg = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static const char KIND_NAMES[MEMTRACK_KIND_COUNT][8] = {
+    [MEMTRACK_BUFFER] = "buffer",
+    [MEMTRACK_TEXTURE] = "texture",
+    [MEMTRACK_PROGRAM] = "program",
+    [MEMTRACK_HOST] = "host",
+};
+
+static struct resource *find(enum memtrack_kind kind, uintptr_t id) {
+    for (size_t i = 0; i < reg.count; i++) {
+        if (reg.items[i].kind == kind && reg.items[i].id == id) {
+            return &reg.items[i];
+        }
+    }
+    return NULL;
+}
+
+void memtrack_add(enum memtrack_kind kind, uintptr_t id, const char *tag) {
+    pthread_mutex_lock(&reg.mutex);
+    struct resource *r = find(kind, id);
+    if (r == NULL) {
+        if (reg.count >= reg.capacity) {
+            size_t n = reg.capacity != 0 ? reg.capacity * 2 : 64;
+            struct resource *items = realloc(reg.items, sizeof(*items) * n);
+            if (items == NULL) {
+                // Accounting is best-effort.
+                pthread_mutex_unlock(&reg.mutex);
+                return;
+            }
+            reg.items = items;
+            reg.capacity = n;
+        }
+        r = &reg.items[reg.count++];
+    }
+    r->kind = kind;
+    r->id = id;
+    r->size = 0;
+    snprintf(r->tag, sizeof(r->tag), "%s", tag);
+    pthread_mutex_unlock(&reg.mutex);
+}
+
+void memtrack_set_size(enum memtrack_kind kind, uintptr_t id, size_t size) {
+    pthread_mutex_lock(&reg.mutex);
+    struct resource *r = find(kind, id);
+    if (r != NULL) {
+        r->size = size;
+    }
+    pthread_mutex_unlock(&reg.mutex);
+}
+
+void memtrack_remove(enum memtrack_kind kind, uintptr_t id) {
+    pthread_mutex_lock(&reg.mutex);
+    struct resource *r = find(kind, id);
+    if (r != NULL) {
+        *r = reg.items[--reg.count];
+    }
+    pthread_mutex_unlock(&reg.mutex);
+}
+
+struct memtrack_totals memtrack_get_totals(void) {
+    struct memtrack_totals t = {0};
+    pthread_mutex_lock(&reg.mutex);
+    for (size_t i = 0; i < reg.count; i++) {
+        const struct resource *r = &reg.items[i];
+        t.count[r->kind]++;
+        t.bytes[r->kind] += r->size;
+    }
+    pthread_mutex_unlock(&reg.mutex);
+    return t;
+}
+
+const char *memtrack_kind_name(enum memtrack_kind kind) {
+    return KIND_NAMES[kind];
+}
+
+size_t memtrack_report(FILE *fp) {
+    pthread_mutex_lock(&reg.mutex);
+    size_t count = reg.count;
+    if (count > 0) {
+        fprintf(fp, "Resources not released: %zu\n", count);
+        for (size_t i = 0; i < count; i++) {
+            const struct resource *r = &reg.items[i];
+            // Object names in decimal, addresses in hex.
+            fprintf(fp,
+                    r->kind == MEMTRACK_HOST ? "  %s %#jx (%s): %zu bytes\n"
+                                             : "  %s %ju (%s): %zu bytes\n",
+                    KIND_NAMES[r->kind], (uintmax_t)r->id, r->tag, r->size);
+        }
+    }
+    pthread_mutex_unlock(&reg.mutex);
+    return count;
+}
@@ -0,0 +1,52 @@
+// memtrack.h - Resource memory accounting.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// Kinds of tracked resources.
+enum memtrack_kind {
+    MEMTRACK_BUFFER,
+    MEMTRACK_TEXTURE,
+    MEMTRACK_PROGRAM,
+    // Memory allocated on the CPU.
+    MEMTRACK_HOST,
+    MEMTRACK_KIND_COUNT,
+};
+
+// Totals for all live resources of each kind.
+struct memtrack_totals {
+    unsigned count[MEMTRACK_KIND_COUNT];
+    size_t bytes[MEMTRACK_KIND_COUNT];
+};
+
+// Record a new resource. The id is the OpenGL object name, or the address of
+// host memory. The tag names the owner, and is copied. Safe to call from any
+// thread.
+void memtrack_add(enum memtrack_kind kind, uintptr_t id, const char *tag);
+
+// Set the number of bytes used by a resource.
+void memtrack_set_size(enum memtrack_kind kind, uintptr_t id, size_t size);
+
+// Forget a resource which has been released. Resources which were never
+// recorded are ignored.
+void memtrack_remove(enum memtrack_kind kind, uintptr_t id);
+
+// Get the totals for all live resources.
+struct memtrack_totals memtrack_get_totals(void);
+
+// Get the name of a kind of resource.
+const char *memtrack_kind_name(enum memtrack_kind kind);
+
+// Print all live resources, and return the number of resources. Call at exit,
+// after releasing everything, to find leaks.
+size_t memtrack_report(FILE *fp);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,109 @@
+// music.c - Demo soundtrack sequencer.
+#include "tcm/music.h"
+
+#include "tcm/synth.h"
+
+enum {
+    // Tempo in beats per minute.
+    TEMPO = 120,
+    // Length of one sixteenth note step, in samples.
+    STEP = SYNTH_RATE * 60 / (TEMPO * 4),
+    // Steps per bar.
+    BAR = 16,
+    // Number of bars before the song repeats.
+    NBARS = 4,
+};
+
+static const struct synth_instrument BASS = {
+    .saw = 0.8f,
+    .square = 0.3f,
+    .attack = 0.002f,
+    .decay = 0.15f,
+    .sustain = 0.4f,
+    .release = 0.05f,
+    .cutoff = 180.0f,
+    .env_cutoff = 6.0f,
+    .resonance = 0.6f,
+};
+
+static const struct synth_instrument ARP = {
+    .square = 0.5f,
+    .attack = 0.005f,
+    .decay = 0.1f,
+    .sustain = 0.2f,
+    .release = 0.08f,
+    .cutoff = 900.0f,
+    .env_cutoff = 3.0f,
+    .resonance = 0.3f,
+};
+
+static const struct synth_instrument HAT = {
+    .noise = 0.4f,
+    .attack = 0.0f,
+    .decay = 0.02f,
+    .sustain = 0.0f,
+    .release = 0.01f,
+    .cutoff = 7000.0f,
+    .resonance = 0.1f,
+};
+
+// Chord roots and chord tones for each bar, as MIDI notes: Am F C G.
+static const signed char CHORDS[NBARS][4] = {
+    {57, 60, 64, 69},
+    {53, 57, 60, 65},
+    {48, 55, 60, 64},
+    {55, 59, 62, 67},
+};
+
+// Order in which the arpeggio plays chord tones.
+static const signed char ARP_ORDER[8] = {0, 1, 2, 3, 2, 1, 3, 1};
+
+// Trigger all notes which start on the given step.
+static void play_step(struct synth *s, long step) {
+    int bar = (step / BAR) % NBARS;
+    int beat = step % BAR;
+    const signed char *chord = CHORDS[bar];
+    if (beat % 2 == 0) {
+        synth_note_on(s, &(struct synth_note){
+                             .instrument = &BASS,
+                             .pitch = chord[0] - 24,
+                             .velocity = beat % 4 == 0 ? 1.0f : 0.7f,
+                             .duration = STEP * 3 / 2,
+                         });
+    } else {
+        synth_note_on(s, &(struct synth_note){
+                             .instrument = &HAT,
+                             .pitch = 60.0f,
+                             .velocity = 0.5f,
+                             .duration = STEP / 4,
+                         });
+    }
+    synth_note_on(s, &(struct synth_note){
+                         .instrument = &ARP,
+                         .pitch = chord[ARP_ORDER[beat % 8]] + 12,
+                         .velocity = 0.35f,
+                         .pan = beat % 2 == 0 ? -0.5f : 0.5f,
+                         .duration = STEP / 2,
+                     });
+}
+
+void music_init(struct music *m) {
+    m->pos = 0;
+}
+
+void music_render(struct music *m, struct synth *s, float *out, int nframes) {
+    while (nframes > 0) {
+        long offset = m->pos % STEP;
+        if (offset == 0) {
+            play_step(s, m->pos / STEP);
+        }
+        long n = STEP - offset;
+        if (n > nframes) {
+            n = nframes;
+        }
+        synth_render(s, out, n);
+        out += n * 2;
+        nframes -= n;
+        m->pos += n;
+    }
+}
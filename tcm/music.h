@@ -0,0 +1,25 @@
+// music.h - Demo soundtrack sequencer.
+#pragma once
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct synth;
+
+// Sequencer state.
+struct music {
+    // Position in samples since the start of the song.
+    long pos;
+};
+
+// Start the music from the beginning.
+void music_init(struct music *m);
+
+// Render the soundtrack as interleaved stereo, triggering notes on the
+// synthesizer at the correct sample positions.
+void music_render(struct music *m, struct synth *s, float *out, int nframes);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,208 @@
+"""Compress an executable into a C file, for the self-decompressing stub.
+
+Usage: pack_exe --out-c=<file.c> <executable>
+       pack_exe --report=<file.txt> <executable>
+
+The executable is compressed with an LZ77 format which is simple and fast to
+decode: a sequence of blocks, each with a token byte, literals, and a match.
+The high four bits of the token are the number of literals, and the low four
+bits are the match length, minus 4. If either is 15, more length bytes follow,
+each added to the length, until a byte which is not 255. The literals follow,
+and then the match offset, as a 16-bit little-endian number. The last block may
+end after its literals. This is the same as the LZ4 block format.
+
+The output C file defines:
+
+    const unsigned long PACKED_SIZE;
+    const unsigned char PACKED_DATA[N];
+    const size_t PACKED_DATA_SIZE;
+
+PACKED_SIZE is the size of the decompressed executable, and PACKED_DATA_SIZE is
+the size of the compressed data.
+
+The report lists the size of each ELF section, uncompressed and compressed on
+its own, which shows where the bytes go.
+"""
+import argparse
+import struct
+import sys
+
+HEADER = '// This file is automatically generated.\n'
+
+MIN_MATCH = 4
+MAX_OFFSET = 0xffff
+HASH_BITS = 16
+# Maximum number of earlier positions checked for each match.
+MAX_CHAIN = 64
+
+def write_length(out, n):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+def emit(out, data, lit_start, lit_end, offset, match):
+    nlit = lit_end - lit_start
+    token = min(nlit, 15) << 4
+    if match:
+        token |= min(match - MIN_MATCH, 15)
+    out.append(token)
+    if nlit >= 15:
+        write_length(out, nlit - 15)
+    out += data[lit_start:lit_end]
+    if match:
+        out += struct.pack('<H', offset)
+        if match - MIN_MATCH >= 15:
+            write_length(out, match - MIN_MATCH - 15)
+
+def compress(data):
+    """Compress data, with greedy matching on hash chains."""
+    n = len(data)
+    mask = (1 << HASH_BITS) - 1
+    head = [-1] * (1 << HASH_BITS)
+    prev = [-1] * n
+    out = bytearray()
+
+    def hash_at(i):
+        v = data[i] | data[i+1] << 8 | data[i+2] << 16 | data[i+3] << 24
+        return ((v * 2654435761) & 0xffffffff) >> (32 - HASH_BITS)
+
+    def insert(i):
+        h = hash_at(i)
+        prev[i] = head[h]
+        head[h] = i
+
+    lit = 0
+    i = 0
+    while i + MIN_MATCH <= n:
+        best_len = 0
+        best_pos = 0
+        cand = head[hash_at(i)]
+        chain = MAX_CHAIN
+        while cand >= 0 and i - cand <= MAX_OFFSET and chain > 0:
+            if data[cand + best_len:cand + best_len + 1] == \
+               data[i + best_len:i + best_len + 1]:
+                length = 0
+                limit = n - i
+                while length < limit and data[cand + length] == data[i + length]:
+                    length += 1
+                if length > best_len:
+                    best_len = length
+                    best_pos = cand
+                    if length == limit:
+                        break
+            cand = prev[cand]
+            chain -= 1
+        if best_len >= MIN_MATCH:
+            emit(out, data, lit, i, i - best_pos, best_len)
+            end = i + best_len
+            while i < end:
+                if i + MIN_MATCH <= n:
+                    insert(i)
+                i += 1
+            lit = i
+        else:
+            insert(i)
+            i += 1
+    if lit < n:
+        emit(out, data, lit, n, 0, 0)
+    return bytes(out)
+
+def decompress(data, size):
+    """Decompress data. Used to check the output."""
+    out = bytearray()
+    i = 0
+    def length(n):
+        nonlocal i
+        if n == 15:
+            while True:
+                b = data[i]
+                i += 1
+                n += b
+                if b != 255:
+                    break
+        return n
+    while i < len(data):
+        token = data[i]
+        i += 1
+        nlit = length(token >> 4)
+        out += data[i:i+nlit]
+        i += nlit
+        if i >= len(data):
+            break
+        offset, = struct.unpack_from('<H', data, i)
+        i += 2
+        match = length(token & 15) + MIN_MATCH
+        for _ in range(match):
+            out.append(out[-offset])
+    if len(out) != size:
+        raise ValueError('bad size')
+    return bytes(out)
+
+def elf_sections(data):
+    """Return a list of (name, size) for each section in a 64-bit ELF file."""
+    if data[:4] != b'\x7fELF' or data[4] != 2 or data[5] != 1:
+        return []
+    shoff, = struct.unpack_from('<Q', data, 0x28)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x3a)
+    headers = []
+    for i in range(shnum):
+        name, stype, _, _, offset, size = struct.unpack_from(
+            '<IIQQQQ', data, shoff + i * shentsize)
+        headers.append((name, stype, offset, size))
+    strtab = headers[shstrndx]
+    sections = []
+    for name, stype, offset, size in headers:
+        # SHT_NULL and SHT_NOBITS have no contents in the file.
+        if stype == 0 or stype == 8:
+            continue
+        start = strtab[2] + name
+        end = data.index(b'\0', start)
+        sections.append((data[start:end].decode('ASCII'),
+                         data[offset:offset+size]))
+    return sections
+
+def write_c(fp, data, packed):
+    fp.write(HEADER)
+    fp.write('#include <stddef.h>\n')
+    fp.write('const unsigned long PACKED_SIZE = {};\n'.format(len(data)))
+    fp.write('const unsigned char PACKED_DATA[{}] = {{\n'.format(len(packed)))
+    for i in range(0, len(packed), 16):
+        fp.write(''.join('{},'.format(b) for b in packed[i:i+16]))
+        fp.write('\n')
+    fp.write('};\n')
+    fp.write('const size_t PACKED_DATA_SIZE = {};\n'.format(len(packed)))
+
+def write_report(fp, data, packed):
+    fp.write('{:<24} {:>10} {:>10}\n'.format('Section', 'Size', 'Packed'))
+    total = 0
+    for name, contents in elf_sections(data):
+        total += len(contents)
+        fp.write('{:<24} {:>10} {:>10}\n'.format(
+            name, len(contents), len(compress(contents))))
+    fp.write('{:<24} {:>10}\n'.format('(headers and padding)',
+                                     len(data) - total))
+    fp.write('{:<24} {:>10} {:>10}\n'.format('Total', len(data), len(packed)))
+
+def main():
+    p = argparse.ArgumentParser('pack_exe')
+    p.add_argument('--out-c', help='Output C file')
+    p.add_argument('--report', help='Output size report')
+    p.add_argument('executable', help='Input executable')
+    args = p.parse_args()
+
+    with open(args.executable, 'rb') as fp:
+        data = fp.read()
+    packed = compress(data)
+    if decompress(packed, len(data)) != data:
+        print('Error: compression failed', file=sys.stderr)
+        sys.exit(1)
+    if args.out_c:
+        with open(args.out_c, 'w') as fp:
+            write_c(fp, data, packed)
+    if args.report:
+        with open(args.report, 'w') as fp:
+            write_report(fp, data, packed)
+
+if __name__ == '__main__':
+    main()
@@ -1,6 +1,7 @@
 """Pack GLSL shaders into C files for inclusion into a program.
 
-Usage: pack_shaders --out-c=<file.c> --out-h=<file.h> shader...
+Usage: pack_shaders --out-c=<file.c> --out-h=<file.h> [--variants=<file>]
+                    shader...
 
 Each shader file will be emitted as a const char array. The name of the array is
 generated from the name of the shader file, without the directory, and with
@@ -12,14 +13,30 @@ header file will declare an array:
     extern const char TRIANGLE_VERT[N];
 
 Here, N is the actual size of the shader text, so you can use sizeof().
+
+Shaders may include other files with '#include "name.glsl"', relative to the
+including file. Includes are expanded, and each file is included at most once.
+Files with the extension ".glsl" are only used for includes, and are not emitted.
+
+The variants file lists shader variants to compile when the program starts. Each
+line names a program, followed by a value for each knob, like:
+
+    line DEPTH=7..14
+
+A range is expanded into one variant for each value. These are emitted as an
+array, PACKED_VARIANTS, terminated by an entry with program SHADER_PROGRAM_COUNT.
 """
 import argparse
+import itertools
 import os
 import re
 import sys
 
 NON_ALPHANUM = re.compile('(?:[^A-Za-z0-9]+)+')
 NEEDS_ESCAPE = re.compile(rb'[^ -~]|[\\"]')
+INCLUDE = re.compile(rb'^[ \t]*#[ \t]*include[ \t]*"([^"]+)"', re.MULTILINE)
+IDENTIFIER = re.compile(r'[A-Za-z_][A-Za-z0-9_]*$')
+KNOB = re.compile(r'([A-Za-z_][A-Za-z0-9_]*)=(-?\d+)(?:\.\.(-?\d+))?$')
 
 ESCAPES = {
     b'\n': b'\\n',
@@ -33,11 +50,22 @@ def escape(m):
 
 HEADER = '// This file is automatically generated.\n'
 
+def read_source(path, seen):
+    """Read a shader source file, expanding includes."""
+    seen.add(os.path.normpath(path))
+    with open(path, 'rb') as fp:
+        text = fp.read()
+    def include(m):
+        inc = os.path.join(os.path.dirname(path), m.group(1).decode('ASCII'))
+        if os.path.normpath(inc) in seen:
+            return b''
+        return read_source(inc, seen).rstrip(b'\n')
+    return INCLUDE.sub(include, text)
+
 class Shader:
     def __init__(self, path):
         self.name = NON_ALPHANUM.sub('_', os.path.basename(path)).upper()
-        with open(path, 'rb') as fp:
-            self.text = fp.read()
+        self.text = read_source(path, set())
     def write_c(self, fp):
         fp.write('const char {}[{}] =\n"'.format(self.name, len(self.text)))
         fp.write(NEEDS_ESCAPE.sub(escape, self.text).decode('ASCII'))
@@ -46,23 +74,80 @@ class Shader:
         fp.write('extern const char {}[{}];\n'
                  .format(self.name, len(self.text)))
 
+VARIANT_TYPES = '''\
+#include "tcm/shaders.h"
+
+// A shader variant to compile when the program starts.
+struct packed_variant {
+    enum shader_program program;
+    struct shader_key key;
+};
+'''
+
+def read_variants(path):
+    """Read a variants file, and return a list of (program, [(knob, value)])."""
+    variants = []
+    with open(path) as fp:
+        for lineno, line in enumerate(fp, 1):
+            fields = line.split('#', 1)[0].split()
+            if not fields:
+                continue
+            def error(msg):
+                print('{}:{}: {}'.format(path, lineno, msg), file=sys.stderr)
+                sys.exit(1)
+            program = fields[0]
+            if not IDENTIFIER.match(program):
+                error('invalid program name: {!r}'.format(program))
+            knobs = []
+            for field in fields[1:]:
+                m = KNOB.match(field)
+                if not m:
+                    error('invalid knob: {!r}'.format(field))
+                first = int(m.group(2))
+                last = int(m.group(3)) if m.group(3) is not None else first
+                if last < first:
+                    error('empty range: {!r}'.format(field))
+                knobs.append([(m.group(1), value)
+                              for value in range(first, last + 1)])
+            for values in itertools.product(*knobs):
+                variants.append((program, list(values)))
+    return variants
+
+def write_variants_c(fp, variants):
+    fp.write('const struct packed_variant PACKED_VARIANTS[{}] = {{\n'
+             .format(len(variants) + 1))
+    for program, values in variants:
+        knobs = ''.join(', .key.knob[SHADER_KNOB_{}] = {}'
+                        .format(knob.upper(), value)
+                        for knob, value in values)
+        fp.write('    {{.program = SHADER_PROGRAM_{}{}}},\n'
+                 .format(program.upper(), knobs))
+    fp.write('    {.program = SHADER_PROGRAM_COUNT},\n};\n')
+
 def main():
     p = argparse.ArgumentParser('pack_shaders')
     p.add_argument('--out-c', help='Output C file', required=True)
     p.add_argument('--out-h', help='Output H file', required=True)
+    p.add_argument('--variants', help='Shader variants to compile at startup')
     p.add_argument('shader', help='Input shader files', nargs='+')
     args = p.parse_args()
 
-    shaders = [Shader(path) for path in sorted(args.shader)]
+    shaders = [Shader(path) for path in sorted(args.shader)
+               if not path.endswith('.glsl')]
+    variants = read_variants(args.variants) if args.variants else []
     with open(args.out_c, 'w') as fp:
         fp.write(HEADER)
         fp.write('#include "tcm/packed_shaders.h"\n')
         for shader in shaders:
             shader.write_c(fp)
+        write_variants_c(fp, variants)
     with open(args.out_h, 'w') as fp:
         fp.write(HEADER)
+        fp.write(VARIANT_TYPES)
         for shader in shaders:
             shader.write_h(fp)
+        fp.write('extern const struct packed_variant PACKED_VARIANTS[{}];\n'
+                 .format(len(variants) + 1))
 
 if __name__ == '__main__':
     main()
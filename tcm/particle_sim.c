@@ -0,0 +1,146 @@
+// particle_sim.c - Particle simulation.
+#include "tcm/particle_sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Particles are processed four at a time, with GCC vector extensions, as in
+// synth.c.
+typedef float v4sf __attribute__((vector_size(16)));
+typedef int32_t v4si __attribute__((vector_size(16)));
+typedef uint32_t v4su __attribute__((vector_size(16)));
+
+static inline v4sf splat(float x) {
+    return (v4sf){x, x, x, x};
+}
+
+// Return a where mask is set, and b elsewhere.
+static inline v4sf select4(v4si mask, v4sf a, v4sf b) {
+    return (v4sf)(((v4si)a & mask) | ((v4si)b & ~mask));
+}
+
+// Integer hash, from https://nullprogram.com/blog/2018/07/31/. Matches hash()
+// in particle_update.vert.
+static inline v4su hash4(v4su x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static uint32_t hash1(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Convert the high 23 bits of a hash to a float in the range 0-1, by using
+// them as the mantissa of a float in the range 1-2.
+static inline v4sf unorm4(v4su x) {
+    return (v4sf)((x >> 9) | 0x3f800000u) - 1.0f;
+}
+
+void particle_initial(struct particle *p, int i, int count) {
+    *p = (struct particle){
+        .y = PARTICLE_EMIT_Y,
+        // Emitted on the first step.
+        .age = PARTICLE_LIFE * (1.0f - (float)i / (float)count),
+        .seed = hash1((uint32_t)i),
+    };
+}
+
+bool particle_sim_init(struct particle_sim *s, int count) {
+    // Round up, so the arrays can be processed four at a time.
+    int n = (count + 3) & ~3;
+    size_t size = sizeof(float) * n;
+    float *data;
+    if (posix_memalign((void **)&data, 16, size * 6) != 0) {
+        return false;
+    }
+    *s = (struct particle_sim){
+        .count = count,
+        .x = data,
+        .y = data + n,
+        .vx = data + n * 2,
+        .vy = data + n * 3,
+        .age = data + n * 4,
+        .seed = (uint32_t *)(data + n * 5),
+    };
+    for (int i = 0; i < n; i++) {
+        struct particle p;
+        particle_initial(&p, i, count);
+        s->x[i] = p.x;
+        s->y[i] = p.y;
+        s->vx[i] = p.vx;
+        s->vy[i] = p.vy;
+        s->age[i] = p.age;
+        s->seed[i] = p.seed;
+    }
+    return true;
+}
+
+void particle_sim_destroy(struct particle_sim *s) {
+    free(s->x);
+    memset(s, 0, sizeof(*s));
+}
+
+void particle_sim_step(struct particle_sim *s, float dt) {
+    const v4sf vdt = splat(dt), life = splat(PARTICLE_LIFE);
+    v4sf *restrict px = (v4sf *)s->x, *restrict py = (v4sf *)s->y;
+    v4sf *restrict pvx = (v4sf *)s->vx, *restrict pvy = (v4sf *)s->vy;
+    v4sf *restrict page = (v4sf *)s->age;
+    v4su *restrict pseed = (v4su *)s->seed;
+    int n = (s->count + 3) / 4;
+    for (int i = 0; i < n; i++) {
+        v4sf x = px[i], y = py[i], vx = pvx[i], vy = pvy[i];
+        v4sf age = page[i] + vdt;
+        v4su seed = pseed[i];
+
+        // Emit particles which have reached the end of their life.
+        v4si expired = age >= life;
+        if (__builtin_expect(
+                (expired[0] | expired[1] | expired[2] | expired[3]) != 0, 0)) {
+            v4su new_seed = hash4(seed);
+            v4sf u1 = unorm4(new_seed);
+            v4sf u2 = unorm4(hash4(new_seed ^ 0x9e3779b9u));
+            age = select4(expired, age - life, age);
+            seed = (v4su)select4(expired, (v4sf)new_seed, (v4sf)seed);
+            x = select4(expired, splat(0.0f), x);
+            y = select4(expired, splat(PARTICLE_EMIT_Y), y);
+            vx = select4(expired, (u1 - 0.5f) * PARTICLE_SPREAD, vx);
+            vy = select4(expired,
+                         PARTICLE_SPEED_MIN +
+                             u2 * (PARTICLE_SPEED_MAX - PARTICLE_SPEED_MIN),
+                         vy);
+        }
+
+        vx += -y * (PARTICLE_SWIRL * dt);
+        vy += (x * PARTICLE_SWIRL - PARTICLE_GRAVITY) * dt;
+        x += vx * dt;
+        y += vy * dt;
+
+        px[i] = x;
+        py[i] = y;
+        pvx[i] = vx;
+        pvy[i] = vy;
+        page[i] = age;
+        pseed[i] = seed;
+    }
+}
+
+void particle_sim_get(const struct particle_sim *s, int i,
+                      struct particle *p) {
+    *p = (struct particle){
+        .x = s->x[i],
+        .y = s->y[i],
+        .vx = s->vx[i],
+        .vy = s->vy[i],
+        .age = s->age[i],
+        .seed = s->seed[i],
+    };
+}
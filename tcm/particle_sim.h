@@ -0,0 +1,66 @@
+// particle_sim.h - Particle simulation.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// Particles are emitted from a point, rise, swirl around the origin, and fall
+// under gravity. When a particle reaches the end of its life, it is emitted
+// again with a new random velocity. The same step is implemented on the GPU in
+// particle_update.vert, and on the CPU here. The two must match.
+
+// Particle lifetime, in seconds.
+#define PARTICLE_LIFE 4.0f
+// Downwards acceleration.
+#define PARTICLE_GRAVITY 0.3f
+// Strength of the swirl around the origin.
+#define PARTICLE_SWIRL 0.5f
+// Emission position.
+#define PARTICLE_EMIT_Y (-0.8f)
+// Range of horizontal emission velocities.
+#define PARTICLE_SPREAD 0.6f
+// Minimum and maximum vertical emission velocity.
+#define PARTICLE_SPEED_MIN 0.6f
+#define PARTICLE_SPEED_MAX 1.2f
+
+// A single particle, as stored in GPU buffers.
+struct particle {
+    float x, y;
+    float vx, vy;
+    float age;
+    uint32_t seed;
+};
+
+// Get the initial state of particle i. Ages are staggered so particles are
+// emitted continuously.
+void particle_initial(struct particle *p, int i, int count);
+
+// Particle state for simulation on the CPU, in structure of arrays layout.
+struct particle_sim {
+    int count;
+    float *x, *y;
+    float *vx, *vy;
+    float *age;
+    uint32_t *seed;
+};
+
+// Create a CPU simulation with the given number of particles. Returns false if
+// out of memory.
+bool particle_sim_init(struct particle_sim *s, int count);
+
+void particle_sim_destroy(struct particle_sim *s);
+
+// Advance the simulation by dt seconds.
+void particle_sim_step(struct particle_sim *s, float dt);
+
+// Get the state of particle i.
+void particle_sim_get(const struct particle_sim *s, int i,
+                      struct particle *p);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,92 @@
+// particles.c - Particle system simulated on the GPU.
+#include "tcm/particles.h"
+
+#include "tcm/drawlist.h"
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
+#include "tcm/particle_sim.h"
+#include "tcm/shaders.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+const char *const PARTICLE_VARYINGS[PARTICLE_VARYING_COUNT] = {
+    "out_state",
+    "out_age",
+    "out_seed",
+};
+
+void particles_init(struct particles *ps, int count) {
+    *ps = (struct particles){.count = count};
+    size_t size = sizeof(struct particle) * count;
+    struct particle *data = malloc(size);
+    if (data == NULL) {
+        fputs("Error: No memory\n", stderr);
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        particle_initial(&data[i], i, count);
+    }
+    glGenBuffers(2, ps->buffer);
+    glGenVertexArrays(2, ps->array);
+    for (int i = 0; i < 2; i++) {
+        memtrack_add(MEMTRACK_BUFFER, ps->buffer[i], "particles");
+        memtrack_set_size(MEMTRACK_BUFFER, ps->buffer[i], size);
+        glstate_bind_vertex_array(ps->array[i]);
+        glstate_bind_buffer(GL_ARRAY_BUFFER, ps->buffer[i]);
+        glBufferData(GL_ARRAY_BUFFER, size, data, GL_DYNAMIC_COPY);
+        const GLsizei stride = sizeof(struct particle);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride,
+                              (void *)offsetof(struct particle, x));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride,
+                              (void *)offsetof(struct particle, age));
+        glEnableVertexAttribArray(2);
+        glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, stride,
+                               (void *)offsetof(struct particle, seed));
+    }
+    free(data);
+    // Core profile ignores gl_PointSize unless this is enabled.
+    glEnable(GL_PROGRAM_POINT_SIZE);
+}
+
+void particles_destroy(struct particles *ps) {
+    glstate_delete_vertex_arrays(2, ps->array);
+    glstate_delete_buffers(2, ps->buffer);
+    *ps = (struct particles){0};
+}
+
+void particles_update(struct particles *ps, float dt) {
+    if (shader_particle_update == 0) {
+        return;
+    }
+    GLuint out = ps->buffer[ps->current ^ 1];
+    glstate_use_program(shader_particle_update);
+    glUniform1f(glGetUniformLocation(shader_particle_update, "dt"), dt);
+    glstate_bind_vertex_array(ps->array[ps->current]);
+    // Keep the cache in sync with the generic binding set by
+    // glBindBufferBase.
+    glstate_bind_buffer(GL_TRANSFORM_FEEDBACK_BUFFER, out);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, out);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, ps->count);
+    glEndTransformFeedback();
+    glDisable(GL_RASTERIZER_DISCARD);
+    ps->current ^= 1;
+}
+
+void particles_draw(struct particles *ps, struct drawlist *dl) {
+    if (shader_particle == 0) {
+        return;
+    }
+    drawlist_add(dl, &(struct draw_item){
+                         .program = shader_particle,
+                         .vertex_array = ps->array[ps->current],
+                         .mode = GL_POINTS,
+                         .first = 0,
+                         .count = ps->count,
+                     });
+}
@@ -0,0 +1,40 @@
+// particles.h - Particle system simulated on the GPU.
+#pragma once
+
+#include "tcm/gl.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct drawlist;
+
+// Outputs of the particle_update shader, which must be set with
+// glTransformFeedbackVaryings before linking.
+#define PARTICLE_VARYING_COUNT 3
+extern const char *const PARTICLE_VARYINGS[PARTICLE_VARYING_COUNT];
+
+// Particles on the GPU. The state is kept in two buffers, and each update
+// reads one and writes the other with transform feedback.
+struct particles {
+    int count;
+    // Index of the buffer containing the current state.
+    int current;
+    GLuint buffer[2];
+    // Vertex arrays reading each buffer, for both updating and drawing.
+    GLuint array[2];
+};
+
+void particles_init(struct particles *ps, int count);
+
+void particles_destroy(struct particles *ps);
+
+// Advance the simulation by dt seconds.
+void particles_update(struct particles *ps, float dt);
+
+// Draw the particles.
+void particles_draw(struct particles *ps, struct drawlist *dl);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,385 @@
+// post.c - Post-processing: bloom, blur, and tone mapping.
+#include "tcm/post.h"
+
+#include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
+#include "tcm/shaders.h"
+
+#include <stddef.h>
+#include <string.h>
+
+enum {
+    // Maximum number of levels in the bloom pyramid. The first level is half
+    // the size of the frame, and each level is half the size of the last.
+    MAX_LEVELS = 6,
+    // Smallest width or height of a pyramid level, in pixels.
+    MIN_LEVEL_SIZE = 8,
+    // Number of frames of timer queries in flight.
+    QUERY_FRAMES = 4,
+    // Maximum number of timestamps in a frame.
+    MAX_MARKS = 48,
+};
+
+// Format of all render targets: three floating-point channels in 32 bits, half
+// the bandwidth of RGBA16F.
+#define TARGET_FORMAT GL_R11F_G11F_B10F
+
+// A texture to render into, and its framebuffer.
+struct target {
+    GLuint texture;
+    GLuint framebuffer;
+    int width, height;
+};
+
+// Timestamps recorded in one frame.
+struct marks {
+    GLuint query[MAX_MARKS];
+    // Kind of pass which starts at each timestamp. The last timestamp marks
+    // the end of the last pass.
+    unsigned char pass[MAX_MARKS];
+    int count;
+};
+
+static unsigned effects = POST_ALL;
+static bool timing;
+
+static struct {
+    bool initialized;
+    int width, height;
+    // Empty vertex array for drawing full screen triangles.
+    GLuint vertex_array;
+    // The frame, in high dynamic range.
+    struct target scene;
+    // The bloom pyramid, and a second image at each level for blurring.
+    int levels;
+    struct target bloom[MAX_LEVELS];
+    struct target bloom_tmp[MAX_LEVELS];
+    // The frame blurred at half size.
+    struct target blur, blur_tmp;
+    struct marks marks[QUERY_FRAMES];
+    // Whether timestamps are recorded in the current frame.
+    bool timed;
+    unsigned frame;
+    struct post_timings timings;
+} post;
+
+static void target_create(struct target *t, int width, int height) {
+    t->width = width;
+    t->height = height;
+    glGenTextures(1, &t->texture);
+    memtrack_add(MEMTRACK_TEXTURE, t->texture, "post");
+    memtrack_set_size(MEMTRACK_TEXTURE, t->texture,
+                      (size_t)width * height * 4);
+    glstate_bind_texture(0, GL_TEXTURE_2D, t->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, TARGET_FORMAT, width, height, 0, GL_RGB,
+                 GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glGenFramebuffers(1, &t->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, t->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           t->texture, 0);
+}
+
+static void target_destroy(struct target *t) {
+    if (t->texture == 0) {
+        return;
+    }
+    glDeleteFramebuffers(1, &t->framebuffer);
+    glstate_delete_textures(1, &t->texture);
+    *t = (struct target){0};
+}
+
+static void destroy_targets(void) {
+    target_destroy(&post.scene);
+    for (int i = 0; i < post.levels; i++) {
+        target_destroy(&post.bloom[i]);
+        target_destroy(&post.bloom_tmp[i]);
+    }
+    post.levels = 0;
+    target_destroy(&post.blur);
+    target_destroy(&post.blur_tmp);
+    post.width = 0;
+    post.height = 0;
+}
+
+static void resize(int width, int height) {
+    destroy_targets();
+    post.width = width;
+    post.height = height;
+    target_create(&post.scene, width, height);
+    int w = width, h = height;
+    while (post.levels < MAX_LEVELS) {
+        w /= 2;
+        h /= 2;
+        if (w < MIN_LEVEL_SIZE || h < MIN_LEVEL_SIZE) {
+            break;
+        }
+        target_create(&post.bloom[post.levels], w, h);
+        target_create(&post.bloom_tmp[post.levels], w, h);
+        post.levels++;
+    }
+    w = width > 1 ? width / 2 : 1;
+    h = height > 1 ? height / 2 : 1;
+    target_create(&post.blur, w, h);
+    target_create(&post.blur_tmp, w, h);
+}
+
+void post_init(void) {
+    post.initialized = true;
+    glGenVertexArrays(1, &post.vertex_array);
+    for (int i = 0; i < QUERY_FRAMES; i++) {
+        glGenQueries(MAX_MARKS, post.marks[i].query);
+    }
+}
+
+void post_term(void) {
+    if (!post.initialized) {
+        return;
+    }
+    destroy_targets();
+    glstate_delete_vertex_arrays(1, &post.vertex_array);
+    for (int i = 0; i < QUERY_FRAMES; i++) {
+        glDeleteQueries(MAX_MARKS, post.marks[i].query);
+    }
+    memset(&post, 0, sizeof(post));
+}
+
+unsigned post_effects(void) {
+    return effects;
+}
+
+void post_set_effects(unsigned value) {
+    effects = value & POST_ALL;
+}
+
+void post_set_timing(bool enabled) {
+    timing = enabled;
+}
+
+// Record the time at the start of a pass, or at the end of the last pass.
+static void mark(int pass) {
+    struct marks *m = &post.marks[post.frame % QUERY_FRAMES];
+    if (!post.timed || m->count == MAX_MARKS) {
+        return;
+    }
+    glQueryCounter(m->query[m->count], GL_TIMESTAMP);
+    m->pass[m->count] = (unsigned char)pass;
+    m->count++;
+}
+
+// Read the timestamps recorded in an earlier frame. Returns false, without
+// waiting, if they are not ready yet, in which case the queries are still in
+// use.
+static bool read_marks(struct marks *m) {
+    if (m->count < 2) {
+        m->count = 0;
+        return true;
+    }
+    GLint available;
+    glGetQueryObjectiv(m->query[m->count - 1], GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (!available) {
+        return false;
+    }
+    struct post_timings t;
+    memset(&t, 0, sizeof(t));
+    GLuint64 prev;
+    glGetQueryObjectui64v(m->query[0], GL_QUERY_RESULT, &prev);
+    for (int i = 1; i < m->count; i++) {
+        GLuint64 time;
+        glGetQueryObjectui64v(m->query[i], GL_QUERY_RESULT, &time);
+        int pass = m->pass[i - 1];
+        t.ms[pass] += (float)(time - prev) * 1e-6f;
+        t.count[pass]++;
+        prev = time;
+    }
+    post.timings = t;
+    m->count = 0;
+    return true;
+}
+
+// Start a pass which draws into a target.
+static void begin_pass(enum post_pass pass, const struct target *dst,
+                       GLuint program) {
+    mark(pass);
+    glBindFramebuffer(GL_FRAMEBUFFER, dst->framebuffer);
+    glViewport(0, 0, dst->width, dst->height);
+    glstate_use_program(program);
+}
+
+// Read from a target in the current pass, on texture unit 0.
+static void set_source(GLuint program, const struct target *src) {
+    glstate_bind_texture(0, GL_TEXTURE_2D, src->texture);
+    glUniform2f(glGetUniformLocation(program, "texel"), 1.0f / src->width,
+                1.0f / src->height);
+}
+
+// Draw a triangle covering the target.
+static void draw_triangle(void) {
+    glstate_bind_vertex_array(post.vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+// Blur a target horizontally into tmp, and then vertically back.
+static void blur(enum post_pass pass, const struct target *t,
+                 const struct target *tmp) {
+    GLuint prog = shader_post_blur;
+    GLint dir = glGetUniformLocation(prog, "dir");
+    begin_pass(pass, tmp, prog);
+    glstate_bind_texture(0, GL_TEXTURE_2D, t->texture);
+    glUniform2f(dir, 1.0f / t->width, 0.0f);
+    draw_triangle();
+    begin_pass(pass, t, prog);
+    glstate_bind_texture(0, GL_TEXTURE_2D, tmp->texture);
+    glUniform2f(dir, 0.0f, 1.0f / tmp->height);
+    draw_triangle();
+}
+
+// Build the bloom pyramid, leaving the result in the first level. The bright
+// parts of the frame are downsampled to each level in turn. Then, from the
+// smallest level up, each level is blurred and added to the next larger level.
+static void bloom(const struct post_params *params) {
+    GLuint prog = shader_post_prefilter;
+    begin_pass(POST_PASS_PREFILTER, &post.bloom[0], prog);
+    set_source(prog, &post.scene);
+    glUniform1f(glGetUniformLocation(prog, "threshold"),
+                params->bloom_threshold);
+    glUniform1f(glGetUniformLocation(prog, "knee"), params->bloom_knee);
+    draw_triangle();
+
+    prog = shader_post_down;
+    for (int i = 1; i < post.levels; i++) {
+        begin_pass(POST_PASS_DOWNSAMPLE, &post.bloom[i], prog);
+        set_source(prog, &post.bloom[i - 1]);
+        draw_triangle();
+    }
+
+    prog = shader_post_up;
+    for (int i = post.levels - 1; i >= 0; i--) {
+        blur(POST_PASS_BLUR, &post.bloom[i], &post.bloom_tmp[i]);
+        if (i > 0) {
+            begin_pass(POST_PASS_UPSAMPLE, &post.bloom[i - 1], prog);
+            set_source(prog, &post.bloom[i]);
+            glstate_set_blend(true);
+            glstate_blend_func(GL_ONE, GL_ONE);
+            draw_triangle();
+            glstate_set_blend(false);
+        }
+    }
+}
+
+// Blur the whole frame at half size.
+static void scene_blur(void) {
+    GLuint prog = shader_post_down;
+    begin_pass(POST_PASS_SCENE_BLUR, &post.blur, prog);
+    set_source(prog, &post.scene);
+    draw_triangle();
+    blur(POST_PASS_SCENE_BLUR, &post.blur, &post.blur_tmp);
+}
+
+void post_begin(int width, int height) {
+    // The window may be minimized.
+    if (width < 1) {
+        width = 1;
+    }
+    if (height < 1) {
+        height = 1;
+    }
+    if (width != post.width || height != post.height) {
+        resize(width, height);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, post.scene.framebuffer);
+    glViewport(0, 0, width, height);
+}
+
+void post_end(const struct post_params *params) {
+    // Timestamps from QUERY_FRAMES frames ago are almost always ready. If they
+    // are not, the last timings are kept, and this frame is not timed.
+    post.timed = timing && read_marks(&post.marks[post.frame % QUERY_FRAMES]);
+
+    bool do_bloom = (effects & POST_BLOOM) != 0 && post.levels > 0 &&
+                    params->bloom_intensity > 0.0f &&
+                    shader_post_prefilter != 0 && shader_post_down != 0 &&
+                    shader_post_blur != 0 && shader_post_up != 0;
+    bool do_blur = (effects & POST_BLUR) != 0 && params->blur > 0.0f &&
+                   shader_post_down != 0 && shader_post_blur != 0;
+    if (do_bloom) {
+        bloom(params);
+    }
+    if (do_blur) {
+        scene_blur();
+    }
+
+    GLuint prog = shader_variant(
+        SHADER_PROGRAM_POST_COMPOSITE,
+        &(struct shader_key){.knob = {
+                                 [SHADER_KNOB_BLOOM] = do_bloom,
+                                 [SHADER_KNOB_BLUR] = do_blur,
+                                 [SHADER_KNOB_TONEMAP] =
+                                     (effects & POST_TONEMAP) != 0,
+                             }});
+    if (prog == 0) {
+        prog = shader_post_composite;
+    }
+    mark(POST_PASS_COMPOSITE);
+    if (prog == 0) {
+        // Copy the frame as it is.
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, post.scene.framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, post.width, post.height, 0, 0, post.width,
+                          post.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        // Leave the default framebuffer bound for reading too.
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, post.width, post.height);
+        glstate_use_program(prog);
+        glstate_bind_texture(0, GL_TEXTURE_2D, post.scene.texture);
+        glUniform1i(glGetUniformLocation(prog, "scene"), 0);
+        if (do_bloom) {
+            glstate_bind_texture(1, GL_TEXTURE_2D, post.bloom[0].texture);
+        }
+        glUniform1i(glGetUniformLocation(prog, "bloom"), 1);
+        if (do_blur) {
+            glstate_bind_texture(2, GL_TEXTURE_2D, post.blur.texture);
+        }
+        glUniform1i(glGetUniformLocation(prog, "blurred"), 2);
+        glUniform1f(glGetUniformLocation(prog, "bloom_intensity"),
+                    do_bloom ? params->bloom_intensity : 0.0f);
+        glUniform1f(glGetUniformLocation(prog, "blur"),
+                    do_blur ? params->blur : 0.0f);
+        glUniform1f(glGetUniformLocation(prog, "exposure"), params->exposure);
+        glUniform1i(glGetUniformLocation(prog, "tonemap"),
+                    (effects & POST_TONEMAP) != 0);
+        draw_triangle();
+    }
+    mark(POST_PASS_COUNT);
+    post.frame++;
+}
+
+const char *post_pass_name(enum post_pass pass) {
+    switch (pass) {
+    case POST_PASS_PREFILTER:
+        return "prefilter";
+    case POST_PASS_DOWNSAMPLE:
+        return "downsample";
+    case POST_PASS_BLUR:
+        return "blur";
+    case POST_PASS_UPSAMPLE:
+        return "upsample";
+    case POST_PASS_SCENE_BLUR:
+        return "scene blur";
+    case POST_PASS_COMPOSITE:
+        return "composite";
+    default:
+        return "?";
+    }
+}
+
+struct post_timings post_get_timings(void) {
+    return post.timings;
+}
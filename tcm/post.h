@@ -0,0 +1,83 @@
+// post.h - Post-processing: bloom, blur, and tone mapping.
+#pragma once
+
+#include <stdbool.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// Effects, which can be turned on and off separately.
+enum {
+    POST_BLOOM = 1u << 0,
+    POST_BLUR = 1u << 1,
+    POST_TONEMAP = 1u << 2,
+    POST_ALL = POST_BLOOM | POST_BLUR | POST_TONEMAP,
+};
+
+// Kinds of passes, which are timed separately.
+enum post_pass {
+    POST_PASS_PREFILTER,
+    POST_PASS_DOWNSAMPLE,
+    POST_PASS_BLUR,
+    POST_PASS_UPSAMPLE,
+    POST_PASS_SCENE_BLUR,
+    POST_PASS_COMPOSITE,
+    POST_PASS_COUNT,
+};
+
+// Parameters for the effects in a frame.
+struct post_params {
+    // Brightness above which the image blooms, and the width of the soft
+    // transition around the threshold.
+    float bloom_threshold;
+    float bloom_knee;
+    // Amount of bloom added to the image.
+    float bloom_intensity;
+    // Amount of blur, from 0 (none) to 1 (fully blurred).
+    float blur;
+    // Scale applied to the image before tone mapping.
+    float exposure;
+};
+
+// GPU time spent in each kind of pass, for a recent frame.
+struct post_timings {
+    // Time in milliseconds.
+    float ms[POST_PASS_COUNT];
+    // Number of passes.
+    int count[POST_PASS_COUNT];
+};
+
+void post_init(void);
+
+// Release the resources used for post-processing.
+void post_term(void);
+
+// Get or set the enabled effects, a combination of POST_BLOOM, POST_BLUR, and
+// POST_TONEMAP. All are enabled by default.
+unsigned post_effects(void);
+void post_set_effects(unsigned effects);
+
+// Start drawing a frame into the HDR target, which has the given size in
+// pixels. Binds the target and sets the viewport.
+void post_begin(int width, int height);
+
+// Apply the enabled effects to the frame, and draw the result to the default
+// framebuffer.
+void post_end(const struct post_params *params);
+
+// Get the name of a kind of pass.
+const char *post_pass_name(enum post_pass pass);
+
+// Turn timing of the passes on or off. Timing is off by default, and no queries
+// are issued.
+void post_set_timing(bool enabled);
+
+// Get the GPU time spent in each pass. Times are measured with timer queries
+// and read a few frames later, so they do not stall the pipeline. A frame whose
+// queries are not ready in time is skipped.
+struct post_timings post_get_timings(void);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,20 @@
+#version 330
+
+// Vertices of a curve from lsystem.c, drawn with line.geom and line.frag.
+
+layout(location = 0) in float in_x;
+layout(location = 1) in float in_y;
+
+out VertexData {
+    vec3 color;
+} dout;
+
+// Offset in xy, scale in z, and number of vertices in w.
+uniform vec4 transform;
+
+void main() {
+    float t = float(gl_VertexID) / transform.w;
+    dout.color = vec3(t, 0.5, 1.0 - t);
+    gl_Position =
+        vec4(transform.xy + transform.z * vec2(in_x, in_y), 0.0, 1.0);
+}
@@ -0,0 +1,29 @@
+// Return vertex idx of the dragon curve from (-1, 0) to (1, 0), with the given
+// number of subdivisions. Each subdivision moves the midpoint of each segment
+// sideways by a times the segment length. The displacement of the last
+// subdivision is scaled by morph, so the curve changes smoothly between depths.
+vec2 dragon_point(int idx, int depth, float a, float morph) {
+    vec2 v0 = vec2(-1.0, 0.0);
+    vec2 v1 = vec2(1.0, 0.0);
+    int N = depth;
+    if (idx <= 0) {
+        return v0;
+    }
+    if (idx >= 1 << N) {
+        return v1;
+    }
+    float dir = 1.0;
+    for (int i = 0; i < N; i++) {
+        float amount = i == N - 1 ? a * morph : a;
+        vec2 v2 = mix(v0, v1, 0.5);
+        v2 += (v1 - v0).yx * vec2(-1.0, 1.0) * amount * dir;
+        if ((idx & (1 << (N - 1 - i))) == 0) {
+            v1 = v2;
+            dir = 1.0;
+        } else {
+            v0 = v2;
+            dir = -1.0;
+        }
+    }
+    return v0;
+}
@@ -0,0 +1,29 @@
+#version 330
+
+#include "dragon.glsl"
+
+// Per-instance parameters, from struct dragon_instance in dragon.h.
+layout(location = 0) in vec4 in_transform; // Center xy, scale, angle.
+layout(location = 1) in float in_a;
+layout(location = 2) in vec4 in_color;
+
+out VertexData {
+    vec3 color;
+} dout;
+
+#ifdef DEPTH
+const int depth = DEPTH;
+#else
+uniform int depth;
+#endif
+uniform float morph;
+
+void main() {
+    int idx = gl_VertexID - 1;
+    float t = float(idx) / float(1 << depth);
+    vec2 p = dragon_point(idx, depth, in_a, morph);
+    float c = cos(in_transform.w), s = sin(in_transform.w);
+    p = mat2(c, s, -s, c) * p * in_transform.z + in_transform.xy;
+    dout.color = in_color.rgb * (0.5 + 0.5 * t);
+    gl_Position = vec4(p, 0.0, 1.0);
+}
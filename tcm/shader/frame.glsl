@@ -0,0 +1,13 @@
+// Values for the current frame, shared by all programs. Matches struct
+// frame_uniforms in frame.h.
+layout(std140) uniform Frame {
+    // Framebuffer size, in pixels.
+    vec2 resolution;
+    // Scale from view coordinates to clip coordinates. The view is 2 units high
+    // and 16:9, and is fit inside the framebuffer without stretching.
+    vec2 view;
+    // Demo time, in seconds.
+    float time;
+    // Framebuffer width divided by height.
+    float aspect;
+};
@@ -0,0 +1,15 @@
+#version 330
+
+in VertexData {
+    vec4 color;
+} din;
+
+out vec4 out_color;
+
+void main() {
+    vec2 d = gl_PointCoord * 2.0 - 1.0;
+    if (dot(d, d) > 1.0) {
+        discard;
+    }
+    out_color = din.color;
+}
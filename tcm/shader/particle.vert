@@ -0,0 +1,21 @@
+#version 330
+
+#include "frame.glsl"
+
+const float LIFE = 4.0;
+
+layout(location = 0) in vec4 in_state;
+layout(location = 1) in float in_age;
+
+out VertexData {
+    vec4 color;
+} dout;
+
+void main() {
+    float t = in_age / LIFE;
+    float speed = length(in_state.zw);
+    vec3 color = mix(vec3(1.0, 0.8, 0.3), vec3(0.3, 0.4, 1.0), t);
+    dout.color = vec4(color * (0.5 + speed) * (1.0 - t), 1.0);
+    gl_PointSize = 2.0;
+    gl_Position = vec4(view * in_state.xy, 0.0, 1.0);
+}
@@ -0,0 +1,57 @@
+#version 330
+
+// Particle simulation step, run with transform feedback. Must match
+// particle_sim_step() in particle_sim.c.
+
+const float LIFE = 4.0;
+const float GRAVITY = 0.3;
+const float SWIRL = 0.5;
+const float EMIT_Y = -0.8;
+const float SPREAD = 0.6;
+const float SPEED_MIN = 0.6;
+const float SPEED_MAX = 1.2;
+
+layout(location = 0) in vec4 in_state;
+layout(location = 1) in float in_age;
+layout(location = 2) in uint in_seed;
+
+out vec4 out_state;
+out float out_age;
+flat out uint out_seed;
+
+uniform float dt;
+
+uint hash(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float unorm(uint x) {
+    return uintBitsToFloat((x >> 9) | 0x3f800000u) - 1.0;
+}
+
+void main() {
+    vec2 pos = in_state.xy;
+    vec2 vel = in_state.zw;
+    float age = in_age + dt;
+    uint seed = in_seed;
+    if (age >= LIFE) {
+        seed = hash(seed);
+        float u1 = unorm(seed);
+        float u2 = unorm(hash(seed ^ 0x9e3779b9u));
+        age -= LIFE;
+        pos = vec2(0.0, EMIT_Y);
+        vel = vec2((u1 - 0.5) * SPREAD,
+                   SPEED_MIN + u2 * (SPEED_MAX - SPEED_MIN));
+    }
+    vel.x += -pos.y * (SWIRL * dt);
+    vel.y += (pos.x * SWIRL - GRAVITY) * dt;
+    pos += vel * dt;
+    out_state = vec4(pos, vel);
+    out_age = age;
+    out_seed = seed;
+}
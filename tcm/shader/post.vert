@@ -0,0 +1,12 @@
+#version 330
+
+// Full screen triangle, drawn with three vertices and no attributes.
+
+out vec2 uv;
+
+void main() {
+    vec2 pos = vec2(float((gl_VertexID & 1) << 2),
+                    float((gl_VertexID & 2) << 1));
+    uv = 0.5 * pos;
+    gl_Position = vec4(pos - 1.0, 0.0, 1.0);
+}
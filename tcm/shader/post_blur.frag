@@ -0,0 +1,25 @@
+#version 330
+
+// One direction of a separable 9-tap Gaussian blur. Pairs of taps are merged
+// into one bilinear fetch placed between them, with the combined weight, so
+// only 5 fetches are needed.
+
+uniform sampler2D src;
+// Size of a texel in the source, along the blur direction.
+uniform vec2 dir;
+
+in vec2 uv;
+
+out vec4 out_color;
+
+const float offset[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float weight[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+void main() {
+    vec3 c = texture(src, uv).rgb * weight[0];
+    for (int i = 1; i < 3; i++) {
+        c += texture(src, uv + dir * offset[i]).rgb * weight[i];
+        c += texture(src, uv - dir * offset[i]).rgb * weight[i];
+    }
+    out_color = vec4(c, 1.0);
+}
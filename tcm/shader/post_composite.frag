@@ -0,0 +1,46 @@
+#version 330
+
+// Combine the scene with the bloom and blur, and tone map the result. Variants
+// define BLOOM, BLUR, and TONEMAP as 0 or 1, and leave out the effects which
+// are off.
+
+uniform sampler2D scene;
+uniform sampler2D bloom;
+uniform sampler2D blurred;
+uniform float bloom_intensity;
+// Amount of blur, from 0 to 1.
+uniform float blur;
+uniform float exposure;
+#ifdef TONEMAP
+const bool tonemap = TONEMAP != 0;
+#else
+uniform bool tonemap;
+#endif
+
+in vec2 uv;
+
+out vec4 out_color;
+
+// Filmic curve fit to ACES, by Krzysztof Narkowicz.
+vec3 aces(vec3 x) {
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14),
+                 0.0, 1.0);
+}
+
+void main() {
+    vec3 c = texture(scene, uv).rgb;
+#if !defined BLUR || BLUR
+    if (blur > 0.0) {
+        c = mix(c, texture(blurred, uv).rgb, blur);
+    }
+#endif
+#if !defined BLOOM || BLOOM
+    if (bloom_intensity > 0.0) {
+        c += texture(bloom, uv).rgb * bloom_intensity;
+    }
+#endif
+    if (tonemap) {
+        c = aces(c * exposure);
+    }
+    out_color = vec4(c, 1.0);
+}
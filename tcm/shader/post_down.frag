@@ -0,0 +1,20 @@
+#version 330
+
+// Downsample to half size.
+
+uniform sampler2D src;
+// Size of a texel in the source.
+uniform vec2 texel;
+
+in vec2 uv;
+
+out vec4 out_color;
+
+void main() {
+    // Four bilinear taps average a 4x4 block of source texels.
+    vec3 c = texture(src, uv + texel * vec2(-1.0, -1.0)).rgb;
+    c += texture(src, uv + texel * vec2(1.0, -1.0)).rgb;
+    c += texture(src, uv + texel * vec2(-1.0, 1.0)).rgb;
+    c += texture(src, uv + texel * vec2(1.0, 1.0)).rgb;
+    out_color = vec4(0.25 * c, 1.0);
+}
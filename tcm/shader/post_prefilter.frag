@@ -0,0 +1,28 @@
+#version 330
+
+// First step of the bloom pyramid: downsample to half size, and keep only the
+// parts of the image brighter than the threshold, with a soft knee.
+
+uniform sampler2D src;
+// Size of a texel in the source.
+uniform vec2 texel;
+uniform float threshold;
+uniform float knee;
+
+in vec2 uv;
+
+out vec4 out_color;
+
+void main() {
+    // Four bilinear taps average a 4x4 block of source texels.
+    vec3 c = texture(src, uv + texel * vec2(-1.0, -1.0)).rgb;
+    c += texture(src, uv + texel * vec2(1.0, -1.0)).rgb;
+    c += texture(src, uv + texel * vec2(-1.0, 1.0)).rgb;
+    c += texture(src, uv + texel * vec2(1.0, 1.0)).rgb;
+    c *= 0.25;
+    float bright = max(c.r, max(c.g, c.b));
+    float soft = clamp(bright - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-4);
+    float weight = max(soft, bright - threshold) / max(bright, 1e-4);
+    out_color = vec4(c * weight, 1.0);
+}
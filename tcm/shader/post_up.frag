@@ -0,0 +1,25 @@
+#version 330
+
+// Upsample to twice the size with a 3x3 tent filter. The result is added to
+// the destination by blending.
+
+uniform sampler2D src;
+// Size of a texel in the source.
+uniform vec2 texel;
+
+in vec2 uv;
+
+out vec4 out_color;
+
+void main() {
+    vec3 c = texture(src, uv).rgb * 4.0;
+    c += texture(src, uv + texel * vec2(-1.0, 0.0)).rgb * 2.0;
+    c += texture(src, uv + texel * vec2(1.0, 0.0)).rgb * 2.0;
+    c += texture(src, uv + texel * vec2(0.0, -1.0)).rgb * 2.0;
+    c += texture(src, uv + texel * vec2(0.0, 1.0)).rgb * 2.0;
+    c += texture(src, uv + texel * vec2(-1.0, -1.0)).rgb;
+    c += texture(src, uv + texel * vec2(1.0, -1.0)).rgb;
+    c += texture(src, uv + texel * vec2(-1.0, 1.0)).rgb;
+    c += texture(src, uv + texel * vec2(1.0, 1.0)).rgb;
+    out_color = vec4(c * (1.0 / 16.0), 1.0);
+}
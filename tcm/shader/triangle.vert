@@ -1,6 +1,6 @@
 #version 330
 
-const vec2 view = vec2(9.0 / 16.0, 1.0);
+#include "frame.glsl"
 
 layout(location = 0) in vec2 in_pos;
 
@@ -1,6 +1,9 @@
 // shaders.c - Shader programs used in the demo.
 #include "tcm/shaders.h"
 
+#include <stdbool.h>
+#include <stdio.h>
+
 // Note... we have to explicitly set these to 0. If we leave them uninitialized,
 // they will be common symbols, and this will result in a link error because
 // some linkers don't consider common symbols to be definitions. This is only a
@@ -9,3 +12,133 @@
 GLuint shader_triangle = 0;
 
 GLuint shader_line = 0;
+
+GLuint shader_particle_update = 0;
+
+GLuint shader_particle = 0;
+
+GLuint shader_curve = 0;
+
+GLuint shader_dragon_instanced = 0;
+
+GLuint shader_post_prefilter = 0;
+
+GLuint shader_post_down = 0;
+
+GLuint shader_post_blur = 0;
+
+GLuint shader_post_up = 0;
+
+GLuint shader_post_composite = 0;
+
+enum {
+    // Maximum number of variants in the cache.
+    MAX_VARIANTS = 64,
+};
+
+static struct shader_variant variants[MAX_VARIANTS];
+static int variant_count;
+
+static const char *const KNOB_NAMES[SHADER_KNOB_COUNT] = {
+    [SHADER_KNOB_DEPTH] = "DEPTH",
+    [SHADER_KNOB_BLOOM] = "BLOOM",
+    [SHADER_KNOB_BLUR] = "BLUR",
+    [SHADER_KNOB_TONEMAP] = "TONEMAP",
+};
+
+static const struct {
+    const char *name;
+    unsigned knobs;
+} PROGRAMS[SHADER_PROGRAM_COUNT] = {
+    [SHADER_PROGRAM_LINE] = {"line", 1u << SHADER_KNOB_DEPTH},
+    [SHADER_PROGRAM_DRAGON_INSTANCED] = {"dragon_instanced",
+                                         1u << SHADER_KNOB_DEPTH},
+    [SHADER_PROGRAM_POST_COMPOSITE] = {"post_composite",
+                                       (1u << SHADER_KNOB_BLOOM) |
+                                           (1u << SHADER_KNOB_BLUR) |
+                                           (1u << SHADER_KNOB_TONEMAP)},
+};
+
+const char *shader_knob_name(enum shader_knob knob) {
+    return KNOB_NAMES[knob];
+}
+
+const char *shader_program_name(enum shader_program program) {
+    return PROGRAMS[program].name;
+}
+
+unsigned shader_program_knobs(enum shader_program program) {
+    return PROGRAMS[program].knobs;
+}
+
+size_t shader_defines(enum shader_program program,
+                      const struct shader_key *key, char *buf, size_t size) {
+    unsigned knobs = PROGRAMS[program].knobs;
+    size_t pos = 0;
+    for (int i = 0; i < SHADER_KNOB_COUNT; i++) {
+        if ((knobs & (1u << i)) == 0) {
+            continue;
+        }
+        int n = snprintf(pos < size ? buf + pos : NULL,
+                         pos < size ? size - pos : 0, "#define %s %d\n",
+                         KNOB_NAMES[i], key->knob[i]);
+        if (n > 0) {
+            pos += (size_t)n;
+        }
+    }
+    if (size > 0 && pos == 0) {
+        buf[0] = '\0';
+    }
+    return pos;
+}
+
+// Find a variant in the cache, comparing only the knobs the program uses.
+static struct shader_variant *find_variant(enum shader_program program,
+                                           const struct shader_key *key) {
+    unsigned knobs = PROGRAMS[program].knobs;
+    for (int i = 0; i < variant_count; i++) {
+        struct shader_variant *v = &variants[i];
+        if (v->program != program) {
+            continue;
+        }
+        bool match = true;
+        for (int j = 0; j < SHADER_KNOB_COUNT; j++) {
+            if ((knobs & (1u << j)) != 0 && v->key.knob[j] != key->knob[j]) {
+                match = false;
+                break;
+            }
+        }
+        if (match) {
+            return v;
+        }
+    }
+    return NULL;
+}
+
+GLuint shader_variant(enum shader_program program,
+                      const struct shader_key *key) {
+    struct shader_variant *v = shader_variant_add(program, key);
+    return v != NULL ? v->id : 0;
+}
+
+struct shader_variant *shader_variant_add(enum shader_program program,
+                                          const struct shader_key *key) {
+    struct shader_variant *v = find_variant(program, key);
+    if (v != NULL || variant_count >= MAX_VARIANTS) {
+        return v;
+    }
+    v = &variants[variant_count++];
+    v->program = program;
+    // Knobs the program does not use are cleared.
+    unsigned knobs = PROGRAMS[program].knobs;
+    for (int i = 0; i < SHADER_KNOB_COUNT; i++) {
+        v->key.knob[i] = (knobs & (1u << i)) != 0 ? key->knob[i] : 0;
+    }
+    v->id = 0;
+    return v;
+}
+
+struct shader_variant *shader_variants(int *count) {
+    *count = variant_count;
+    return variants;
+}
@@ -3,8 +3,110 @@
 
 #include "tcm/gl.h"
 
+#include <stddef.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
 // The triangle.vert / triangle.frag shader.
 extern GLuint shader_triangle;
 
 // The line.vert / line.geom / line.frag shader.
 extern GLuint shader_line;
+
+// The particle_update.vert shader, which updates particles with transform
+// feedback.
+extern GLuint shader_particle_update;
+
+// The particle.vert / particle.frag shader.
+extern GLuint shader_particle;
+
+// The curve.vert / line.geom / line.frag shader.
+extern GLuint shader_curve;
+
+// The dragon_instanced.vert / line.geom / line.frag shader.
+extern GLuint shader_dragon_instanced;
+
+// Post-processing shaders, each using post.vert with the given fragment shader.
+extern GLuint shader_post_prefilter;
+extern GLuint shader_post_down;
+extern GLuint shader_post_blur;
+extern GLuint shader_post_up;
+extern GLuint shader_post_composite;
+
+// Shader variants. A program with variants is compiled again for each set of
+// knob values it is used with, with a #define for each of its knobs after the
+// #version line, so the driver can fold them as constants. The general
+// programs above are compiled without the defines, and read the same values
+// from uniforms, so they can be used until a variant is ready.
+
+// Values a program can be specialized on.
+enum shader_knob {
+    // Subdivisions of the dragon curve, as DEPTH.
+    SHADER_KNOB_DEPTH,
+    // Post-processing effects, as BLOOM, BLUR, and TONEMAP, each 0 or 1.
+    SHADER_KNOB_BLOOM,
+    SHADER_KNOB_BLUR,
+    SHADER_KNOB_TONEMAP,
+    SHADER_KNOB_COUNT,
+};
+
+// Programs with variants.
+enum shader_program {
+    // Variants of shader_line, with DEPTH.
+    SHADER_PROGRAM_LINE,
+    // Variants of shader_dragon_instanced, with DEPTH.
+    SHADER_PROGRAM_DRAGON_INSTANCED,
+    // Variants of shader_post_composite, with BLOOM, BLUR, and TONEMAP.
+    SHADER_PROGRAM_POST_COMPOSITE,
+    SHADER_PROGRAM_COUNT,
+};
+
+// A value for each knob. Knobs which the program does not use are ignored.
+struct shader_key {
+    int knob[SHADER_KNOB_COUNT];
+};
+
+// A variant in the cache.
+struct shader_variant {
+    enum shader_program program;
+    struct shader_key key;
+    // The linked program, or 0 if it is not built.
+    GLuint id;
+};
+
+// Get the name of a knob, as defined in shaders.
+const char *shader_knob_name(enum shader_knob knob);
+
+// Get the name of a program.
+const char *shader_program_name(enum shader_program program);
+
+// Get the knobs a program uses, as a mask of (1u << knob).
+unsigned shader_program_knobs(enum shader_program program);
+
+// Write the #define lines for a variant to a buffer, like snprintf. Returns the
+// length of the text, which is truncated if it does not fit.
+size_t shader_defines(enum shader_program program,
+                      const struct shader_key *key, char *buf, size_t size);
+
+// Get a variant of a program. Returns 0 if it is not built yet, in which case
+// the general program should be used. A variant is added to the cache the
+// first time it is asked for. The development build then compiles it in the
+// background. The release build only has the variants compiled by
+// load_shaders().
+GLuint shader_variant(enum shader_program program,
+                      const struct shader_key *key);
+
+// Add a variant to the cache, if it is not already present, and return it.
+// Returns NULL if the cache is full.
+struct shader_variant *shader_variant_add(enum shader_program program,
+                                          const struct shader_key *key);
+
+// Get the variants in the cache, in the order they were added. Entries do not
+// move once added.
+struct shader_variant *shader_variants(int *count);
+
+#if defined __cplusplus
+}
+#endif
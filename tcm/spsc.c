@@ -0,0 +1,80 @@
+// spsc.c - Lock-free single-producer, single-consumer queues.
+#include "tcm/spsc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool sample_ring_init(struct sample_ring *r, size_t size) {
+    r->data = calloc(size, sizeof(*r->data));
+    if (r->data == NULL) {
+        return false;
+    }
+    r->size = size;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    return true;
+}
+
+void sample_ring_destroy(struct sample_ring *r) {
+    free(r->data);
+    r->data = NULL;
+}
+
+size_t sample_ring_write_avail(struct sample_ring *r) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return r->size - (head - tail);
+}
+
+void sample_ring_write(struct sample_ring *r, const float *data, size_t count) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t mask = r->size - 1;
+    size_t pos = head & mask;
+    size_t n = r->size - pos;
+    if (n > count) {
+        n = count;
+    }
+    memcpy(r->data + pos, data, n * sizeof(*data));
+    memcpy(r->data, data + n, (count - n) * sizeof(*data));
+    atomic_store_explicit(&r->head, head + count, memory_order_release);
+}
+
+size_t sample_ring_read(struct sample_ring *r, float *data, size_t count) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (count > head - tail) {
+        count = head - tail;
+    }
+    size_t mask = r->size - 1;
+    size_t pos = tail & mask;
+    size_t n = r->size - pos;
+    if (n > count) {
+        n = count;
+    }
+    memcpy(data, r->data + pos, n * sizeof(*data));
+    memcpy(data + n, r->data, (count - n) * sizeof(*data));
+    atomic_store_explicit(&r->tail, tail + count, memory_order_release);
+    return count;
+}
+
+bool param_queue_push(struct param_queue *q, struct param_msg msg) {
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head - tail >= PARAM_QUEUE_SIZE) {
+        return false;
+    }
+    q->msg[head % PARAM_QUEUE_SIZE] = msg;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool param_queue_pop(struct param_queue *q, struct param_msg *msg) {
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *msg = q->msg[tail % PARAM_QUEUE_SIZE];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
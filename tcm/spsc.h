@@ -0,0 +1,61 @@
+// spsc.h - Lock-free single-producer, single-consumer queues.
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// A ring buffer of audio samples. One thread writes, another thread reads.
+// Neither side ever blocks or takes a lock.
+struct sample_ring {
+    float *data;
+    // Capacity in samples, a power of two.
+    size_t size;
+    // Total number of samples written and read. The difference is the number
+    // of samples in the buffer.
+    _Atomic size_t head;
+    _Atomic size_t tail;
+};
+
+// Initialize a sample ring with the given capacity, which must be a power of
+// two. Returns false if out of memory.
+bool sample_ring_init(struct sample_ring *r, size_t size);
+
+// Free the memory used by a sample ring.
+void sample_ring_destroy(struct sample_ring *r);
+
+// Return the number of samples which can be written without overwriting unread
+// samples. Only call from the producer.
+size_t sample_ring_write_avail(struct sample_ring *r);
+
+// Write samples to the ring. The count must not exceed the available space.
+// Only call from the producer.
+void sample_ring_write(struct sample_ring *r, const float *data, size_t count);
+
+// Read up to count samples from the ring, and return the number of samples
+// read. Only call from the consumer.
+size_t sample_ring_read(struct sample_ring *r, float *data, size_t count);
+
+// A message changing a parameter.
+struct param_msg {
+    int param;
+    float value;
+};
+
+// Capacity of a parameter queue.
+#define PARAM_QUEUE_SIZE 256
+
+// A wait-free queue of parameter changes.
+struct param_queue {
+    struct param_msg msg[PARAM_QUEUE_SIZE];
+    _Atomic unsigned head;
+    _Atomic unsigned tail;
+};
+
+// Push a message onto the queue. Returns false if the queue is full. Only call
+// from the producer.
+bool param_queue_push(struct param_queue *q, struct param_msg msg);
+
+// Pop a message from the queue. Returns false if the queue is empty. Only call
+// from the consumer.
+bool param_queue_pop(struct param_queue *q, struct param_msg *msg);
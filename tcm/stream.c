@@ -0,0 +1,232 @@
+// stream.c - Streaming buffer for dynamic geometry.
+#include "tcm/stream.h"
+
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
+
+#include <stdint.h>
+#include <string.h>
+
+enum {
+    // Maximum number of frames in flight.
+    MAX_FRAMES = 4,
+    // Number of buffers used in turn for each lap, without persistent mapping.
+    // A frame may use at most this many laps.
+    ORPHAN_BUFFERS = 2,
+};
+
+// A frame which the GPU may still be using.
+struct frame {
+    GLsync fence;
+    // Position of the end of the frame's data.
+    uint64_t end;
+};
+
+static struct {
+    bool initialized;
+    bool persistent;
+    // The buffer for the current lap, one of buffers.
+    GLuint buffer;
+    GLuint buffers[ORPHAN_BUFFERS];
+    // Persistent mapping of the whole buffer, or NULL.
+    char *base;
+    bool mapped;
+    // Positions increase monotonically, and are taken modulo the buffer size
+    // to get offsets. Data between tail and head may be in use by the GPU.
+    uint64_t head;
+    uint64_t tail;
+    // End of the data protected by the most recent fence.
+    uint64_t fenced;
+    // Position of the start of the current frame.
+    uint64_t frame_start;
+    // Frames from frame_tail to frame_head are in flight.
+    struct frame frames[MAX_FRAMES];
+    unsigned frame_head, frame_tail;
+} stream;
+
+static struct stream_stats counts, last_frame;
+
+// Whether the next buffer may be persistently mapped.
+static bool allow_persistent = true;
+
+static GLuint new_buffer(void) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    memtrack_add(MEMTRACK_BUFFER, buffer, "stream");
+    memtrack_set_size(MEMTRACK_BUFFER, buffer, STREAM_SIZE);
+    glstate_bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+    return buffer;
+}
+
+static void stream_init(void) {
+    stream.initialized = true;
+    stream.buffer = new_buffer();
+#if !defined __APPLE__
+    if (allow_persistent && GLEW_ARB_buffer_storage) {
+        const GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, STREAM_SIZE, NULL, flags);
+        stream.base =
+            glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, STREAM_SIZE, flags);
+        if (stream.base != NULL) {
+            stream.persistent = true;
+            stream.buffers[0] = stream.buffer;
+            return;
+        }
+        // Buffer storage is immutable, so start again with a new buffer.
+        glstate_delete_buffers(1, &stream.buffer);
+        stream.buffer = new_buffer();
+    }
+#endif
+    stream.buffers[0] = stream.buffer;
+    for (int i = 1; i < ORPHAN_BUFFERS; i++) {
+        stream.buffers[i] = new_buffer();
+    }
+    for (int i = 0; i < ORPHAN_BUFFERS; i++) {
+        glstate_bind_buffer(GL_COPY_WRITE_BUFFER, stream.buffers[i]);
+        glBufferData(GL_COPY_WRITE_BUFFER, STREAM_SIZE, NULL, GL_STREAM_DRAW);
+    }
+}
+
+// Wait for the oldest frame in flight to finish. If block is false, only
+// release the frame if it has already finished.
+static bool release_frame(bool block) {
+    if (stream.frame_tail == stream.frame_head) {
+        return false;
+    }
+    struct frame *f = &stream.frames[stream.frame_tail % MAX_FRAMES];
+    GLenum r = glClientWaitSync(f->fence, 0, 0);
+    if (r == GL_TIMEOUT_EXPIRED) {
+        if (!block) {
+            return false;
+        }
+        counts.stalls++;
+        do {
+            r = glClientWaitSync(f->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                 1000000000);
+        } while (r == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(f->fence);
+    stream.tail = f->end;
+    stream.frame_tail++;
+    return true;
+}
+
+void *stream_map(size_t size, size_t align, struct stream_range *range) {
+    if (!stream.initialized) {
+        stream_init();
+    }
+    if (size > STREAM_SIZE) {
+        counts.failures++;
+        return NULL;
+    }
+    uint64_t pos = (stream.head + align - 1) & ~(uint64_t)(align - 1);
+    size_t offset = pos % STREAM_SIZE;
+    if (offset + size > STREAM_SIZE) {
+        // Skip to the start of the buffer.
+        pos += STREAM_SIZE - offset;
+        offset = 0;
+    }
+    void *ptr;
+    if (stream.persistent) {
+        while (release_frame(false)) {}
+        while (pos + size - stream.tail > STREAM_SIZE) {
+            if (!release_frame(true)) {
+                // The current frame has used the entire buffer.
+                counts.failures++;
+                return NULL;
+            }
+        }
+        ptr = stream.base + offset;
+    } else {
+        uint64_t lap = pos / STREAM_SIZE;
+        if (offset == 0 && stream.head != 0) {
+            // This starts a new lap, including when the last one ended exactly
+            // at the end of the buffer. Laps use the buffers in turn, so data
+            // written earlier in the frame is in another buffer, unless the
+            // frame has used them all.
+            if (lap - stream.frame_start / STREAM_SIZE >= ORPHAN_BUFFERS) {
+                counts.failures++;
+                return NULL;
+            }
+            stream.buffer = stream.buffers[lap % ORPHAN_BUFFERS];
+            // Give the old storage to the driver, which will release it once
+            // the GPU is done with it.
+            glstate_bind_buffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, STREAM_SIZE, NULL,
+                         GL_STREAM_DRAW);
+            counts.orphans++;
+        }
+        glstate_bind_buffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+        ptr = glMapBufferRange(
+            GL_COPY_WRITE_BUFFER, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                GL_MAP_UNSYNCHRONIZED_BIT);
+        if (ptr == NULL) {
+            counts.failures++;
+            return NULL;
+        }
+        stream.mapped = true;
+    }
+    stream.head = pos + size;
+    counts.bytes += size;
+    range->buffer = stream.buffer;
+    range->offset = offset;
+    return ptr;
+}
+
+void stream_unmap(void) {
+    if (stream.mapped) {
+        stream.mapped = false;
+        glstate_bind_buffer(GL_COPY_WRITE_BUFFER, stream.buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+}
+
+bool stream_write(const void *data, size_t size, size_t align,
+                  struct stream_range *range) {
+    void *ptr = stream_map(size, align, range);
+    if (ptr == NULL) {
+        return false;
+    }
+    memcpy(ptr, data, size);
+    stream_unmap();
+    return true;
+}
+
+void stream_end_frame(void) {
+    if (stream.persistent && stream.head != stream.fenced) {
+        if (stream.frame_head - stream.frame_tail == MAX_FRAMES) {
+            release_frame(true);
+        }
+        stream.frames[stream.frame_head % MAX_FRAMES] = (struct frame){
+            .fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+            .end = stream.head,
+        };
+        stream.frame_head++;
+        stream.fenced = stream.head;
+    }
+    stream.frame_start = stream.head;
+    last_frame = counts;
+    counts = (struct stream_stats){0};
+}
+
+struct stream_stats stream_frame_stats(void) {
+    return last_frame;
+}
+
+void stream_set_persistent(bool allow) {
+    allow_persistent = allow;
+}
+
+void stream_term(void) {
+    if (!stream.initialized) {
+        return;
+    }
+    stream_unmap();
+    while (release_frame(true)) {}
+    // Deleting the buffer also unmaps it.
+    glstate_delete_buffers(stream.persistent ? 1 : ORPHAN_BUFFERS,
+                           stream.buffers);
+    memset(&stream, 0, sizeof(stream));
+}
@@ -0,0 +1,75 @@
+// stream.h - Streaming buffer for dynamic geometry.
+#pragma once
+
+#include "tcm/gl.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// The stream buffer is a ring buffer shared by all code which uploads new data
+// every frame. Data written to it is only valid until the end of the frame in
+// which it was written.
+//
+// Where ARB_buffer_storage is available, the buffer is persistently mapped, and
+// each frame is protected by a fence. Writing waits only if the GPU is still
+// using the space. Otherwise, each allocation is mapped unsynchronized. When
+// the buffer wraps around, the next of two buffers is orphaned and used for the
+// next lap, so data written earlier in the frame is kept. Either way, a frame
+// can always write STREAM_SIZE bytes, and writes which do not fit fail.
+
+enum {
+    // Size of the stream buffer, in bytes.
+    STREAM_SIZE = 4 << 20,
+};
+
+// A location in the stream buffer.
+struct stream_range {
+    GLuint buffer;
+    GLintptr offset;
+};
+
+// Counts for streaming activity.
+struct stream_stats {
+    // Number of bytes allocated.
+    size_t bytes;
+    // Number of times the CPU waited for the GPU to release space.
+    unsigned stalls;
+    // Number of times the buffer was orphaned.
+    unsigned orphans;
+    // Number of allocations which failed because they did not fit.
+    unsigned failures;
+};
+
+// Allocate space in the stream buffer and map it for writing. The alignment
+// must be a power of two. Returns NULL on failure. The space must be unmapped
+// with stream_unmap() before the next allocation, and before drawing.
+void *stream_map(size_t size, size_t align, struct stream_range *range);
+
+// Finish writing to the space returned by stream_map().
+void stream_unmap(void);
+
+// Copy data into the stream buffer. Returns false on failure.
+bool stream_write(const void *data, size_t size, size_t align,
+                  struct stream_range *range);
+
+// Finish a frame, making its counts available from stream_frame_stats().
+void stream_end_frame(void);
+
+// Get the counts for the last completed frame.
+struct stream_stats stream_frame_stats(void);
+
+// Delete the stream buffer, waiting for the GPU to finish with it.
+void stream_term(void);
+
+// Choose whether the stream buffer may be persistently mapped, which is the
+// default. Takes effect when the buffer is next created, after stream_term().
+// Turning it off tests the orphaning path on drivers with ARB_buffer_storage.
+void stream_set_persistent(bool allow);
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,128 @@
+// stub.c - Decompress the demo into memory and run it.
+//
+// The compressed executable is linked into this program by pack_exe.py. It is
+// decompressed into an anonymous in-memory file, which is executed in place of
+// this process, so nothing is written to disk. Linux only.
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+extern const unsigned long PACKED_SIZE;
+extern const unsigned char PACKED_DATA[];
+extern const size_t PACKED_DATA_SIZE;
+
+extern char **environ;
+
+static void die(const char *msg) __attribute__((noreturn));
+
+static void die(const char *msg) {
+    fprintf(stderr, "Error: %s\n", msg);
+    exit(1);
+}
+
+// Read a length extension, adding it to n. Returns false on truncated input.
+static bool read_length(const unsigned char **src, const unsigned char *end,
+                        size_t *n) {
+    const unsigned char *p = *src;
+    unsigned b;
+    do {
+        if (p >= end) {
+            return false;
+        }
+        b = *p++;
+        *n += b;
+    } while (b == 255);
+    *src = p;
+    return true;
+}
+
+// Decompress data in the format written by pack_exe.py. Returns false if the
+// data is corrupt.
+static bool decompress(const unsigned char *src, size_t srclen,
+                       unsigned char *dst, size_t dstlen) {
+    const unsigned char *send = src + srclen;
+    unsigned char *dp = dst, *dend = dst + dstlen;
+    while (src < send) {
+        unsigned token = *src++;
+        size_t n = token >> 4;
+        if (n == 15 && !read_length(&src, send, &n)) {
+            return false;
+        }
+        if (n > (size_t)(send - src) || n > (size_t)(dend - dp)) {
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            dp[i] = src[i];
+        }
+        dp += n;
+        src += n;
+        if (src == send) {
+            break;
+        }
+        if (send - src < 2) {
+            return false;
+        }
+        size_t offset = src[0] | (src[1] << 8);
+        src += 2;
+        n = (token & 15) + 4;
+        if ((token & 15) == 15 && !read_length(&src, send, &n)) {
+            return false;
+        }
+        if (offset == 0 || offset > (size_t)(dp - dst) ||
+            n > (size_t)(dend - dp)) {
+            return false;
+        }
+        // Matches may overlap their own output, so copy forwards.
+        const unsigned char *m = dp - offset;
+        for (size_t i = 0; i < n; i++) {
+            dp[i] = m[i];
+        }
+        dp += n;
+    }
+    return dp == dend;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    double t0 = now();
+    unsigned char *data = malloc(PACKED_SIZE);
+    if (data == NULL) {
+        die("No memory");
+    }
+    if (!decompress(PACKED_DATA, PACKED_DATA_SIZE, data, PACKED_SIZE)) {
+        die("Corrupt data");
+    }
+    double t1 = now();
+    if (getenv("TCM_STUB_STATS") != NULL) {
+        fprintf(stderr, "stub: %zu bytes decompressed to %lu in %.2f ms\n",
+                PACKED_DATA_SIZE, PACKED_SIZE, (t1 - t0) * 1e3);
+    }
+
+    // memfd_create is called directly, because it is missing from older C
+    // libraries.
+    int fd = syscall(SYS_memfd_create, "tcm", 0u);
+    if (fd == -1) {
+        die("Could not create memory file");
+    }
+    size_t pos = 0;
+    while (pos < PACKED_SIZE) {
+        ssize_t amt = write(fd, data + pos, PACKED_SIZE - pos);
+        if (amt < 0) {
+            die("Could not write memory file");
+        }
+        pos += amt;
+    }
+    free(data);
+    fexecve(fd, argv, environ);
+    die("Could not execute demo");
+}
@@ -0,0 +1,274 @@
+// synth.c - Software synthesizer.
+#include "tcm/synth.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Voices are processed in groups of four, one voice per SIMD lane. GCC vector
+// extensions compile to SSE on x86, NEON on ARM, and scalar code elsewhere.
+typedef float v4sf __attribute__((vector_size(16)));
+typedef int32_t v4si __attribute__((vector_size(16)));
+typedef uint32_t v4su __attribute__((vector_size(16)));
+
+enum {
+    // Number of voice groups.
+    NGROUPS = SYNTH_MAX_VOICES / 4,
+    // Number of frames rendered at a time.
+    BLOCK = 64,
+};
+
+static const float PI = 3.14159265f;
+
+// Envelope level below which a released voice is considered silent.
+static const float SILENT = 1e-4f;
+
+static inline v4sf splat(float x) {
+    return (v4sf){x, x, x, x};
+}
+
+// Return a where mask is set, and b elsewhere.
+static inline v4sf select4(v4si mask, v4sf a, v4sf b) {
+    return (v4sf)(((v4si)a & mask) | ((v4si)b & ~mask));
+}
+
+// State for four voices.
+struct group {
+    // Oscillators. Phase is in the range 0-1.
+    v4sf phase;
+    v4sf dphase;
+    v4sf saw;
+    v4sf square;
+    v4sf noise;
+    v4su seed;
+    // Envelope. The attack is a linear increment per sample, decay and release
+    // are exponential coefficients per sample.
+    v4sf env;
+    v4sf attack;
+    v4sf decay;
+    v4sf sustain;
+    v4sf release;
+    // Mask, set while the envelope is rising.
+    v4si attacking;
+    // Number of samples remaining before release.
+    v4si gate;
+    // State-variable filter.
+    v4sf cutoff;
+    v4sf env_cutoff;
+    v4sf damp;
+    v4sf low;
+    v4sf band;
+    // Output gain for each channel.
+    v4sf gain_l;
+    v4sf gain_r;
+};
+
+struct synth {
+    struct group group[NGROUPS];
+    // Bit mask of active voices, indexed by voice.
+    uint64_t active;
+    uint32_t seed;
+    float param[SYNTH_PARAM_COUNT];
+};
+
+struct synth *synth_new(void) {
+    // Vector members need 16-byte alignment.
+    struct synth *s;
+    if (posix_memalign((void **)&s, 16, sizeof(*s)) != 0) {
+        return NULL;
+    }
+    *s = (struct synth){
+        .seed = 1,
+        .param =
+            {
+                [SYNTH_PARAM_VOLUME] = 0.5f,
+                [SYNTH_PARAM_BRIGHTNESS] = 1.0f,
+            },
+    };
+    return s;
+}
+
+void synth_free(struct synth *s) {
+    free(s);
+}
+
+void synth_set_param(struct synth *s, int param, float value) {
+    if (param >= 0 && param < SYNTH_PARAM_COUNT) {
+        s->param[param] = value;
+    }
+}
+
+// Return a per-sample exponential coefficient for the given time constant.
+static float time_coeff(float t) {
+    if (t <= 0.0f) {
+        return 0.0f;
+    }
+    return expf(-1.0f / (t * (float)SYNTH_RATE));
+}
+
+// Choose a voice for a new note.
+static int alloc_voice(const struct synth *s) {
+    if (~s->active != 0) {
+        for (int i = 0; i < SYNTH_MAX_VOICES; i++) {
+            if ((s->active & ((uint64_t)1 << i)) == 0) {
+                return i;
+            }
+        }
+    }
+    int best = 0;
+    float best_env = INFINITY;
+    for (int i = 0; i < SYNTH_MAX_VOICES; i++) {
+        float env = s->group[i >> 2].env[i & 3];
+        if (env < best_env) {
+            best = i;
+            best_env = env;
+        }
+    }
+    return best;
+}
+
+void synth_note_on(struct synth *s, const struct synth_note *note) {
+    const struct synth_instrument *in = note->instrument;
+    int voice = alloc_voice(s);
+    struct group *g = &s->group[voice >> 2];
+    int i = voice & 3;
+    s->active |= (uint64_t)1 << voice;
+    s->seed = s->seed * 1103515245u + 12345u;
+
+    float freq = 440.0f * exp2f((note->pitch - 69.0f) * (1.0f / 12.0f));
+    g->phase[i] = 0.0f;
+    g->dphase[i] = freq / (float)SYNTH_RATE;
+    g->saw[i] = in->saw;
+    g->square[i] = in->square;
+    g->noise[i] = in->noise;
+    g->seed[i] = s->seed;
+
+    g->env[i] = 0.0f;
+    g->attack[i] =
+        in->attack > 0.0f ? 1.0f / (in->attack * (float)SYNTH_RATE) : 1.0f;
+    g->decay[i] = time_coeff(in->decay);
+    g->sustain[i] = in->sustain;
+    g->release[i] = time_coeff(in->release);
+    g->attacking[i] = -1;
+    g->gate[i] = note->duration;
+
+    float fc = in->cutoff;
+    if (fc > (float)SYNTH_RATE / 6.0f) {
+        fc = (float)SYNTH_RATE / 6.0f;
+    }
+    float damp = 2.0f * (1.0f - in->resonance);
+    if (damp < 0.05f) {
+        damp = 0.05f;
+    }
+    g->cutoff[i] = 2.0f * sinf(PI * fc / (float)SYNTH_RATE);
+    g->env_cutoff[i] = in->env_cutoff;
+    g->damp[i] = damp;
+    g->low[i] = 0.0f;
+    g->band[i] = 0.0f;
+
+    float angle = (note->pan + 1.0f) * (PI / 4.0f);
+    g->gain_l[i] = note->velocity * cosf(angle);
+    g->gain_r[i] = note->velocity * sinf(angle);
+}
+
+int synth_active_voices(const struct synth *s) {
+    return __builtin_popcountll(s->active);
+}
+
+// Render a block of audio for a group of voices, adding it to the output.
+static void render_group(struct group *restrict g, float brightness,
+                         v4sf *restrict out_l, v4sf *restrict out_r, int n) {
+    const v4sf one = splat(1.0f);
+    v4sf phase = g->phase, dphase = g->dphase;
+    v4sf saw = g->saw, square = g->square, noise = g->noise;
+    v4su seed = g->seed;
+    v4sf env = g->env, attack = g->attack, decay = g->decay,
+         sustain = g->sustain, release = g->release;
+    v4si attacking = g->attacking, gate = g->gate;
+    v4sf cutoff = g->cutoff * splat(brightness), env_cutoff = g->env_cutoff,
+         damp = g->damp;
+    v4sf low = g->low, band = g->band;
+    v4sf gain_l = g->gain_l, gain_r = g->gain_r;
+    for (int i = 0; i < n; i++) {
+        // Oscillators.
+        v4sf x = (phase * 2.0f - 1.0f) * saw;
+        x += select4(phase < 0.5f, one, -one) * square;
+        seed = seed * 1664525u + 1013904223u;
+        x += ((v4sf)((seed >> 9) | 0x40000000u) - 3.0f) * noise;
+        phase += dphase;
+        phase -= (v4sf)((v4si)one & (phase >= 1.0f));
+
+        // Envelope.
+        v4si held = gate > 0;
+        gate += held;
+        env = select4(attacking, env + attack,
+                      select4(held, sustain + (env - sustain) * decay,
+                              env * release));
+        v4si peak = attacking & (env >= 1.0f);
+        env = select4(peak, one, env);
+        attacking &= held & ~peak;
+
+        // Filter.
+        v4sf f = cutoff * (one + env_cutoff * env);
+        f = select4(f < 1.0f, f, one);
+        low += f * band;
+        band += f * (x - low - damp * band);
+
+        v4sf y = low * env;
+        out_l[i] += y * gain_l;
+        out_r[i] += y * gain_r;
+    }
+    g->phase = phase;
+    g->seed = seed;
+    g->env = env;
+    g->attacking = attacking;
+    g->gate = gate;
+    g->low = low;
+    g->band = band;
+}
+
+// Deactivate voices which have finished.
+static void reap_voices(struct synth *s) {
+    for (int v = 0; v < SYNTH_MAX_VOICES; v++) {
+        uint64_t bit = (uint64_t)1 << v;
+        if ((s->active & bit) == 0) {
+            continue;
+        }
+        struct group *g = &s->group[v >> 2];
+        int i = v & 3;
+        if (g->gate[i] <= 0 && g->env[i] < SILENT) {
+            s->active &= ~bit;
+            g->env[i] = 0.0f;
+            g->low[i] = 0.0f;
+            g->band[i] = 0.0f;
+            g->gain_l[i] = 0.0f;
+            g->gain_r[i] = 0.0f;
+        }
+    }
+}
+
+void synth_render(struct synth *s, float *out, int nframes) {
+    v4sf acc_l[BLOCK], acc_r[BLOCK];
+    float volume = s->param[SYNTH_PARAM_VOLUME];
+    float brightness = s->param[SYNTH_PARAM_BRIGHTNESS];
+    while (nframes > 0) {
+        int n = nframes < BLOCK ? nframes : BLOCK;
+        for (int i = 0; i < n; i++) {
+            acc_l[i] = splat(0.0f);
+            acc_r[i] = splat(0.0f);
+        }
+        for (int j = 0; j < NGROUPS; j++) {
+            if (((s->active >> (j * 4)) & 15) != 0) {
+                render_group(&s->group[j], brightness, acc_l, acc_r, n);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            v4sf l = acc_l[i], r = acc_r[i];
+            out[i * 2] = volume * ((l[0] + l[1]) + (l[2] + l[3]));
+            out[i * 2 + 1] = volume * ((r[0] + r[1]) + (r[2] + r[3]));
+        }
+        reap_voices(s);
+        out += n * 2;
+        nframes -= n;
+    }
+}
@@ -0,0 +1,79 @@
+// synth.h - Software synthesizer.
+#pragma once
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// Sample rate, in Hz.
+#define SYNTH_RATE 48000
+
+// Maximum number of simultaneous voices. Must be a multiple of 4.
+#define SYNTH_MAX_VOICES 64
+
+// Global synthesizer parameters, which may be changed while it is running.
+enum {
+    // Master output volume, linear gain.
+    SYNTH_PARAM_VOLUME,
+    // Multiplier for all filter cutoff frequencies.
+    SYNTH_PARAM_BRIGHTNESS,
+
+    SYNTH_PARAM_COUNT
+};
+
+// A synthesizer instrument. Each voice is a mix of oscillators, followed by a
+// resonant lowpass filter and an ADSR envelope.
+struct synth_instrument {
+    // Oscillator mix.
+    float saw;
+    float square;
+    float noise;
+    // Envelope, times in seconds.
+    float attack;
+    float decay;
+    float sustain;
+    float release;
+    // Filter cutoff in Hz, and how much the envelope opens the filter, as a
+    // multiple of the cutoff.
+    float cutoff;
+    float env_cutoff;
+    // Filter resonance, 0-1.
+    float resonance;
+};
+
+// A note to play.
+struct synth_note {
+    const struct synth_instrument *instrument;
+    // MIDI note number.
+    float pitch;
+    // Linear gain.
+    float velocity;
+    // Stereo position, -1 is left, +1 is right.
+    float pan;
+    // Number of samples before the note is released.
+    int duration;
+};
+
+struct synth;
+
+// Create a new synthesizer. Returns NULL if out of memory.
+struct synth *synth_new(void);
+
+// Free a synthesizer.
+void synth_free(struct synth *s);
+
+// Set a global synthesizer parameter.
+void synth_set_param(struct synth *s, int param, float value);
+
+// Start playing a note. If all voices are in use, the quietest one is stolen.
+void synth_note_on(struct synth *s, const struct synth_note *note);
+
+// Return the number of voices currently playing.
+int synth_active_voices(const struct synth *s);
+
+// Render audio, as interleaved stereo.
+void synth_render(struct synth *s, float *out, int nframes);
+
+#if defined __cplusplus
+}
+#endif
@@ -1,7 +1,10 @@
 // triangle.h - Draw triangle on screen.
 #include "tcm/triangle.h"
 
+#include "tcm/drawlist.h"
 #include "tcm/gl.h"
+#include "tcm/glstate.h"
+#include "tcm/memtrack.h"
 #include "tcm/shaders.h"
 
 static GLuint arr;
@@ -9,9 +12,11 @@ static GLuint buf;
 
 void triangle_init(void) {
     glGenVertexArrays(1, &arr);
-    glBindVertexArray(arr);
+    glstate_bind_vertex_array(arr);
     glGenBuffers(1, &buf);
-    glBindBuffer(GL_ARRAY_BUFFER, buf);
+    memtrack_add(MEMTRACK_BUFFER, buf, "triangle");
+    memtrack_set_size(MEMTRACK_BUFFER, buf, sizeof(float) * 6);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, buf);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6,
                  (const float[][2]){
                      {-1.0f, -1.0f},
@@ -21,14 +26,17 @@ void triangle_init(void) {
                  GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void triangle_draw(void) {
+void triangle_draw(struct drawlist *dl) {
     if (shader_triangle == 0) {
         return;
     }
-    glUseProgram(shader_triangle);
-    glBindVertexArray(arr);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
+    drawlist_add(dl, &(struct draw_item){
+                         .program = shader_triangle,
+                         .vertex_array = arr,
+                         .mode = GL_TRIANGLES,
+                         .first = 0,
+                         .count = 3,
+                     });
 }
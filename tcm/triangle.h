@@ -1,6 +1,8 @@
 // triangle.h - Draw triangle on screen.
 #pragma once
 
+struct drawlist;
+
 void triangle_init(void);
 
-void triangle_draw(void);
+void triangle_draw(struct drawlist *dl);
@@ -0,0 +1,444 @@
+// vecmath.h - Vector and matrix math.
+#pragma once
+
+#include <math.h>
+
+// Single vectors and matrices are plain structures with inline functions.
+// Arrays of points are processed with batched kernels, which take structure of
+// arrays layout and use SIMD. The instruction set is chosen at compile time:
+// AVX2, SSE2, NEON, or scalar code. Define VECMATH_SCALAR to force scalar code.
+// The _scalar versions of the kernels are always available, for comparison.
+
+#if !defined VECMATH_SCALAR
+#if defined __AVX2__
+#define VECMATH_AVX2 1
+#include <immintrin.h>
+#elif defined __SSE2__
+#define VECMATH_SSE2 1
+#include <emmintrin.h>
+#elif defined __ARM_NEON
+#define VECMATH_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined VECMATH_AVX2
+#define VECMATH_ISA "avx2"
+#elif defined VECMATH_SSE2
+#define VECMATH_ISA "sse2"
+#elif defined VECMATH_NEON
+#define VECMATH_ISA "neon"
+#else
+#define VECMATH_ISA "scalar"
+#endif
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct vec2 {
+    float x, y;
+};
+
+struct vec3 {
+    float x, y, z;
+};
+
+// A 4x4 matrix, in column-major order like OpenGL: element (row, col) is
+// m[col * 4 + row].
+struct mat4 {
+    float m[16];
+};
+
+// =============================================================================
+// vec2
+// =============================================================================
+
+// Constructors are functions rather than compound literals, which are not
+// available in C++.
+static inline struct vec2 vec2_make(float x, float y) {
+    struct vec2 r = {x, y};
+    return r;
+}
+
+static inline struct vec2 vec2_add(struct vec2 a, struct vec2 b) {
+    return vec2_make(a.x + b.x, a.y + b.y);
+}
+
+static inline struct vec2 vec2_sub(struct vec2 a, struct vec2 b) {
+    return vec2_make(a.x - b.x, a.y - b.y);
+}
+
+static inline struct vec2 vec2_scale(struct vec2 a, float s) {
+    return vec2_make(a.x * s, a.y * s);
+}
+
+static inline float vec2_dot(struct vec2 a, struct vec2 b) {
+    return a.x * b.x + a.y * b.y;
+}
+
+static inline float vec2_length(struct vec2 a) {
+    return sqrtf(vec2_dot(a, a));
+}
+
+// Return a unit vector in the same direction, or zero for a zero vector.
+static inline struct vec2 vec2_normalize(struct vec2 a) {
+    float len = vec2_length(a);
+    return len > 0.0f ? vec2_scale(a, 1.0f / len) : vec2_make(0.0f, 0.0f);
+}
+
+// Return the vector rotated 90 degrees counterclockwise.
+static inline struct vec2 vec2_perp(struct vec2 a) {
+    return vec2_make(-a.y, a.x);
+}
+
+static inline struct vec2 vec2_lerp(struct vec2 a, struct vec2 b, float t) {
+    return vec2_make(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
+}
+
+// =============================================================================
+// vec3
+// =============================================================================
+
+static inline struct vec3 vec3_make(float x, float y, float z) {
+    struct vec3 r = {x, y, z};
+    return r;
+}
+
+static inline struct vec3 vec3_add(struct vec3 a, struct vec3 b) {
+    return vec3_make(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+static inline struct vec3 vec3_sub(struct vec3 a, struct vec3 b) {
+    return vec3_make(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static inline struct vec3 vec3_scale(struct vec3 a, float s) {
+    return vec3_make(a.x * s, a.y * s, a.z * s);
+}
+
+static inline float vec3_dot(struct vec3 a, struct vec3 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline struct vec3 vec3_cross(struct vec3 a, struct vec3 b) {
+    return vec3_make(
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x);
+}
+
+static inline float vec3_length(struct vec3 a) {
+    return sqrtf(vec3_dot(a, a));
+}
+
+// Return a unit vector in the same direction, or zero for a zero vector.
+static inline struct vec3 vec3_normalize(struct vec3 a) {
+    float len = vec3_length(a);
+    return len > 0.0f ? vec3_scale(a, 1.0f / len) : vec3_make(0.0f, 0.0f, 0.0f);
+}
+
+// =============================================================================
+// mat4
+// =============================================================================
+
+static inline struct mat4 mat4_identity(void) {
+    struct mat4 r = {{
+        1.0f, 0.0f, 0.0f, 0.0f, //
+        0.0f, 1.0f, 0.0f, 0.0f, //
+        0.0f, 0.0f, 1.0f, 0.0f, //
+        0.0f, 0.0f, 0.0f, 1.0f, //
+    }};
+    return r;
+}
+
+static inline struct mat4 mat4_translate(struct vec3 v) {
+    struct mat4 r = mat4_identity();
+    r.m[12] = v.x;
+    r.m[13] = v.y;
+    r.m[14] = v.z;
+    return r;
+}
+
+static inline struct mat4 mat4_scale(struct vec3 v) {
+    struct mat4 r = mat4_identity();
+    r.m[0] = v.x;
+    r.m[5] = v.y;
+    r.m[10] = v.z;
+    return r;
+}
+
+// Rotation around the Z axis, counterclockwise, in radians.
+static inline struct mat4 mat4_rotate_z(float angle) {
+    float c = cosf(angle), s = sinf(angle);
+    struct mat4 r = mat4_identity();
+    r.m[0] = c;
+    r.m[1] = s;
+    r.m[4] = -s;
+    r.m[5] = c;
+    return r;
+}
+
+// Return a * b, which applies b first and then a.
+static inline struct mat4 mat4_mul(const struct mat4 *a, const struct mat4 *b) {
+    struct mat4 r;
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a->m[k * 4 + row] * b->m[col * 4 + k];
+            }
+            r.m[col * 4 + row] = sum;
+        }
+    }
+    return r;
+}
+
+// Transform a point, with w = 1, ignoring the projective row.
+static inline struct vec3 mat4_transform_point(const struct mat4 *m,
+                                               struct vec3 p) {
+    const float *a = m->m;
+    return vec3_make(
+        a[0] * p.x + a[4] * p.y + a[8] * p.z + a[12],
+        a[1] * p.x + a[5] * p.y + a[9] * p.z + a[13],
+        a[2] * p.x + a[6] * p.y + a[10] * p.z + a[14]);
+}
+
+// Transform a direction, with w = 0.
+static inline struct vec3 mat4_transform_vector(const struct mat4 *m,
+                                                struct vec3 v) {
+    const float *a = m->m;
+    return vec3_make(
+        a[0] * v.x + a[4] * v.y + a[8] * v.z,
+        a[1] * v.x + a[5] * v.y + a[9] * v.z,
+        a[2] * v.x + a[6] * v.y + a[10] * v.z);
+}
+
+// =============================================================================
+// Batched kernels, scalar
+// =============================================================================
+
+// Transform n points in the XY plane by a matrix, ignoring Z and the projective
+// row. Input and output may be the same arrays.
+static inline void vecmath_transform2_scalar(const struct mat4 *m,
+                                             const float *x, const float *y,
+                                             float *ox, float *oy, int n) {
+    const float *a = m->m;
+    for (int i = 0; i < n; i++) {
+        float px = x[i], py = y[i];
+        ox[i] = a[0] * px + a[4] * py + a[12];
+        oy[i] = a[1] * px + a[5] * py + a[13];
+    }
+}
+
+// Normalize n 2D vectors in place. Zero vectors are left as zero.
+static inline void vecmath_normalize2_scalar(float *x, float *y, int n) {
+    for (int i = 0; i < n; i++) {
+        float len2 = x[i] * x[i] + y[i] * y[i];
+        float s = len2 > 0.0f ? 1.0f / sqrtf(len2) : 0.0f;
+        x[i] *= s;
+        y[i] *= s;
+    }
+}
+
+// Transform n 3D points by a matrix, ignoring the projective row. Input and
+// output may be the same arrays.
+static inline void vecmath_transform3_scalar(const struct mat4 *m,
+                                             const float *x, const float *y,
+                                             const float *z, float *ox,
+                                             float *oy, float *oz, int n) {
+    for (int i = 0; i < n; i++) {
+        struct vec3 p = mat4_transform_point(m, vec3_make(x[i], y[i], z[i]));
+        ox[i] = p.x;
+        oy[i] = p.y;
+        oz[i] = p.z;
+    }
+}
+
+// Normalize n 3D vectors in place. Zero vectors are left as zero.
+static inline void vecmath_normalize3_scalar(float *x, float *y, float *z,
+                                             int n) {
+    for (int i = 0; i < n; i++) {
+        float len2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+        float s = len2 > 0.0f ? 1.0f / sqrtf(len2) : 0.0f;
+        x[i] *= s;
+        y[i] *= s;
+        z[i] *= s;
+    }
+}
+
+// =============================================================================
+// Batched kernels, SIMD
+// =============================================================================
+
+// Each implementation defines a vector type, vecmath_vf, with VECMATH_WIDTH
+// lanes, and the operations used by the kernels: macros which are undefined
+// after the kernels, and vecmath_vf_rlength(). Arrays need not be aligned. The
+// scalar kernels handle the remainder.
+
+#if defined VECMATH_AVX2
+
+#define VECMATH_WIDTH 8
+typedef __m256 vecmath_vf;
+#define vf_load _mm256_loadu_ps
+#define vf_store _mm256_storeu_ps
+#define vf_splat _mm256_set1_ps
+#define vf_add _mm256_add_ps
+#define vf_mul _mm256_mul_ps
+#if defined __FMA__
+// Return a * b + c.
+#define vf_madd(a, b, c) _mm256_fmadd_ps(a, b, c)
+#else
+#define vf_madd(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#endif
+// Return 1 / sqrt(x), or 0 where x is 0.
+static inline vecmath_vf vecmath_vf_rlength(vecmath_vf x) {
+    __m256 zero = _mm256_setzero_ps();
+    __m256 r = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(x));
+    return _mm256_and_ps(r, _mm256_cmp_ps(x, zero, _CMP_GT_OQ));
+}
+
+#elif defined VECMATH_SSE2
+
+#define VECMATH_WIDTH 4
+typedef __m128 vecmath_vf;
+#define vf_load _mm_loadu_ps
+#define vf_store _mm_storeu_ps
+#define vf_splat _mm_set1_ps
+#define vf_add _mm_add_ps
+#define vf_mul _mm_mul_ps
+#define vf_madd(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+static inline vecmath_vf vecmath_vf_rlength(vecmath_vf x) {
+    __m128 r = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(x));
+    return _mm_and_ps(r, _mm_cmpgt_ps(x, _mm_setzero_ps()));
+}
+
+#elif defined VECMATH_NEON
+
+#define VECMATH_WIDTH 4
+typedef float32x4_t vecmath_vf;
+#define vf_load vld1q_f32
+#define vf_store vst1q_f32
+#define vf_splat vdupq_n_f32
+#define vf_add vaddq_f32
+#define vf_mul vmulq_f32
+#define vf_madd(a, b, c) vmlaq_f32(c, a, b)
+static inline vecmath_vf vecmath_vf_rlength(vecmath_vf x) {
+    // Estimate, refined with two Newton-Raphson steps. ARMv7 has no vector
+    // square root or division.
+    float32x4_t r = vrsqrteq_f32(x);
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(x, r), r));
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(x, r), r));
+    uint32x4_t nonzero = vcgtq_f32(x, vdupq_n_f32(0.0f));
+    return vreinterpretq_f32_u32(
+        vandq_u32(vreinterpretq_u32_f32(r), nonzero));
+}
+
+#endif
+
+#if defined VECMATH_WIDTH
+
+static inline void vecmath_transform2(const struct mat4 *m, const float *x,
+                                      const float *y, float *ox, float *oy,
+                                      int n) {
+    const float *a = m->m;
+    const vecmath_vf a0 = vf_splat(a[0]), a1 = vf_splat(a[1]),
+                     a4 = vf_splat(a[4]), a5 = vf_splat(a[5]),
+                     a12 = vf_splat(a[12]), a13 = vf_splat(a[13]);
+    int i = 0;
+    for (; i + VECMATH_WIDTH <= n; i += VECMATH_WIDTH) {
+        vecmath_vf px = vf_load(x + i), py = vf_load(y + i);
+        vf_store(ox + i, vf_madd(a0, px, vf_madd(a4, py, a12)));
+        vf_store(oy + i, vf_madd(a1, px, vf_madd(a5, py, a13)));
+    }
+    vecmath_transform2_scalar(m, x + i, y + i, ox + i, oy + i, n - i);
+}
+
+static inline void vecmath_normalize2(float *x, float *y, int n) {
+    int i = 0;
+    for (; i + VECMATH_WIDTH <= n; i += VECMATH_WIDTH) {
+        vecmath_vf vx = vf_load(x + i), vy = vf_load(y + i);
+        vecmath_vf s = vecmath_vf_rlength(vf_madd(vx, vx, vf_mul(vy, vy)));
+        vf_store(x + i, vf_mul(vx, s));
+        vf_store(y + i, vf_mul(vy, s));
+    }
+    vecmath_normalize2_scalar(x + i, y + i, n - i);
+}
+
+static inline void vecmath_transform3(const struct mat4 *m, const float *x,
+                                      const float *y, const float *z,
+                                      float *ox, float *oy, float *oz,
+                                      int n) {
+    const float *a = m->m;
+    vecmath_vf c[12];
+    for (int j = 0; j < 3; j++) {
+        c[j] = vf_splat(a[j]);
+        c[j + 3] = vf_splat(a[j + 4]);
+        c[j + 6] = vf_splat(a[j + 8]);
+        c[j + 9] = vf_splat(a[j + 12]);
+    }
+    int i = 0;
+    for (; i + VECMATH_WIDTH <= n; i += VECMATH_WIDTH) {
+        vecmath_vf px = vf_load(x + i), py = vf_load(y + i),
+                   pz = vf_load(z + i);
+        for (int j = 0; j < 3; j++) {
+            vecmath_vf r = vf_madd(c[j + 6], pz, c[j + 9]);
+            r = vf_madd(c[j], px, vf_madd(c[j + 3], py, r));
+            vf_store((j == 0 ? ox : j == 1 ? oy : oz) + i, r);
+        }
+    }
+    vecmath_transform3_scalar(m, x + i, y + i, z + i, ox + i, oy + i, oz + i,
+                              n - i);
+}
+
+static inline void vecmath_normalize3(float *x, float *y, float *z, int n) {
+    int i = 0;
+    for (; i + VECMATH_WIDTH <= n; i += VECMATH_WIDTH) {
+        vecmath_vf vx = vf_load(x + i), vy = vf_load(y + i),
+                   vz = vf_load(z + i);
+        vecmath_vf s = vecmath_vf_rlength(
+            vf_madd(vx, vx, vf_madd(vy, vy, vf_mul(vz, vz))));
+        vf_store(x + i, vf_mul(vx, s));
+        vf_store(y + i, vf_mul(vy, s));
+        vf_store(z + i, vf_mul(vz, s));
+    }
+    vecmath_normalize3_scalar(x + i, y + i, z + i, n - i);
+}
+
+#undef vf_load
+#undef vf_store
+#undef vf_splat
+#undef vf_add
+#undef vf_mul
+#undef vf_madd
+
+#else
+
+#define VECMATH_WIDTH 1
+
+static inline void vecmath_transform2(const struct mat4 *m, const float *x,
+                                      const float *y, float *ox, float *oy,
+                                      int n) {
+    vecmath_transform2_scalar(m, x, y, ox, oy, n);
+}
+
+static inline void vecmath_normalize2(float *x, float *y, int n) {
+    vecmath_normalize2_scalar(x, y, n);
+}
+
+static inline void vecmath_transform3(const struct mat4 *m, const float *x,
+                                      const float *y, const float *z,
+                                      float *ox, float *oy, float *oz,
+                                      int n) {
+    vecmath_transform3_scalar(m, x, y, z, ox, oy, oz, n);
+}
+
+static inline void vecmath_normalize3(float *x, float *y, float *z, int n) {
+    vecmath_normalize3_scalar(x, y, z, n);
+}
+
+#endif
+
+#if defined __cplusplus
+}
+#endif
@@ -0,0 +1,71 @@
+// wav.c - WAV file output.
+#include "tcm/wav.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void put16(unsigned char *p, unsigned x) {
+    p[0] = x;
+    p[1] = x >> 8;
+}
+
+static void put32(unsigned char *p, uint32_t x) {
+    p[0] = x;
+    p[1] = x >> 8;
+    p[2] = x >> 16;
+    p[3] = x >> 24;
+}
+
+bool wav_write(const char *path, const float *samples, long nframes,
+               int channels, int rate) {
+    size_t count = (size_t)nframes * channels;
+    uint32_t datasize = count * 2;
+    unsigned char *data = malloc(44 + count * 2);
+    if (data == NULL) {
+        errno = ENOMEM;
+        return false;
+    }
+    unsigned char *p = data;
+    put32(p, 0x46464952); // "RIFF"
+    put32(p + 4, 36 + datasize);
+    put32(p + 8, 0x45564157);  // "WAVE"
+    put32(p + 12, 0x20746d66); // "fmt "
+    put32(p + 16, 16);
+    put16(p + 20, 1); // PCM
+    put16(p + 22, channels);
+    put32(p + 24, rate);
+    put32(p + 28, rate * channels * 2);
+    put16(p + 32, channels * 2);
+    put16(p + 34, 16);
+    put32(p + 36, 0x61746164); // "data"
+    put32(p + 40, datasize);
+    p += 44;
+    for (size_t i = 0; i < count; i++) {
+        float x = samples[i] * 32767.0f;
+        if (x > 32767.0f) {
+            x = 32767.0f;
+        } else if (x < -32767.0f) {
+            x = -32767.0f;
+        }
+        put16(p + i * 2, (unsigned)(int)x);
+    }
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        int ecode = errno;
+        free(data);
+        errno = ecode;
+        return false;
+    }
+    size_t size = 44 + count * 2;
+    bool ok = fwrite(data, 1, size, fp) == size;
+    int ecode = errno;
+    free(data);
+    if (fclose(fp) != 0 && ok) {
+        ok = false;
+        ecode = errno;
+    }
+    errno = ecode;
+    return ok;
+}
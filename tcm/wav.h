@@ -0,0 +1,9 @@
+// wav.h - WAV file output.
+#pragma once
+
+#include <stdbool.h>
+
+// Write interleaved floating-point audio to a 16-bit WAV file. Returns false
+// on failure, with errno set.
+bool wav_write(const char *path, const float *samples, long nframes,
+               int channels, int rate);
@@ -8,7 +8,8 @@
 COPTS_BASE = [
     # Ubuntu 18 LTS uses GCC 7.4, but c17 is not supported until GCC 8.
     "-std=c11",
-    # "-D_DEFAULT_SOURCE",
+    # For POSIX functions like clock_gettime() and nanosleep().
+    "-D_DEFAULT_SOURCE",
 ]
 
 _CWARN = [
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Build an optimized release binary using a profile from a training run.
+#
+# Usage: tools/pgo.sh [<bazel flags>...]
+#
+# Builds an instrumented binary, runs it over the demo timeline to collect a
+# profile, and rebuilds with the profile and link-time optimization. Extra flags
+# are passed to the optimized build, for example --config=haswell. The plain
+# build and the optimized build are written to pgo-out/, and their sizes and
+# timeline measurements are printed.
+set -e
+
+cd "$(dirname "$0")/.."
+out="$PWD/pgo-out"
+profile="$out/profile"
+rm -rf "$out"
+mkdir -p "$profile"
+
+echo "== Plain build"
+bazel build //tcm:tcm
+cp bazel-bin/tcm/tcm "$out/tcm-plain"
+
+echo "== Instrumented build"
+bazel build --config=release --fdo_instrument="$profile" //tcm:tcm
+cp bazel-bin/tcm/tcm "$out/tcm-instrumented"
+
+echo "== Training run"
+"$out/tcm-instrumented" --timeline
+
+# Bazel takes the profile as a zip file of the .gcda tree.
+python3 - "$profile" "$out/profile.zip" <<'PY'
+import os
+import sys
+import zipfile
+root, dest = sys.argv[1:]
+with zipfile.ZipFile(dest, 'w') as z:
+    for dirpath, _, files in os.walk(root):
+        for name in files:
+            path = os.path.join(dirpath, name)
+            z.write(path, os.path.relpath(path, root))
+PY
+
+echo "== Optimized build"
+bazel build --config=release --config=lto \
+    --fdo_optimize="$out/profile.zip" "$@" //tcm:tcm
+cp bazel-bin/tcm/tcm "$out/tcm-optimized"
+
+for build in plain optimized; do
+    echo "== $build"
+    echo "size: $(wc -c < "$out/tcm-$build") bytes"
+    "$out/tcm-$build" --timeline
+done
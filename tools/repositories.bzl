@@ -15,6 +15,13 @@ def add_repositories():
             "GL/glew.h",
         ],
     )
+    pkg_config_repository(
+        name = "portaudio",
+        spec = "portaudio-2.0",
+        includes = [
+            "portaudio.h",
+        ],
+    )
     pkg_config_repository(
         name = "libpng",
         spec = "libpng",